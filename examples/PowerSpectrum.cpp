@@ -168,3 +168,10 @@ PowerSpectrum::getRemainingFeatures()
     return FeatureSet();
 }
 
+int
+PowerSpectrum::getWarmUpFrames() const
+{
+    // Each block is analysed independently of any other
+    return 0;
+}
+
@@ -72,6 +72,8 @@ public:
 
     FeatureSet getRemainingFeatures();
 
+    int getWarmUpFrames() const;
+
 protected:
     size_t m_blockSize;
 };
@@ -194,3 +194,10 @@ SpectralCentroid::getRemainingFeatures()
     return FeatureSet();
 }
 
+int
+SpectralCentroid::getWarmUpFrames() const
+{
+    // Each block is analysed independently of any other
+    return 0;
+}
+
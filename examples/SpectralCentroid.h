@@ -69,6 +69,8 @@ public:
 
     FeatureSet getRemainingFeatures();
 
+    int getWarmUpFrames() const;
+
 protected:
     size_t m_stepSize;
     size_t m_blockSize;
@@ -194,3 +194,11 @@ ZeroCrossing::getRemainingFeatures()
     return FeatureSet();
 }
 
+int
+ZeroCrossing::getWarmUpFrames() const
+{
+    // We only need the last sample of the preceding block, to
+    // detect a crossing between that block and this one
+    return 1;
+}
+
@@ -0,0 +1,452 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "FeatureFile.h"
+
+#include <cstring>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+
+static const char magic[8] = { 'V', 'A', 'M', 'P', 'F', 'E', 'A', 'T' };
+static const unsigned int formatVersion = 1;
+
+// Bytes gathered before writing them out to the file, and values
+// gathered before ending a chunk in the column layout
+static const size_t writeBufferSize = 1048576;
+static const size_t chunkValues = 262144;
+
+FeatureFileWriter::FeatureFileWriter() :
+    m_columnar(false),
+    m_stepSize(0),
+    m_binCount(0),
+    m_chunkColumns(0),
+    m_chunkFrame(0)
+{
+}
+
+FeatureFileWriter::~FeatureFileWriter()
+{
+    if (m_file.is_open()) close();
+}
+
+bool
+FeatureFileWriter::open(string filename, int sampleRate, int stepSize,
+                        const Plugin::OutputDescriptor &od)
+{
+    m_file.open(filename.c_str(), ios::out | ios::binary);
+    if (!m_file) return false;
+
+    m_columnar = (od.sampleType == Plugin::OutputDescriptor::OneSamplePerStep &&
+                  od.hasFixedBinCount);
+    m_stepSize = stepSize;
+    m_binCount = (m_columnar ? int(od.binCount) : 0);
+    m_chunkColumns = 0;
+
+    m_buffer.clear();
+    m_buffer.reserve(writeBufferSize + 4096);
+
+    for (size_t i = 0; i < sizeof(magic); ++i) {
+        m_buffer.push_back(magic[i]);
+    }
+    putInt(formatVersion);
+    putInt(m_columnar ? 1 : 0);
+    putInt(sampleRate);
+    putInt(stepSize);
+
+    putString(od.identifier);
+    putString(od.name);
+    putString(od.description);
+    putString(od.unit);
+    putInt(od.hasFixedBinCount);
+    putInt(int(od.binCount));
+    putInt(int(od.binNames.size()));
+    for (size_t i = 0; i < od.binNames.size(); ++i) {
+        putString(od.binNames[i]);
+    }
+    putInt(od.hasKnownExtents);
+    putFloat(od.minValue);
+    putFloat(od.maxValue);
+    putInt(od.isQuantized);
+    putFloat(od.quantizeStep);
+    putInt(int(od.sampleType));
+    putFloat(od.sampleRate);
+    putInt(od.hasDuration);
+
+    return true;
+}
+
+void
+FeatureFileWriter::writeFeature(const RealTime &timestamp,
+                                const Plugin::Feature &f)
+{
+    putInt(timestamp.sec);
+    putInt(timestamp.nsec);
+    putInt(f.hasDuration ? f.duration.sec : 0);
+    putInt(f.hasDuration ? f.duration.nsec : 0);
+    putInt(f.hasDuration ? 1 : 0);
+    putInt(int(f.values.size()));
+    putInt(int(f.label.size()));
+    for (size_t i = 0; i < f.values.size(); ++i) {
+        putFloat(f.values[i]);
+    }
+    m_buffer.insert(m_buffer.end(), f.label.begin(), f.label.end());
+
+    flush(false);
+}
+
+void
+FeatureFileWriter::writeColumn(int frame, const vector<float> &values)
+{
+    if (m_chunkColumns > 0 &&
+        (frame != m_chunkFrame + m_chunkColumns * m_stepSize ||
+         m_chunk.size() + m_binCount > chunkValues)) {
+        endChunk();
+    }
+
+    if (m_chunkColumns == 0) m_chunkFrame = frame;
+
+    int n = min(int(values.size()), m_binCount);
+    m_chunk.insert(m_chunk.end(), values.begin(), values.begin() + n);
+    m_chunk.resize(m_chunk.size() + (m_binCount - n), 0.f);
+    ++m_chunkColumns;
+}
+
+bool
+FeatureFileWriter::close()
+{
+    if (!m_file.is_open()) return false;
+
+    endChunk();
+    flush(true);
+
+    bool ok = m_file.good();
+    m_file.close();
+    return ok && !m_file.fail();
+}
+
+void
+FeatureFileWriter::putInt(unsigned int value)
+{
+    char bytes[4];
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = char((value >> (i * 8)) & 0xff);
+    }
+    m_buffer.insert(m_buffer.end(), bytes, bytes + 4);
+}
+
+void
+FeatureFileWriter::putFloat(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, 4);
+    putInt(bits);
+}
+
+void
+FeatureFileWriter::putString(const string &s)
+{
+    putInt(int(s.size()));
+    m_buffer.insert(m_buffer.end(), s.begin(), s.end());
+}
+
+void
+FeatureFileWriter::endChunk()
+{
+    if (m_chunkColumns == 0) return;
+
+    putInt(m_chunkColumns);
+    putInt(m_chunkFrame);
+    for (size_t i = 0; i < m_chunk.size(); ++i) {
+        putFloat(m_chunk[i]);
+    }
+
+    m_chunk.clear();
+    m_chunkColumns = 0;
+
+    flush(false);
+}
+
+void
+FeatureFileWriter::flush(bool force)
+{
+    if (m_buffer.empty()) return;
+    if (!force && m_buffer.size() < writeBufferSize) return;
+
+    m_file.write(&m_buffer[0], m_buffer.size());
+    m_buffer.clear();
+}
+
+FeatureFileReader::FeatureFileReader() :
+    m_columnar(false),
+    m_error(false),
+    m_remaining(0),
+    m_sampleRate(0),
+    m_stepSize(0),
+    m_chunkColumns(0),
+    m_chunkFrame(0),
+    m_column(0)
+{
+}
+
+FeatureFileReader::~FeatureFileReader()
+{
+}
+
+bool
+FeatureFileReader::open(string filename)
+{
+    m_file.open(filename.c_str(), ios::in | ios::binary);
+    if (!m_file) return false;
+
+    m_file.seekg(0, ios::end);
+    streamoff size = m_file.tellg();
+    m_file.seekg(0, ios::beg);
+    if (size < 0 || !m_file) {
+        m_file.close();
+        return false;
+    }
+    m_remaining = size_t(size);
+
+    char header[sizeof(magic)];
+    unsigned int version, layout, sampleRate, stepSize;
+
+    if (!getBytes(header, sizeof(magic)) ||
+        memcmp(header, magic, sizeof(magic)) ||
+        !getInt(version) || version != formatVersion ||
+        !getInt(layout) || layout > 1 ||
+        !getInt(sampleRate) || !getInt(stepSize)) {
+        m_file.close();
+        return false;
+    }
+
+    m_columnar = (layout == 1);
+    m_sampleRate = int(sampleRate);
+    m_stepSize = int(stepSize);
+
+    Plugin::OutputDescriptor &od = m_output;
+    unsigned int flag, count;
+    bool ok =
+        getString(od.identifier) &&
+        getString(od.name) &&
+        getString(od.description) &&
+        getString(od.unit);
+
+    if (ok && (ok = getInt(flag))) od.hasFixedBinCount = (flag != 0);
+    if (ok && (ok = getInt(count))) od.binCount = count;
+    if (ok && (ok = getInt(count)) && (ok = haveBytes(count, 4))) {
+        od.binNames.resize(count);
+        for (unsigned int i = 0; ok && i < count; ++i) {
+            ok = getString(od.binNames[i]);
+        }
+    }
+    if (ok && (ok = getInt(flag))) od.hasKnownExtents = (flag != 0);
+    ok = ok && getFloat(od.minValue) && getFloat(od.maxValue);
+    if (ok && (ok = getInt(flag))) od.isQuantized = (flag != 0);
+    ok = ok && getFloat(od.quantizeStep);
+    if (ok && (ok = getInt(flag))) {
+        od.sampleType = Plugin::OutputDescriptor::SampleType(flag);
+    }
+    ok = ok && getFloat(od.sampleRate);
+    if (ok && (ok = getInt(flag))) od.hasDuration = (flag != 0);
+
+    if (!ok) {
+        m_error = true;
+        m_file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool
+FeatureFileReader::readFeature(Plugin::Feature &f)
+{
+    if (!m_file.is_open()) return false;
+
+    f.hasTimestamp = true;
+
+    if (m_columnar) {
+
+        while (m_column >= m_chunkColumns) {
+            if (!readChunk(m_chunk)) return false;
+            m_column = 0;
+        }
+
+        size_t bins = m_output.binCount;
+        f.timestamp = RealTime::frame2RealTime
+            (m_chunkFrame + m_column * m_stepSize, m_sampleRate);
+        f.hasDuration = false;
+        f.duration = RealTime::zeroTime;
+        f.values.assign(m_chunk.begin() + m_column * bins,
+                        m_chunk.begin() + (m_column + 1) * bins);
+        f.label = "";
+        ++m_column;
+        return true;
+    }
+
+    if (m_file.peek() == EOF) return false;
+
+    unsigned int sec, nsec, dsec, dnsec, flags, valueCount, labelLength;
+
+    if (!getInt(sec) || !getInt(nsec) || !getInt(dsec) || !getInt(dnsec) ||
+        !getInt(flags) || !getInt(valueCount) || !getInt(labelLength) ||
+        !getFloats(f.values, valueCount)) {
+        m_error = true;
+        return false;
+    }
+
+    if (!haveBytes(labelLength, 1)) {
+        m_error = true;
+        return false;
+    }
+    m_bytes.resize(labelLength);
+    if (labelLength > 0 && !getBytes(&m_bytes[0], labelLength)) {
+        m_error = true;
+        return false;
+    }
+
+    f.timestamp = RealTime(int(sec), int(nsec));
+    f.hasDuration = ((flags & 1) != 0);
+    f.duration = RealTime(int(dsec), int(dnsec));
+    f.label = string(m_bytes.begin(), m_bytes.end());
+    return true;
+}
+
+int
+FeatureFileReader::readColumns(vector<float> &values, int &firstFrame)
+{
+    if (!m_file.is_open() || !m_columnar) return 0;
+
+    if (!readChunk(values)) return 0;
+
+    firstFrame = m_chunkFrame;
+    m_column = m_chunkColumns;
+    return m_chunkColumns;
+}
+
+bool
+FeatureFileReader::readChunk(vector<float> &values)
+{
+    if (m_file.peek() == EOF) return false;
+
+    unsigned int columns, frame;
+
+    if (!getInt(columns) || !getInt(frame) ||
+        !getFloats(values, size_t(columns) * m_output.binCount)) {
+        m_error = true;
+        return false;
+    }
+
+    m_chunkColumns = int(columns);
+    m_chunkFrame = int(frame);
+    return true;
+}
+
+bool
+FeatureFileReader::getBytes(char *bytes, size_t n)
+{
+    m_file.read(bytes, n);
+    size_t got = size_t(m_file.gcount());
+    m_remaining -= (got < m_remaining ? got : m_remaining);
+    return got == n;
+}
+
+bool
+FeatureFileReader::haveBytes(size_t count, size_t size)
+{
+    // Check a count of items of the given size read from the file
+    // against what is left of it, before allocating anything for them
+    if (count > m_remaining / size) {
+        m_error = true;
+        return false;
+    }
+    return true;
+}
+
+bool
+FeatureFileReader::getInt(unsigned int &value)
+{
+    unsigned char bytes[4];
+    if (!getBytes(reinterpret_cast<char *>(bytes), 4)) return false;
+    value = (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8) |
+        ((unsigned int)bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+    return true;
+}
+
+bool
+FeatureFileReader::getFloat(float &value)
+{
+    unsigned int bits;
+    if (!getInt(bits)) return false;
+    memcpy(&value, &bits, 4);
+    return true;
+}
+
+bool
+FeatureFileReader::getString(string &s)
+{
+    unsigned int length;
+    if (!getInt(length) || !haveBytes(length, 1)) return false;
+    m_bytes.resize(length);
+    if (length > 0 && !getBytes(&m_bytes[0], length)) return false;
+    s = string(m_bytes.begin(), m_bytes.end());
+    return true;
+}
+
+bool
+FeatureFileReader::getFloats(vector<float> &values, size_t n)
+{
+    if (!haveBytes(n, 4)) return false;
+    values.resize(n);
+    if (n == 0) return true;
+
+    m_bytes.resize(n * 4);
+    if (!getBytes(&m_bytes[0], n * 4)) return false;
+
+    const unsigned char *bytes =
+        reinterpret_cast<const unsigned char *>(&m_bytes[0]);
+
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned char *b = bytes + i * 4;
+        unsigned int bits = (unsigned int)b[0] | ((unsigned int)b[1] << 8) |
+            ((unsigned int)b[2] << 16) | ((unsigned int)b[3] << 24);
+        memcpy(&values[i], &bits, 4);
+    }
+    return true;
+}
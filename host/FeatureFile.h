@@ -0,0 +1,224 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _FEATURE_FILE_H_
+#define _FEATURE_FILE_H_
+
+#include <vamp-hostsdk/Plugin.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+ * FeatureFileWriter and FeatureFileReader write and read the binary
+ * feature files produced by vamp-simple-host with the -b option.  A
+ * feature file holds the features from a single plugin output.  All
+ * integers are 32 bits and all values 32-bit IEEE floats, stored
+ * little-endian whatever the host byte order.  Strings are stored as
+ * a length followed by that many bytes of UTF-8, with no terminator.
+ *
+ * The file starts with a header:
+ *
+ *   char[8]   "VAMPFEAT"
+ *   uint32    format version, currently 1
+ *   uint32    layout: 0 for records, 1 for columns
+ *   uint32    input sample rate
+ *   uint32    step size
+ *   string    output identifier, name, description and unit
+ *   uint32    hasFixedBinCount, binCount
+ *   uint32    number of bin names, followed by the bin names as strings
+ *   uint32    hasKnownExtents; float minValue, maxValue
+ *   uint32    isQuantized; float quantizeStep
+ *   uint32    sampleType; float sampleRate; uint32 hasDuration
+ *
+ * In the record layout, the header is followed by one record per
+ * feature up to the end of the file:
+ *
+ *   int32     timestamp sec, nsec
+ *   int32     duration sec, nsec
+ *   uint32    flags: 1 if the feature has a duration
+ *   uint32    value count, label length
+ *   float     values[value count]
+ *   char      label[label length]
+ *
+ * Every timestamp is resolved as the text output would resolve it,
+ * so that readers need not know the timing rules for each sample
+ * type.
+ *
+ * The column layout is used for OneSamplePerStep outputs with a fixed
+ * bin count, which make up most of the bulk of large analyses.  The
+ * header is followed by chunks of consecutive columns:
+ *
+ *   uint32    column count
+ *   int32     frame of the first column
+ *   float     values[column count * binCount], one column at a time
+ *
+ * Column n of a chunk has the timestamp of frame (first frame + n *
+ * step size).  Labels and durations are not stored in this layout,
+ * and a feature with the wrong number of values is truncated or
+ * padded with zeros to binCount.
+ */
+
+/**
+ * Write the features from one plugin output to a binary feature
+ * file, buffering them so as to write in large blocks.
+ */
+class FeatureFileWriter
+{
+public:
+    FeatureFileWriter();
+    ~FeatureFileWriter();
+
+    /**
+     * Create the file and write its header.  The sample rate is that
+     * of the audio input, and the step size that used to run the
+     * plugin.  Return false if the file could not be opened.
+     */
+    bool open(std::string filename, int sampleRate, int stepSize,
+              const Vamp::Plugin::OutputDescriptor &output);
+
+    /**
+     * Return true if the file uses the column layout.
+     */
+    bool isColumnar() const { return m_columnar; }
+
+    /**
+     * Write a feature whose timestamp has been resolved to the given
+     * time, in a file using the record layout.
+     */
+    void writeFeature(const Vamp::RealTime &timestamp,
+                      const Vamp::Plugin::Feature &feature);
+
+    /**
+     * Write the values of a feature as the column for the given
+     * frame, in a file using the column layout.
+     */
+    void writeColumn(int frame, const std::vector<float> &values);
+
+    /**
+     * Write out everything still buffered and close the file.
+     * Return false if any write failed.
+     */
+    bool close();
+
+protected:
+    void putInt(unsigned int value);
+    void putFloat(float value);
+    void putString(const std::string &s);
+    void endChunk();
+    void flush(bool force);
+
+    std::ofstream m_file;
+    std::vector<char> m_buffer;
+    bool m_columnar;
+    int m_stepSize;
+    int m_binCount;
+    int m_chunkColumns;
+    int m_chunkFrame;
+    std::vector<float> m_chunk;
+};
+
+/**
+ * Read back a binary feature file written by FeatureFileWriter.
+ */
+class FeatureFileReader
+{
+public:
+    FeatureFileReader();
+    ~FeatureFileReader();
+
+    /**
+     * Open the file and read its header.  Return false if the file
+     * could not be opened or is not a feature file.
+     */
+    bool open(std::string filename);
+
+    int getSampleRate() const { return m_sampleRate; }
+    int getStepSize() const { return m_stepSize; }
+    bool isColumnar() const { return m_columnar; }
+
+    const Vamp::Plugin::OutputDescriptor &getOutputDescriptor() const {
+        return m_output;
+    }
+
+    /**
+     * Read the next feature, in either layout.  The feature is
+     * returned with its timestamp set.  Return false at the end of
+     * the file, or if the file is truncated (see hasError).
+     */
+    bool readFeature(Vamp::Plugin::Feature &feature);
+
+    /**
+     * Read the whole of the next chunk of a file using the column
+     * layout, returning its values one column after another and the
+     * frame of its first column.  This is much cheaper than reading
+     * the columns one feature at a time.  Return the number of
+     * columns read, or 0 at the end of the file or if the file does
+     * not use the column layout.  Must not be mixed with readFeature.
+     */
+    int readColumns(std::vector<float> &values, int &firstFrame);
+
+    /**
+     * Return true if the file ended part-way through a header, record
+     * or chunk, or gave a length running past its end.
+     */
+    bool hasError() const { return m_error; }
+
+protected:
+    bool getBytes(char *bytes, size_t n);
+    bool haveBytes(size_t count, size_t size);
+    bool getInt(unsigned int &value);
+    bool getFloat(float &value);
+    bool getString(std::string &s);
+    bool getFloats(std::vector<float> &values, size_t n);
+    bool readChunk(std::vector<float> &values);
+
+    std::ifstream m_file;
+    bool m_columnar;
+    bool m_error;
+    size_t m_remaining; // bytes not yet read from the file
+    int m_sampleRate;
+    int m_stepSize;
+    Vamp::Plugin::OutputDescriptor m_output;
+    std::vector<char> m_bytes;
+    std::vector<float> m_chunk;
+    int m_chunkColumns;
+    int m_chunkFrame;
+    int m_column; // next column of m_chunk for readFeature
+};
+
+#endif
@@ -0,0 +1,156 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _HOST_THREAD_H_
+#define _HOST_THREAD_H_
+
+/*
+ * The little threading that vamp-simple-host's batch mode needs,
+ * using pthreads or the Win32 API directly, so that the host depends
+ * only on the public host SDK.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <vector>
+
+class HostMutex
+{
+public:
+#ifdef _WIN32
+    HostMutex() { InitializeCriticalSection(&m_mutex); }
+    ~HostMutex() { DeleteCriticalSection(&m_mutex); }
+    void lock() { EnterCriticalSection(&m_mutex); }
+    void unlock() { LeaveCriticalSection(&m_mutex); }
+#else
+    HostMutex() { pthread_mutex_init(&m_mutex, 0); }
+    ~HostMutex() { pthread_mutex_destroy(&m_mutex); }
+    void lock() { pthread_mutex_lock(&m_mutex); }
+    void unlock() { pthread_mutex_unlock(&m_mutex); }
+#endif
+
+private:
+#ifdef _WIN32
+    CRITICAL_SECTION m_mutex;
+#else
+    pthread_mutex_t m_mutex;
+#endif
+
+    HostMutex(const HostMutex &); // not provided
+    HostMutex &operator=(const HostMutex &); // not provided
+};
+
+class HostMutexLocker
+{
+public:
+    HostMutexLocker(HostMutex *mutex) : m_mutex(mutex) { m_mutex->lock(); }
+    ~HostMutexLocker() { m_mutex->unlock(); }
+
+private:
+    HostMutex *m_mutex;
+
+    HostMutexLocker(const HostMutexLocker &); // not provided
+    HostMutexLocker &operator=(const HostMutexLocker &); // not provided
+};
+
+struct HostThreadCall
+{
+    void (*function)(void *);
+    void *arg;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI
+hostThreadStart(LPVOID call)
+{
+    static_cast<HostThreadCall *>(call)->function
+        (static_cast<HostThreadCall *>(call)->arg);
+    return 0;
+}
+#else
+static void *
+hostThreadStart(void *call)
+{
+    static_cast<HostThreadCall *>(call)->function
+        (static_cast<HostThreadCall *>(call)->arg);
+    return 0;
+}
+#endif
+
+/*
+ * Call function(arg) on the given number of threads at once, one of
+ * them being the calling thread, and return when every call has
+ * returned.  If a thread cannot be started, there are simply fewer
+ * calls, so the function should take its work from a shared queue.
+ */
+static void
+runOnThreads(void (*function)(void *), void *arg, int count)
+{
+    HostThreadCall call;
+    call.function = function;
+    call.arg = arg;
+
+#ifdef _WIN32
+    std::vector<HANDLE> threads;
+    for (int i = 1; i < count; ++i) {
+        HANDLE thread = CreateThread(0, 0, hostThreadStart, &call, 0, 0);
+        if (thread) threads.push_back(thread);
+    }
+    function(arg);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#else
+    std::vector<pthread_t> threads;
+    for (int i = 1; i < count; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, 0, hostThreadStart, &call) == 0) {
+            threads.push_back(thread);
+        }
+    }
+    function(arg);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        pthread_join(threads[i], 0);
+    }
+#endif
+}
+
+#endif
@@ -49,16 +49,25 @@
 #include <vamp-hostsdk/PluginHostAdapter.h>
 #include <vamp-hostsdk/PluginInputDomainAdapter.h>
 #include <vamp-hostsdk/PluginLoader.h>
+#include <vamp-hostsdk/MultiPluginRunner.h>
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <set>
+#include <map>
+#include <vector>
 #include <sndfile.h>
 
 #include <cstring>
 #include <cstdlib>
 
 #include "system.h"
+#include "FeatureFile.h"
+
+// The host SDK's private threading classes, used to run the files of
+// a batch concurrently
+#include "HostThread.h"
 
 #include <cmath>
 
@@ -70,8 +79,9 @@ using Vamp::RealTime;
 using Vamp::HostExt::PluginLoader;
 using Vamp::HostExt::PluginWrapper;
 using Vamp::HostExt::PluginInputDomainAdapter;
+using Vamp::HostExt::MultiPluginRunner;
 
-#define HOST_VERSION "1.5"
+#define HOST_VERSION "1.6"
 
 enum Verbosity {
     PluginIds,
@@ -82,7 +92,12 @@ enum Verbosity {
 
 void printFeatures(int, int,
                    const Plugin::OutputDescriptor &, int,
-                   const Plugin::FeatureSet &, ofstream *, bool frames);
+                   const Plugin::FeatureSet &, ostream *, bool frames,
+                   int &featureCount);
+void writeFeatures(int, int,
+                   const Plugin::OutputDescriptor &, int,
+                   const Plugin::FeatureSet &, FeatureFileWriter *,
+                   int &featureCount);
 void transformInput(float *, size_t);
 void fft(unsigned int, bool, double *, double *, double *, double *);
 void printPluginPath(bool verbose);
@@ -90,7 +105,10 @@ void printPluginCategoryList();
 void enumeratePlugins(Verbosity);
 void listPluginsInLibrary(string soname);
 int runPlugin(string myname, string soname, string id, string output,
-              int outputNo, string inputFile, string outfilename, bool frames);
+              int outputNo, string inputFile, string outfilename, bool frames,
+              bool binary);
+int runBatch(string myname, string manifest, int threads, bool frames,
+             bool binary);
 
 void usage(const char *name)
 {
@@ -100,8 +118,8 @@ void usage(const char *name)
         "Copyright 2006-2009 Chris Cannam and QMUL.\n"
         "Freely redistributable; published under a BSD-style license.\n\n"
         "Usage:\n\n"
-        "  " << name << " [-s] pluginlibrary[." << PLUGIN_SUFFIX << "]:plugin[:output] file.wav [-o out.txt]\n"
-        "  " << name << " [-s] pluginlibrary[." << PLUGIN_SUFFIX << "]:plugin file.wav [outputno] [-o out.txt]\n\n"
+        "  " << name << " [-s] [-b] pluginlibrary[." << PLUGIN_SUFFIX << "]:plugin[:output] file.wav [-o out.txt]\n"
+        "  " << name << " [-s] [-b] pluginlibrary[." << PLUGIN_SUFFIX << "]:plugin file.wav [outputno] [-o out.txt]\n\n"
         "    -- Load plugin id \"plugin\" from \"pluginlibrary\" and run it on the\n"
         "       audio data in \"file.wav\", retrieving the named \"output\", or output\n"
         "       number \"outputno\" (the first output by default) and dumping it to\n"
@@ -112,6 +130,22 @@ void usage(const char *name)
         "       If the -s option is given, results will be labelled with the audio\n"
         "       sample frame at which they occur. Otherwise, they will be labelled\n"
         "       with time in seconds.\n\n"
+        "       If the -b option is given, results will be written to \"out.txt\"\n"
+        "       in a compact binary format instead of as text (see host/FeatureFile.h\n"
+        "       for a description and a reader).  The -o option is then required.\n\n"
+        "  " << name << " [-s] [-b] [-t threads] --batch manifest.txt\n\n"
+        "    -- Run all of the jobs listed in \"manifest.txt\", one per line in the form\n\n"
+        "         file.wav pluginlibrary:plugin[:output] [param=value ...] [-o out.txt]\n\n"
+        "       where \"output\" may be an output identifier or number.  The jobs for\n"
+        "       each audio file are run together, reading the file only once.  Up to\n"
+        "       \"threads\" threads are used (1 by default), running several files at\n"
+        "       once and sharing any threads left over among the jobs for each file.\n"
+        "       Each plugin library is loaded once, and plugin instances are reused\n"
+        "       for later files when their parameters match.  The results are the\n"
+        "       same as from a single run of each job.  Those of jobs with no -o\n"
+        "       option are written to standard output in manifest order, each after\n"
+        "       a heading line starting \"#\"; with -b, every job must have an -o\n"
+        "       option.  Lines starting \"#\" in the manifest are ignored.\n\n"
         "  " << name << " -l\n"
         "  " << name << " --list\n\n"
         "    -- List the plugin libraries and Vamp plugins in the library search path\n"
@@ -195,13 +229,31 @@ int main(int argc, char **argv)
     if (argc < 3) usage(name);
 
     bool useFrames = false;
+    bool binary = false;
     
     int base = 1;
-    if (!strcmp(argv[1], "-s")) {
-        useFrames = true;
-        base = 2;
+    while (argc > base && (!strcmp(argv[base], "-s") ||
+                           !strcmp(argv[base], "-b"))) {
+        if (argv[base][1] == 's') useFrames = true;
+        else binary = true;
+        ++base;
+    }
+
+    int threads = 0;
+    if (argc > base + 1 && !strcmp(argv[base], "-t")) {
+        threads = atoi(argv[base + 1]);
+        if (threads < 1) usage(name);
+        base += 2;
+    }
+
+    if (argc > base && !strcmp(argv[base], "--batch")) {
+        if (argc != base + 2) usage(name);
+        return runBatch(name, argv[base + 1], max(threads, 1), useFrames,
+                        binary);
     }
 
+    if (threads > 0 || argc < base + 2) usage(name);
+
     string soname = argv[base];
     string wavname = argv[base+1];
     string plugid = "";
@@ -226,6 +278,11 @@ int main(int argc, char **argv)
         }
     }
 
+    if (binary && outfilename == "") {
+        cerr << name << ": ERROR: Binary output requires an output file (-o)" << endl;
+        return 1;
+    }
+
     cerr << endl << name << ": Running..." << endl;
 
     cerr << "Reading file: \"" << wavname << "\", writing to ";
@@ -261,13 +318,168 @@ int main(int argc, char **argv)
     }
 
     return runPlugin(name, soname, plugid, output, outputNo,
-                     wavname, outfilename, useFrames);
+                     wavname, outfilename, useFrames, binary);
+}
+
+
+void getStepAndBlockSize(Plugin *plugin, int &stepSize, int &blockSize)
+{
+    blockSize = plugin->getPreferredBlockSize();
+    stepSize = plugin->getPreferredStepSize();
+
+    if (blockSize == 0) {
+        blockSize = 1024;
+    }
+    if (stepSize == 0) {
+        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
+            stepSize = blockSize/2;
+        } else {
+            stepSize = blockSize;
+        }
+    } else if (stepSize > blockSize) {
+        cerr << "WARNING: stepSize " << stepSize << " > blockSize " << blockSize << ", resetting blockSize to ";
+        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
+            blockSize = stepSize * 2;
+        } else {
+            blockSize = stepSize;
+        }
+        cerr << blockSize << endl;
+    }
 }
 
+RealTime getTimestampAdjustment(Plugin *plugin)
+{
+    // See documentation for
+    // PluginInputDomainAdapter::getTimestampAdjustment
+    PluginWrapper *wrapper = dynamic_cast<PluginWrapper *>(plugin);
+    if (wrapper) {
+        PluginInputDomainAdapter *ida =
+            wrapper->getWrapper<PluginInputDomainAdapter>();
+        if (ida) return ida->getTimestampAdjustment();
+    }
+    return RealTime::zeroTime;
+}
+
+/*
+ * InputWindow holds a sliding window over the decoded audio, one
+ * de-interleaved buffer per channel, from which the blocks passed to
+ * the plugin are taken in place.  Each frame of the file is decoded
+ * and de-interleaved only once, however much the blocks overlap:
+ * advancing by a step just moves the start of the window, and new
+ * frames are read in large runs appended to the end of it.  The
+ * frames still needed are moved back to the start of the buffers
+ * only when the buffers fill up.
+ */
+class InputWindow
+{
+public:
+    InputWindow(SNDFILE *sndfile, int channels, int blockSize, int stepSize) :
+        m_sndfile(sndfile),
+        m_channels(channels),
+        m_blockSize(blockSize),
+        m_stepSize(stepSize),
+        m_readSize(max(stepSize, 16384)),
+        m_capacity(blockSize + m_readSize),
+        m_start(0),
+        m_end(0),
+        m_eof(false) {
+        m_filebuf = new float[m_readSize * channels];
+        m_buffers = new float*[channels];
+        m_block = new float*[channels];
+        for (int c = 0; c < channels; ++c) {
+            m_buffers[c] = new float[m_capacity];
+        }
+    }
+
+    ~InputWindow() {
+        for (int c = 0; c < m_channels; ++c) delete[] m_buffers[c];
+        delete[] m_buffers;
+        delete[] m_block;
+        delete[] m_filebuf;
+    }
+
+    /**
+     * Read whatever is needed to complete the block at the current
+     * position, padding with zeros past the end of the file.  Return
+     * the number of frames of the block that came from the file, or
+     * -1 if reading failed.
+     */
+    int fill() {
+
+        if (m_start + m_blockSize > m_capacity) compact();
+
+        while (!m_eof && m_end - m_start < m_blockSize) {
+
+            if (m_end == m_capacity) compact();
+
+            int want = min(m_readSize, m_capacity - m_end);
+            sf_count_t count = sf_readf_float(m_sndfile, m_filebuf, want);
+            if (count < 0) return -1;
+            if (count < want) m_eof = true;
+
+            for (int c = 0; c < m_channels; ++c) {
+                float *buf = m_buffers[c] + m_end;
+                for (int i = 0; i < int(count); ++i) {
+                    buf[i] = m_filebuf[i * m_channels + c];
+                }
+            }
+            m_end += int(count);
+        }
+
+        int available = min(m_end - m_start, m_blockSize);
+
+        for (int c = 0; c < m_channels; ++c) {
+            for (int i = available; i < m_blockSize; ++i) {
+                m_buffers[c][m_start + i] = 0.0f;
+            }
+            m_block[c] = m_buffers[c] + m_start;
+        }
+
+        return available;
+    }
+
+    /**
+     * Return the block filled by the last call to fill().
+     */
+    const float *const *getBuffers() const {
+        return m_block;
+    }
+
+    /**
+     * Move on by one step.
+     */
+    void advance() {
+        m_start += m_stepSize;
+        if (m_end < m_start) m_end = m_start; // past the end of the file
+    }
+
+private:
+    void compact() {
+        int held = m_end - m_start;
+        for (int c = 0; c < m_channels; ++c) {
+            memmove(m_buffers[c], m_buffers[c] + m_start, held * sizeof(float));
+        }
+        m_start = 0;
+        m_end = held;
+    }
+
+    SNDFILE *m_sndfile;
+    int m_channels;
+    int m_blockSize;
+    int m_stepSize;
+    int m_readSize;
+    int m_capacity;
+    int m_start; // start of the current block in m_buffers
+    int m_end; // end of the frames read so far in m_buffers
+    bool m_eof;
+    float *m_filebuf;
+    float **m_buffers;
+    float **m_block;
+};
 
 int runPlugin(string myname, string soname, string id,
               string output, int outputNo, string wavname,
-              string outfilename, bool useFrames)
+              string outfilename, bool useFrames, bool binary)
 {
     PluginLoader *loader = PluginLoader::getInstance();
 
@@ -285,7 +497,8 @@ int runPlugin(string myname, string soname, string id,
     }
 
     ofstream *out = 0;
-    if (outfilename != "") {
+    FeatureFileWriter *writer = 0;
+    if (outfilename != "" && !binary) {
         out = new ofstream(outfilename.c_str(), ios::out);
         if (!*out) {
             cerr << myname << ": ERROR: Failed to open output file \""
@@ -321,36 +534,14 @@ int runPlugin(string myname, string soname, string id,
     // un-adapted plugin, so we aren't doing that here.  See the
     // PluginBufferingAdapter documentation for details.
 
-    int blockSize = plugin->getPreferredBlockSize();
-    int stepSize = plugin->getPreferredStepSize();
-
-    if (blockSize == 0) {
-        blockSize = 1024;
-    }
-    if (stepSize == 0) {
-        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
-            stepSize = blockSize/2;
-        } else {
-            stepSize = blockSize;
-        }
-    } else if (stepSize > blockSize) {
-        cerr << "WARNING: stepSize " << stepSize << " > blockSize " << blockSize << ", resetting blockSize to ";
-        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
-            blockSize = stepSize * 2;
-        } else {
-            blockSize = stepSize;
-        }
-        cerr << blockSize << endl;
-    }
-    int overlapSize = blockSize - stepSize;
+    int blockSize, stepSize;
+    getStepAndBlockSize(plugin, stepSize, blockSize);
     sf_count_t currentStep = 0;
     int finalStepsRemaining = max(1, (blockSize / stepSize) - 1); // at end of file, this many part-silent frames needed after we hit EOF
 
     int channels = sfinfo.channels;
 
-    float *filebuf = new float[blockSize * channels];
-    float **plugbuf = new float*[channels];
-    for (int c = 0; c < channels; ++c) plugbuf[c] = new float[blockSize + 2];
+    InputWindow window(sndfile, channels, blockSize, stepSize);
 
     cerr << "Using block size = " << blockSize << ", step size = "
               << stepSize << endl;
@@ -371,8 +562,9 @@ int runPlugin(string myname, string soname, string id,
     int returnValue = 1;
     int progress = 0;
 
+    int featureCount = -1;
+
     RealTime rt;
-    PluginWrapper *wrapper = 0;
     RealTime adjustment = RealTime::zeroTime;
 
     if (outputs.empty()) {
@@ -405,6 +597,15 @@ int runPlugin(string myname, string soname, string id,
     od = outputs[outputNo];
     cerr << "Output is: \"" << od.identifier << "\"" << endl;
 
+    if (binary) {
+        writer = new FeatureFileWriter;
+        if (!writer->open(outfilename, sfinfo.samplerate, stepSize, od)) {
+            cerr << myname << ": ERROR: Failed to open output file \""
+                 << outfilename << "\" for writing" << endl;
+            goto done;
+        }
+    }
+
     if (!plugin->initialise(channels, stepSize, blockSize)) {
         cerr << "ERROR: Plugin initialise (channels = " << channels
              << ", stepSize = " << stepSize << ", blockSize = "
@@ -412,125 +613,685 @@ int runPlugin(string myname, string soname, string id,
         goto done;
     }
 
-    wrapper = dynamic_cast<PluginWrapper *>(plugin);
-    if (wrapper) {
-        // See documentation for
-        // PluginInputDomainAdapter::getTimestampAdjustment
-        PluginInputDomainAdapter *ida =
-            wrapper->getWrapper<PluginInputDomainAdapter>();
-        if (ida) adjustment = ida->getTimestampAdjustment();
-    }
+    adjustment = getTimestampAdjustment(plugin);
     
     // Here we iterate over the frames, avoiding asking the numframes in case it's streaming input.
     do {
 
-        int count;
-
-        if ((blockSize==stepSize) || (currentStep==0)) {
-            // read a full fresh block
-            if ((count = sf_readf_float(sndfile, filebuf, blockSize)) < 0) {
-                cerr << "ERROR: sf_readf_float failed: " << sf_strerror(sndfile) << endl;
-                break;
-            }
-            if (count != blockSize) --finalStepsRemaining;
-        } else {
-            //  otherwise shunt the existing data down and read the remainder.
-            memmove(filebuf, filebuf + (stepSize * channels), overlapSize * channels * sizeof(float));
-            if ((count = sf_readf_float(sndfile, filebuf + (overlapSize * channels), stepSize)) < 0) {
-                cerr << "ERROR: sf_readf_float failed: " << sf_strerror(sndfile) << endl;
-                break;
-            }
-            if (count != stepSize) --finalStepsRemaining;
-            count += overlapSize;
-        }
-
-        for (int c = 0; c < channels; ++c) {
-            int j = 0;
-            while (j < count) {
-                plugbuf[c][j] = filebuf[j * sfinfo.channels + c];
-                ++j;
-            }
-            while (j < blockSize) {
-                plugbuf[c][j] = 0.0f;
-                ++j;
-            }
+        int count = window.fill();
+        if (count < 0) {
+            cerr << "ERROR: sf_readf_float failed: " << sf_strerror(sndfile) << endl;
+            break;
         }
+        if (count < blockSize) --finalStepsRemaining;
 
         rt = RealTime::frame2RealTime(currentStep * stepSize, sfinfo.samplerate);
 
-        features = plugin->process(plugbuf, rt);
+        features = plugin->process(window.getBuffers(), rt);
         
-        printFeatures
-            (RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
-             sfinfo.samplerate, od, outputNo, features, out, useFrames);
+        if (writer) {
+            writeFeatures
+                (RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
+                 sfinfo.samplerate, od, outputNo, features, writer,
+                 featureCount);
+        } else {
+            printFeatures
+                (RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
+                 sfinfo.samplerate, od, outputNo, features, out, useFrames,
+                 featureCount);
+        }
 
         if (sfinfo.frames > 0){
             int pp = progress;
             progress = (int)((float(currentStep * stepSize) / sfinfo.frames) * 100.f + 0.5f);
-            if (progress != pp && out) {
+            if (progress != pp && (out || writer)) {
                 cerr << "\r" << progress << "%";
             }
         }
 
+        window.advance();
         ++currentStep;
 
     } while (finalStepsRemaining > 0);
 
-    if (out) cerr << "\rDone" << endl;
+    if (out || writer) cerr << "\rDone" << endl;
 
     rt = RealTime::frame2RealTime(currentStep * stepSize, sfinfo.samplerate);
 
     features = plugin->getRemainingFeatures();
     
-    printFeatures(RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
-                  sfinfo.samplerate, od, outputNo, features, out, useFrames);
+    if (writer) {
+        writeFeatures(RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
+                      sfinfo.samplerate, od, outputNo, features, writer,
+                      featureCount);
+    } else {
+        printFeatures(RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
+                      sfinfo.samplerate, od, outputNo, features, out, useFrames,
+                      featureCount);
+    }
 
     returnValue = 0;
 
+    if (writer && !writer->close()) {
+        cerr << "ERROR: Failed to write output file \"" << outfilename
+             << "\"" << endl;
+        returnValue = 1;
+    }
+
 done:
     delete plugin;
     if (out) {
         out->close();
         delete out;
     }
+    delete writer;
     sf_close(sndfile);
     return returnValue;
 }
 
+struct BatchJob
+{
+    string wavname;
+    string spec; // plugin and output as given in the manifest
+    string soname;
+    string id;
+    string output;
+    int outputNo;
+    map<string, float> parameters;
+    string outfilename;
+};
+
+struct BatchInstance
+{
+    string config; // plugin key, parameters and input format
+    Plugin *plugin;
+    int stepSize;
+    int blockSize;
+    RealTime adjustment;
+};
+
+struct BatchOutput
+{
+    const BatchJob *job;
+    int instance; // index in the runner
+    int outputNo;
+    Plugin::OutputDescriptor od;
+    ostream *out;
+    FeatureFileWriter *writer; // instead of out, for binary output
+    bool toStdout;
+    int featureCount;
+};
+
+struct BatchFile
+{
+    string wavname;
+    vector<const BatchJob *> jobs;
+    ostringstream out; // standard output, printed in manifest order
+    ostringstream log; // messages, likewise
+    int returnValue;
+    bool done;
+};
+
+struct BatchContext
+{
+    string myname;
+    int threads; // for each file's runner
+    bool useFrames;
+    bool binary;
+
+    // The loader is created before any file is started.  Instances
+    // left idle by earlier files are reused for later ones.  The
+    // mutex guards those and also serialises our use of the loader,
+    // which is not thread-safe
+    PluginLoader *loader;
+    HostMutex loaderMutex;
+    vector<BatchInstance> idle;
+
+    vector<BatchFile *> files;
+    HostMutex fileMutex; // for started, printed and the done flags
+    size_t started; // files that a thread has taken
+    size_t printed; // files whose output has been printed
+};
+
+static bool
+parseBatchJob(string line, BatchJob &job)
+{
+    istringstream in(line);
+    vector<string> tokens;
+    string token;
+    while (in >> token) tokens.push_back(token);
+
+    if (tokens.size() < 2) return false;
+
+    job.wavname = tokens[0];
+    job.spec = tokens[1];
+    job.outputNo = -1;
+
+    string::size_type sep = job.spec.find(':');
+    if (sep == string::npos) return false;
+
+    job.soname = job.spec.substr(0, sep);
+    job.id = job.spec.substr(sep + 1);
+
+    sep = job.id.find(':');
+    if (sep != string::npos) {
+        job.output = job.id.substr(sep + 1);
+        job.id = job.id.substr(0, sep);
+    }
+
+    if (job.id == "") return false;
+
+    if (job.output == "") {
+        job.outputNo = 0;
+    } else if (job.output.find_first_not_of("0123456789") == string::npos) {
+        job.outputNo = atoi(job.output.c_str());
+        job.output = "";
+    }
+
+    for (size_t i = 2; i < tokens.size(); ++i) {
+        if (tokens[i] == "-o") {
+            if (i + 1 == tokens.size()) return false;
+            job.outfilename = tokens[++i];
+            continue;
+        }
+        sep = tokens[i].find('=');
+        if (sep == string::npos || sep == 0) return false;
+        job.parameters[tokens[i].substr(0, sep)] =
+            float(atof(tokens[i].substr(sep + 1).c_str()));
+    }
+
+    return true;
+}
+
+static bool
+createBatchInstance(const BatchJob &job, PluginLoader::PluginKey key,
+                    int sampleRate, int channels, BatchInstance &instance,
+                    ostream &log)
+{
+    PluginLoader *loader = PluginLoader::getInstance();
+
+    Plugin *plugin = loader->loadPlugin
+        (key, sampleRate, PluginLoader::ADAPT_ALL_SAFE);
+    if (!plugin) {
+        log << "ERROR: Failed to load plugin \"" << job.id
+             << "\" from library \"" << job.soname << "\"" << endl;
+        return false;
+    }
+
+    Plugin::ParameterList params = plugin->getParameterDescriptors();
+
+    for (map<string, float>::const_iterator i = job.parameters.begin();
+         i != job.parameters.end(); ++i) {
+        bool found = false;
+        for (size_t j = 0; j < params.size(); ++j) {
+            if (params[j].identifier == i->first) found = true;
+        }
+        if (!found) {
+            log << "WARNING: Plugin \"" << job.id << "\" has no parameter \""
+                 << i->first << "\"" << endl;
+        }
+        plugin->setParameter(i->first, i->second);
+    }
+
+    int blockSize, stepSize;
+    getStepAndBlockSize(plugin, stepSize, blockSize);
+
+    if (!plugin->initialise(channels, stepSize, blockSize)) {
+        log << "ERROR: Plugin initialise (channels = " << channels
+             << ", stepSize = " << stepSize << ", blockSize = "
+             << blockSize << ") failed." << endl;
+        delete plugin;
+        return false;
+    }
+
+    instance.plugin = plugin;
+    instance.stepSize = stepSize;
+    instance.blockSize = blockSize;
+    instance.adjustment = getTimestampAdjustment(plugin);
+    return true;
+}
+
+static void
+printBatchFeatures(MultiPluginRunner &runner, int sampleRate,
+                   const vector<BatchInstance> &instances,
+                   vector<BatchOutput> &outputs, bool useFrames)
+{
+    for (int i = 0; i < int(instances.size()); ++i) {
+
+        MultiPluginRunner::BlockFrameSet blockFrames;
+        Plugin::FeatureSet features = runner.takeFeatures(i, blockFrames);
+        if (features.empty()) continue;
+
+        for (size_t oi = 0; oi < outputs.size(); ++oi) {
+
+            BatchOutput &o = outputs[oi];
+            if (o.instance != i) continue;
+
+            Plugin::FeatureSet::const_iterator fi = features.find(o.outputNo);
+            if (fi == features.end()) continue;
+
+            const vector<size_t> &frames = blockFrames[o.outputNo];
+
+            // Pass each feature on with the frame of the block it was
+            // returned for, as runPlugin does, so that features without
+            // timestamps are placed just as they are in a single run
+            for (size_t j = 0; j < fi->second.size(); ++j) {
+                Plugin::FeatureSet single;
+                single[o.outputNo].push_back(fi->second[j]);
+                RealTime rt = RealTime::frame2RealTime
+                    (long(frames[j]), sampleRate);
+                int frame = RealTime::realTime2Frame
+                    (rt + instances[i].adjustment, sampleRate);
+                if (o.writer) {
+                    writeFeatures(frame, sampleRate, o.od, o.outputNo, single,
+                                  o.writer, o.featureCount);
+                } else {
+                    printFeatures(frame, sampleRate, o.od, o.outputNo, single,
+                                  o.out, useFrames, o.featureCount);
+                }
+            }
+        }
+    }
+}
+
+static int
+runBatchFile(BatchContext &context, BatchFile &file)
+{
+    PluginLoader *loader = context.loader;
+
+    const string &myname = context.myname;
+    const string &wavname = file.wavname;
+    const vector<const BatchJob *> &jobs = file.jobs;
+    bool binary = context.binary;
+    ostream &log = file.log;
+
+    SNDFILE *sndfile;
+    SF_INFO sfinfo;
+    memset(&sfinfo, 0, sizeof(SF_INFO));
+
+    sndfile = sf_open(wavname.c_str(), SFM_READ, &sfinfo);
+    if (!sndfile) {
+        log << myname << ": ERROR: Failed to open input file \""
+             << wavname << "\": " << sf_strerror(sndfile) << endl;
+        return 1;
+    }
+
+    int sampleRate = sfinfo.samplerate;
+    int channels = sfinfo.channels;
+    int returnValue = 0;
+
+    MultiPluginRunner runner(channels, context.threads);
+    vector<BatchInstance> instances;
+    vector<BatchOutput> outputs;
+
+    for (size_t ji = 0; ji < jobs.size(); ++ji) {
+
+        const BatchJob &job = *jobs[ji];
+
+        PluginLoader::PluginKey key =
+            loader->composePluginKey(job.soname, job.id);
+
+        ostringstream config;
+        config << key << " " << sampleRate << " " << channels;
+        for (map<string, float>::const_iterator i = job.parameters.begin();
+             i != job.parameters.end(); ++i) {
+            config << " " << i->first << "=" << i->second;
+        }
+
+        // Jobs on the same file with the same configuration share an
+        // instance; otherwise reuse an idle one from an earlier file
+        // if we can
+
+        int index = -1;
+        for (size_t i = 0; i < instances.size(); ++i) {
+            if (instances[i].config == config.str()) {
+                index = int(i);
+                break;
+            }
+        }
+
+        if (index < 0) {
+
+            BatchInstance instance;
+            bool found = false;
+            bool created = false;
+
+            {
+                HostMutexLocker locker(&context.loaderMutex);
+
+                vector<BatchInstance> &idle = context.idle;
+                for (size_t i = 0; i < idle.size(); ++i) {
+                    if (idle[i].config == config.str()) {
+                        instance = idle[i];
+                        idle.erase(idle.begin() + i);
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!found) {
+                    created = createBatchInstance(job, key, sampleRate,
+                                                  channels, instance, log);
+                    instance.config = config.str();
+                }
+            }
+
+            if (!found && !created) {
+                returnValue = 1;
+                continue;
+            }
+
+            if (found) {
+                instance.plugin->reset();
+            }
+
+            if (runner.addInitialisedPlugin(instance.plugin,
+                                            instance.stepSize,
+                                            instance.blockSize) < 0) {
+                HostMutexLocker locker(&context.loaderMutex);
+                delete instance.plugin;
+                returnValue = 1;
+                continue;
+            }
+
+            index = int(instances.size());
+            instances.push_back(instance);
+        }
+
+        Plugin::OutputList list =
+            instances[index].plugin->getOutputDescriptors();
+
+        BatchOutput o;
+        o.job = &job;
+        o.instance = index;
+        o.outputNo = job.outputNo;
+
+        if (o.outputNo < 0) {
+            for (size_t oi = 0; oi < list.size(); ++oi) {
+                if (list[oi].identifier == job.output) {
+                    o.outputNo = int(oi);
+                    break;
+                }
+            }
+            if (o.outputNo < 0) {
+                log << "ERROR: Non-existent output \"" << job.output << "\" requested for plugin \"" << job.id << "\"" << endl;
+                returnValue = 1;
+                continue;
+            }
+        } else if (int(list.size()) <= o.outputNo) {
+            log << "ERROR: Output " << o.outputNo << " requested, but plugin \"" << job.id << "\" has only " << list.size() << " output(s)" << endl;
+            returnValue = 1;
+            continue;
+        }
+
+        o.od = list[o.outputNo];
+        o.featureCount = -1;
+        o.toStdout = (job.outfilename == "");
+        o.out = 0;
+        o.writer = 0;
+
+        if (binary) {
+            if (o.toStdout) {
+                log << "ERROR: Binary output requires an output file (-o) for job \"" << job.spec << "\"" << endl;
+                returnValue = 1;
+                continue;
+            }
+            FeatureFileWriter *writer = new FeatureFileWriter;
+            if (!writer->open(job.outfilename, sampleRate,
+                              instances[index].stepSize, o.od)) {
+                log << myname << ": ERROR: Failed to open output file \""
+                     << job.outfilename << "\" for writing" << endl;
+                delete writer;
+                returnValue = 1;
+                continue;
+            }
+            o.writer = writer;
+        } else if (o.toStdout) {
+            o.out = new ostringstream;
+        } else {
+            ofstream *out = new ofstream(job.outfilename.c_str(), ios::out);
+            if (!*out) {
+                log << myname << ": ERROR: Failed to open output file \""
+                     << job.outfilename << "\" for writing" << endl;
+                delete out;
+                returnValue = 1;
+                continue;
+            }
+            o.out = out;
+        }
+
+        outputs.push_back(o);
+    }
+
+    log << "Running " << outputs.size() << " job(s) on file \""
+         << wavname << "\"..." << endl;
+
+    const int frames = 16384;
+    float *filebuf = new float[frames * channels];
+    float **buffers = new float*[channels];
+    for (int c = 0; c < channels; ++c) buffers[c] = new float[frames];
+
+    while (!outputs.empty()) {
+
+        sf_count_t count = sf_readf_float(sndfile, filebuf, frames);
+        if (count < 0) {
+            log << "ERROR: sf_readf_float failed: " << sf_strerror(sndfile) << endl;
+            returnValue = 1;
+            break;
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            for (int i = 0; i < int(count); ++i) {
+                buffers[c][i] = filebuf[i * channels + c];
+            }
+        }
+
+        runner.process(buffers, size_t(count));
+        printBatchFeatures(runner, sampleRate, instances, outputs,
+                           context.useFrames);
+
+        if (count < frames) break;
+    }
+
+    // The runner processes the same blocks at the end of the file as
+    // runPlugin does, so the results match those of a single run
+    runner.finish();
+    printBatchFeatures(runner, sampleRate, instances, outputs,
+                       context.useFrames);
+
+    for (size_t oi = 0; oi < outputs.size(); ++oi) {
+        if (outputs[oi].toStdout) {
+            file.out << "# " << wavname << " " << outputs[oi].job->spec << endl
+                 << static_cast<ostringstream *>(outputs[oi].out)->str();
+        }
+        if (outputs[oi].writer && !outputs[oi].writer->close()) {
+            log << "ERROR: Failed to write output file \""
+                 << outputs[oi].job->outfilename << "\"" << endl;
+            returnValue = 1;
+        }
+        delete outputs[oi].out;
+        delete outputs[oi].writer;
+    }
+
+    for (int c = 0; c < channels; ++c) delete[] buffers[c];
+    delete[] buffers;
+    delete[] filebuf;
+
+    // The runner has finished with the instances, which can now be
+    // reused for later files
+    {
+        HostMutexLocker locker(&context.loaderMutex);
+        context.idle.insert(context.idle.end(),
+                            instances.begin(), instances.end());
+    }
+
+    sf_close(sndfile);
+    return returnValue;
+}
+
+static void
+runBatchFiles(void *arg)
+{
+    // Each batch thread takes the next file in the manifest until
+    // there are none left
+
+    BatchContext &context = *static_cast<BatchContext *>(arg);
+
+    while (true) {
+
+        size_t index;
+        {
+            HostMutexLocker locker(&context.fileMutex);
+            if (context.started == context.files.size()) return;
+            index = context.started++;
+        }
+
+        BatchFile &file = *context.files[index];
+        file.returnValue = runBatchFile(context, file);
+
+        // Print the output of this file and of any following ones
+        // that are already complete, so that it all appears in
+        // manifest order
+
+        HostMutexLocker locker(&context.fileMutex);
+        file.done = true;
+
+        while (context.printed < context.files.size() &&
+               context.files[context.printed]->done) {
+            BatchFile &f = *context.files[context.printed];
+            cerr << f.log.str();
+            cout << f.out.str();
+            f.log.str("");
+            f.out.str("");
+            ++context.printed;
+        }
+    }
+}
+
+int runBatch(string myname, string manifest, int threads, bool useFrames,
+             bool binary)
+{
+    ifstream in(manifest.c_str());
+    if (!in) {
+        cerr << myname << ": ERROR: Failed to open manifest file \""
+             << manifest << "\"" << endl;
+        return 1;
+    }
+
+    vector<BatchJob> jobs;
+    vector<string> files; // in order of first appearance
+    set<string> seen;
+
+    string line;
+    int lineNo = 0;
+
+    while (getline(in, line)) {
+        ++lineNo;
+        string::size_type first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') continue;
+        BatchJob job;
+        if (!parseBatchJob(line, job)) {
+            cerr << myname << ": ERROR: Invalid job at line " << lineNo
+                 << " of manifest \"" << manifest << "\"" << endl;
+            return 1;
+        }
+        if (seen.find(job.wavname) == seen.end()) {
+            seen.insert(job.wavname);
+            files.push_back(job.wavname);
+        }
+        jobs.push_back(job);
+    }
+
+    map<string, vector<const BatchJob *> > fileJobs;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        fileJobs[jobs[i].wavname].push_back(&jobs[i]);
+    }
+
+    cerr << endl << myname << ": Running " << jobs.size() << " job(s) on "
+         << files.size() << " file(s) using " << threads << " thread(s)"
+         << endl;
+
+    // Run as many files at once as we have threads for, each file's
+    // runner sharing out any threads left over among its plugins
+
+    int fileThreads = max(1, min(threads, int(files.size())));
+
+    BatchContext context;
+    context.myname = myname;
+    context.loader = PluginLoader::getInstance();
+    context.threads = max(1, threads / fileThreads);
+    context.useFrames = useFrames;
+    context.binary = binary;
+    context.started = 0;
+    context.printed = 0;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        BatchFile *file = new BatchFile;
+        file->wavname = files[i];
+        file->jobs = fileJobs[files[i]];
+        file->returnValue = 0;
+        file->done = false;
+        context.files.push_back(file);
+    }
+
+    runOnThreads(runBatchFiles, &context, fileThreads);
+
+    int returnValue = 0;
+
+    for (size_t i = 0; i < context.files.size(); ++i) {
+        if (context.files[i]->returnValue) returnValue = 1;
+        delete context.files[i];
+    }
+
+    for (size_t i = 0; i < context.idle.size(); ++i) {
+        delete context.idle[i].plugin;
+    }
+
+    return returnValue;
+}
+
 static double
 toSeconds(const RealTime &time)
 {
     return time.sec + double(time.nsec + 1) / 1000000000.0;
 }
 
+// Find the time of a feature that has its own timestamp, or that is
+// numbered from the last one for FixedSampleRate outputs.  Return
+// false if the feature's time is that of the block it came from.
+static bool
+getFeatureTime(const Plugin::OutputDescriptor &output,
+               const Plugin::Feature &f, int &featureCount, RealTime &rt)
+{
+    if (output.sampleType == Plugin::OutputDescriptor::VariableSampleRate) {
+        rt = f.timestamp;
+        return true;
+    } else if (output.sampleType == Plugin::OutputDescriptor::FixedSampleRate) {
+        int n = featureCount + 1;
+        if (f.hasTimestamp) {
+            n = int(round(toSeconds(f.timestamp) * output.sampleRate));
+        }
+        rt = RealTime::fromSeconds(double(n) / output.sampleRate);
+        featureCount = n;
+        return true;
+    }
+    return false;
+}
+
 void
 printFeatures(int frame, int sr,
               const Plugin::OutputDescriptor &output, int outputNo,
-              const Plugin::FeatureSet &features, ofstream *out, bool useFrames)
+              const Plugin::FeatureSet &features, ostream *out, bool useFrames,
+              int &featureCount)
 {
-    static int featureCount = -1;
-    
     if (features.find(outputNo) == features.end()) return;
     
     for (size_t i = 0; i < features.at(outputNo).size(); ++i) {
 
         const Plugin::Feature &f = features.at(outputNo).at(i);
 
-        bool haveRt = false;
         RealTime rt;
-
-        if (output.sampleType == Plugin::OutputDescriptor::VariableSampleRate) {
-            rt = f.timestamp;
-            haveRt = true;
-        } else if (output.sampleType == Plugin::OutputDescriptor::FixedSampleRate) {
-            int n = featureCount + 1;
-            if (f.hasTimestamp) {
-                n = int(round(toSeconds(f.timestamp) * output.sampleRate));
-            }
-            rt = RealTime::fromSeconds(double(n) / output.sampleRate);
-            haveRt = true;
-            featureCount = n;
-        }
+        bool haveRt = getFeatureTime(output, f, featureCount, rt);
         
         if (useFrames) {
 
@@ -574,6 +1335,32 @@ printFeatures(int frame, int sr,
     }
 }
 
+void
+writeFeatures(int frame, int sr,
+              const Plugin::OutputDescriptor &output, int outputNo,
+              const Plugin::FeatureSet &features, FeatureFileWriter *writer,
+              int &featureCount)
+{
+    if (features.find(outputNo) == features.end()) return;
+
+    for (size_t i = 0; i < features.at(outputNo).size(); ++i) {
+
+        const Plugin::Feature &f = features.at(outputNo).at(i);
+
+        if (writer->isColumnar()) {
+            writer->writeColumn(frame, f.values);
+            continue;
+        }
+
+        RealTime rt;
+        if (!getFeatureTime(output, f, featureCount, rt)) {
+            rt = RealTime::frame2RealTime(frame, sr);
+        }
+
+        writer->writeFeature(rt, f);
+    }
+}
+
 void
 printPluginPath(bool verbose)
 {
@@ -0,0 +1,590 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include <vamp-hostsdk/ChunkedPluginRunner.h>
+
+#include "Thread.h"
+
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+_VAMP_SDK_HOSTSPACE_BEGIN(ChunkedPluginRunner.cpp)
+
+namespace Vamp {
+
+namespace HostExt {
+
+class ChunkedPluginRunner::Impl
+{
+public:
+    Impl(PluginLoader::PluginKey key, float inputSampleRate, int adapterFlags);
+    ~Impl();
+
+    void setParameter(std::string name, float value);
+    void selectProgram(std::string program);
+    void setThreadCount(int threads);
+    void setChunkSize(size_t frames);
+    void setWarmUpFrames(size_t frames);
+
+    bool run(Source &source, size_t stepSize, size_t blockSize);
+
+    Plugin::OutputList getOutputDescriptors() const;
+    size_t getStepSize() const;
+    size_t getBlockSize() const;
+    int getChunkCount() const;
+
+    Plugin::FeatureSet takeFeatures();
+
+protected:
+    class ChunkTask : public ThreadPool::Task
+    {
+    public:
+        ChunkTask(Impl *impl, size_t chunk) :
+            m_impl(impl), m_chunk(chunk) { }
+        void perform() {
+            m_impl->runChunk(m_chunk);
+        }
+    private:
+        Impl *m_impl;
+        size_t m_chunk;
+    };
+    friend class ChunkTask;
+
+    PluginLoader::PluginKey m_key;
+    float m_inputSampleRate;
+    int m_adapterFlags;
+    std::string m_program;
+    std::vector<std::pair<std::string, float> > m_parameters;
+    int m_threads;
+    size_t m_chunkSize;
+    size_t m_minWarmUp;
+
+    // Settings and results for the current or last run
+    Source *m_source;
+    size_t m_channels;
+    size_t m_stepSize;
+    size_t m_blockSize;
+    size_t m_frameCount;
+    size_t m_blockCount;
+    size_t m_chunkBlocks;  // blocks belonging to each chunk
+    size_t m_warmUpBlocks; // blocks processed before each chunk
+    size_t m_chunkCount;
+    bool m_failed;
+    Plugin::OutputList m_outputs;
+    std::vector<Plugin::FeatureSet> m_chunkFeatures;
+    Plugin::FeatureSet m_features;
+
+    // Initialised plugin instances not currently processing a
+    // chunk. Both these and the loader are guarded by m_pluginMutex
+    std::vector<Plugin *> m_idle;
+    Mutex m_pluginMutex;
+    Mutex m_sourceMutex;
+
+    Plugin *loadPlugin();
+    bool initialisePlugin(Plugin *plugin);
+    Plugin *acquirePlugin();
+    void releasePlugin(Plugin *plugin);
+    void deletePlugins();
+    void runChunk(size_t chunk);
+};
+
+ChunkedPluginRunner::ChunkedPluginRunner(PluginLoader::PluginKey key,
+                                         float inputSampleRate,
+                                         int adapterFlags)
+{
+    m_impl = new Impl(key, inputSampleRate, adapterFlags);
+}
+
+ChunkedPluginRunner::~ChunkedPluginRunner()
+{
+    delete m_impl;
+}
+
+void
+ChunkedPluginRunner::setParameter(std::string name, float value)
+{
+    m_impl->setParameter(name, value);
+}
+
+void
+ChunkedPluginRunner::selectProgram(std::string program)
+{
+    m_impl->selectProgram(program);
+}
+
+void
+ChunkedPluginRunner::setThreadCount(int threads)
+{
+    m_impl->setThreadCount(threads);
+}
+
+void
+ChunkedPluginRunner::setChunkSize(size_t frames)
+{
+    m_impl->setChunkSize(frames);
+}
+
+void
+ChunkedPluginRunner::setWarmUpFrames(size_t frames)
+{
+    m_impl->setWarmUpFrames(frames);
+}
+
+bool
+ChunkedPluginRunner::run(Source &source, size_t stepSize, size_t blockSize)
+{
+    return m_impl->run(source, stepSize, blockSize);
+}
+
+Plugin::OutputList
+ChunkedPluginRunner::getOutputDescriptors() const
+{
+    return m_impl->getOutputDescriptors();
+}
+
+size_t
+ChunkedPluginRunner::getStepSize() const
+{
+    return m_impl->getStepSize();
+}
+
+size_t
+ChunkedPluginRunner::getBlockSize() const
+{
+    return m_impl->getBlockSize();
+}
+
+int
+ChunkedPluginRunner::getChunkCount() const
+{
+    return m_impl->getChunkCount();
+}
+
+Plugin::FeatureSet
+ChunkedPluginRunner::takeFeatures()
+{
+    return m_impl->takeFeatures();
+}
+
+ChunkedPluginRunner::Impl::Impl(PluginLoader::PluginKey key,
+                                float inputSampleRate,
+                                int adapterFlags) :
+    m_key(key),
+    m_inputSampleRate(inputSampleRate),
+    m_adapterFlags(adapterFlags),
+    m_threads(1),
+    m_chunkSize(1048576),
+    m_minWarmUp(0),
+    m_source(0),
+    m_channels(0),
+    m_stepSize(0),
+    m_blockSize(0),
+    m_frameCount(0),
+    m_blockCount(0),
+    m_chunkBlocks(0),
+    m_warmUpBlocks(0),
+    m_chunkCount(0),
+    m_failed(false)
+{
+}
+
+ChunkedPluginRunner::Impl::~Impl()
+{
+    deletePlugins();
+}
+
+void
+ChunkedPluginRunner::Impl::setParameter(std::string name, float value)
+{
+    for (size_t i = 0; i < m_parameters.size(); ++i) {
+        if (m_parameters[i].first == name) {
+            m_parameters[i].second = value;
+            return;
+        }
+    }
+    m_parameters.push_back(std::pair<std::string, float>(name, value));
+}
+
+void
+ChunkedPluginRunner::Impl::selectProgram(std::string program)
+{
+    m_program = program;
+}
+
+void
+ChunkedPluginRunner::Impl::setThreadCount(int threads)
+{
+    m_threads = (threads > 1 ? threads : 1);
+}
+
+void
+ChunkedPluginRunner::Impl::setChunkSize(size_t frames)
+{
+    m_chunkSize = frames;
+}
+
+void
+ChunkedPluginRunner::Impl::setWarmUpFrames(size_t frames)
+{
+    m_minWarmUp = frames;
+}
+
+Plugin *
+ChunkedPluginRunner::Impl::loadPlugin()
+{
+    // called with m_pluginMutex held
+    
+    Plugin *plugin = PluginLoader::getInstance()->loadPlugin
+        (m_key, m_inputSampleRate, m_adapterFlags);
+
+    if (!plugin) {
+        std::cerr << "ChunkedPluginRunner: ERROR: Failed to load plugin \""
+                  << m_key << "\"" << std::endl;
+        return 0;
+    }
+
+    if (m_program != "") {
+        plugin->selectProgram(m_program);
+    }
+    for (size_t i = 0; i < m_parameters.size(); ++i) {
+        plugin->setParameter(m_parameters[i].first, m_parameters[i].second);
+    }
+
+    return plugin;
+}
+
+bool
+ChunkedPluginRunner::Impl::initialisePlugin(Plugin *plugin)
+{
+    if (!plugin->initialise(m_channels, m_stepSize, m_blockSize)) {
+        std::cerr << "ChunkedPluginRunner: ERROR: Plugin initialise (channels = " << m_channels << ", stepSize = " << m_stepSize << ", blockSize = " << m_blockSize << ") failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Plugin *
+ChunkedPluginRunner::Impl::acquirePlugin()
+{
+    MutexLocker locker(&m_pluginMutex);
+
+    if (!m_idle.empty()) {
+        Plugin *plugin = m_idle.back();
+        m_idle.pop_back();
+        plugin->reset();
+        return plugin;
+    }
+
+    Plugin *plugin = loadPlugin();
+    if (!plugin) return 0;
+
+    if (!initialisePlugin(plugin)) {
+        delete plugin;
+        return 0;
+    }
+
+    return plugin;
+}
+
+void
+ChunkedPluginRunner::Impl::releasePlugin(Plugin *plugin)
+{
+    MutexLocker locker(&m_pluginMutex);
+    m_idle.push_back(plugin);
+}
+
+void
+ChunkedPluginRunner::Impl::deletePlugins()
+{
+    MutexLocker locker(&m_pluginMutex);
+    for (size_t i = 0; i < m_idle.size(); ++i) {
+        delete m_idle[i];
+    }
+    m_idle.clear();
+}
+
+bool
+ChunkedPluginRunner::Impl::run(Source &source,
+                               size_t stepSize,
+                               size_t blockSize)
+{
+    // Instances from an earlier run may have been initialised
+    // differently
+    deletePlugins();
+
+    m_features.clear();
+    m_chunkFeatures.clear();
+    m_outputs.clear();
+    m_chunkCount = 0;
+    m_failed = false;
+
+    m_channels = source.getChannelCount();
+    if (m_channels == 0) {
+        std::cerr << "ChunkedPluginRunner::run: ERROR: Source has no channels"
+                  << std::endl;
+        return false;
+    }
+
+    Plugin *plugin = 0;
+    {
+        MutexLocker locker(&m_pluginMutex);
+        plugin = loadPlugin();
+    }
+    if (!plugin) return false;
+
+    // The same defaults as vamp-simple-host
+    
+    if (blockSize == 0) blockSize = plugin->getPreferredBlockSize();
+    if (stepSize == 0) stepSize = plugin->getPreferredStepSize();
+
+    if (blockSize == 0) {
+        blockSize = 1024;
+    }
+    if (stepSize == 0) {
+        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
+            stepSize = blockSize/2;
+        } else {
+            stepSize = blockSize;
+        }
+    } else if (stepSize > blockSize) {
+        std::cerr << "ChunkedPluginRunner::run: WARNING: stepSize " << stepSize << " > blockSize " << blockSize << ", resetting blockSize to ";
+        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
+            blockSize = stepSize * 2;
+        } else {
+            blockSize = stepSize;
+        }
+        std::cerr << blockSize << std::endl;
+    }
+
+    m_stepSize = stepSize;
+    m_blockSize = blockSize;
+
+    if (!initialisePlugin(plugin)) {
+        MutexLocker locker(&m_pluginMutex);
+        delete plugin;
+        return false;
+    }
+
+    m_outputs = plugin->getOutputDescriptors();
+
+    m_source = &source;
+    m_frameCount = source.getFrameCount();
+
+    // As vamp-simple-host and MultiPluginRunner do, we process every
+    // complete block of the input followed by blockSize / stepSize - 1
+    // blocks (but at least one) that are partly or wholly padding
+    size_t complete = 0;
+    if (m_frameCount >= m_blockSize) {
+        complete = (m_frameCount - m_blockSize) / m_stepSize + 1;
+    }
+    size_t padded = m_blockSize / m_stepSize;
+    m_blockCount = complete + (padded > 2 ? padded - 1 : 1);
+
+    int warmUp = plugin->getWarmUpFrames();
+
+    if (warmUp < 0) {
+        m_chunkBlocks = m_blockCount;
+        m_warmUpBlocks = 0;
+    } else {
+        size_t frames = size_t(warmUp);
+        if (frames < m_minWarmUp) frames = m_minWarmUp;
+        m_warmUpBlocks = (frames + m_stepSize - 1) / m_stepSize;
+        m_chunkBlocks = (m_chunkSize + m_stepSize - 1) / m_stepSize;
+    }
+    if (m_chunkBlocks == 0) m_chunkBlocks = 1;
+
+    // There is always at least one chunk, as the last chunk is the
+    // one that calls getRemainingFeatures
+    m_chunkCount = (m_blockCount + m_chunkBlocks - 1) / m_chunkBlocks;
+    if (m_chunkCount == 0) m_chunkCount = 1;
+
+    releasePlugin(plugin);
+
+    m_chunkFeatures.resize(m_chunkCount);
+
+    std::vector<ChunkTask> chunkTasks;
+    for (size_t c = 0; c < m_chunkCount; ++c) {
+        chunkTasks.push_back(ChunkTask(this, c));
+    }
+    std::vector<ThreadPool::Task *> tasks;
+    for (size_t c = 0; c < m_chunkCount; ++c) {
+        tasks.push_back(&chunkTasks[c]);
+    }
+
+    int workers = m_threads - 1; // the calling thread joins in
+    if (workers > int(m_chunkCount) - 1) workers = int(m_chunkCount) - 1;
+    
+    ThreadPool pool(workers);
+    pool.run(tasks);
+
+    m_source = 0;
+
+    if (m_failed) {
+        m_chunkFeatures.clear();
+        return false;
+    }
+    
+    for (size_t c = 0; c < m_chunkCount; ++c) {
+        Plugin::FeatureSet &fs = m_chunkFeatures[c];
+        for (Plugin::FeatureSet::iterator i = fs.begin(); i != fs.end(); ++i) {
+            Plugin::FeatureList &target = m_features[i->first];
+            target.insert(target.end(), i->second.begin(), i->second.end());
+        }
+    }
+    m_chunkFeatures.clear();
+
+    return true;
+}
+
+void
+ChunkedPluginRunner::Impl::runChunk(size_t chunk)
+{
+    Plugin *plugin = acquirePlugin();
+    if (!plugin) {
+        MutexLocker locker(&m_pluginMutex);
+        m_failed = true;
+        return;
+    }
+
+    Plugin::FeatureSet &features = m_chunkFeatures[chunk];
+
+    // The blocks belonging to this chunk, and the first block to
+    // process, which is earlier by the warm-up period if possible
+
+    size_t ownFirst = chunk * m_chunkBlocks;
+    size_t ownEnd = ownFirst + m_chunkBlocks;
+    if (ownEnd > m_blockCount) ownEnd = m_blockCount;
+    size_t first = (ownFirst > m_warmUpBlocks ? ownFirst - m_warmUpBlocks : 0);
+
+    if (ownEnd > first) {
+
+        size_t startFrame = first * m_stepSize;
+        size_t frames = (ownEnd - 1) * m_stepSize + m_blockSize - startFrame;
+
+        std::vector<std::vector<float> > input
+            (m_channels, std::vector<float>(frames, 0.f));
+        std::vector<float *> readBuffers(m_channels);
+        for (size_t c = 0; c < m_channels; ++c) {
+            readBuffers[c] = &input[c][0];
+        }
+
+        size_t available = m_frameCount - startFrame;
+        if (available > frames) available = frames;
+        {
+            MutexLocker locker(&m_sourceMutex);
+            size_t got = m_source->read(startFrame, available, &readBuffers[0]);
+            if (got < available) {
+                for (size_t c = 0; c < m_channels; ++c) {
+                    std::fill(input[c].begin() + got,
+                              input[c].begin() + available, 0.f);
+                }
+            }
+        }
+
+        unsigned int rate = (unsigned int)(m_inputSampleRate + 0.5);
+        std::vector<const float *> buffers(m_channels);
+
+        for (size_t b = first; b < ownEnd; ++b) {
+
+            size_t frame = b * m_stepSize;
+            for (size_t c = 0; c < m_channels; ++c) {
+                buffers[c] = &input[c][frame - startFrame];
+            }
+            
+            Plugin::FeatureSet fs = plugin->process
+                (&buffers[0], RealTime::frame2RealTime(frame, rate));
+
+            if (b < ownFirst) continue; // still warming up
+            
+            for (Plugin::FeatureSet::iterator i = fs.begin();
+                 i != fs.end(); ++i) {
+                Plugin::FeatureList &target = features[i->first];
+                target.insert(target.end(),
+                              i->second.begin(), i->second.end());
+            }
+        }
+    }
+
+    if (chunk + 1 == m_chunkCount) {
+        Plugin::FeatureSet fs = plugin->getRemainingFeatures();
+        for (Plugin::FeatureSet::iterator i = fs.begin(); i != fs.end(); ++i) {
+            Plugin::FeatureList &target = features[i->first];
+            target.insert(target.end(), i->second.begin(), i->second.end());
+        }
+    }
+
+    releasePlugin(plugin);
+}
+
+Plugin::OutputList
+ChunkedPluginRunner::Impl::getOutputDescriptors() const
+{
+    return m_outputs;
+}
+
+size_t
+ChunkedPluginRunner::Impl::getStepSize() const
+{
+    return m_stepSize;
+}
+
+size_t
+ChunkedPluginRunner::Impl::getBlockSize() const
+{
+    return m_blockSize;
+}
+
+int
+ChunkedPluginRunner::Impl::getChunkCount() const
+{
+    return int(m_chunkCount);
+}
+
+Plugin::FeatureSet
+ChunkedPluginRunner::Impl::takeFeatures()
+{
+    Plugin::FeatureSet features;
+    features.swap(m_features);
+    return features;
+}
+
+}
+
+}
+
+_VAMP_SDK_HOSTSPACE_END(ChunkedPluginRunner.cpp)
@@ -0,0 +1,265 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include <vamp-hostsdk/FeatureColumns.h>
+#include <vamp-hostsdk/PluginHostAdapter.h>
+#include <vamp-hostsdk/PluginWrapper.h>
+
+#include <cstring>
+#include <algorithm>
+
+#if ( VAMP_SDK_MAJOR_VERSION != 2 || VAMP_SDK_MINOR_VERSION != 9 )
+#error Unexpected version of Vamp SDK header included
+#endif
+
+using std::string;
+using std::vector;
+
+_VAMP_SDK_HOSTSPACE_BEGIN(FeatureColumns.cpp)
+
+namespace Vamp {
+
+namespace HostExt {
+
+// Labels are interned across calls to clear(), as plugins often use
+// the same few labels block after block; but if the table grows this
+// large, it is discarded on clear() instead
+static const size_t maxRetainedLabels = 256;
+
+FeatureColumns::FeatureColumns()
+{
+    m_offsets.push_back(0);
+}
+
+void
+FeatureColumns::clear()
+{
+    m_values.clear();
+    m_offsets.clear();
+    m_offsets.push_back(0);
+    m_timestamps.clear();
+    m_durations.clear();
+    m_flags.clear();
+    m_labels.clear();
+    
+    if (m_labelTable.size() > maxRetainedLabels) {
+        m_labelTable.clear();
+        m_labelIndex.clear();
+    }
+}
+
+int
+FeatureColumns::internLabel(const char *label)
+{
+    if (!label || !*label) return -1;
+
+    // Consecutive features very often share a label, so check the
+    // previous one before constructing a string to look up
+    if (!m_labels.empty()) {
+        int prev = m_labels[m_labels.size()-1];
+        if (prev >= 0 && !strcmp(m_labelTable[prev].c_str(), label)) {
+            return prev;
+        }
+    }
+    
+    string key(label);
+    std::map<string, int>::const_iterator i = m_labelIndex.find(key);
+    if (i != m_labelIndex.end()) return i->second;
+
+    int index = int(m_labelTable.size());
+    m_labelTable.push_back(key);
+    m_labelIndex[key] = index;
+    return index;
+}
+
+void
+FeatureColumns::append(bool hasTimestamp, RealTime timestamp,
+                       bool hasDuration, RealTime duration,
+                       const float *values, size_t valueCount,
+                       const char *label)
+{
+    unsigned char flags = 0;
+    if (hasTimestamp) flags |= TimestampFlag;
+    if (hasDuration) flags |= DurationFlag;
+    
+    m_flags.push_back(flags);
+    m_timestamps.push_back(timestamp);
+    m_durations.push_back(duration);
+
+    if (valueCount > 0) {
+        size_t count = m_values.size();
+        if (count > 0 &&
+            values >= &m_values[0] && values < &m_values[0] + count) {
+            // Values from our own storage (as from append(*this, i)),
+            // which an insert could free before reading: copy by index
+            size_t offset = values - &m_values[0];
+            m_values.resize(count + valueCount);
+            std::copy(m_values.begin() + offset,
+                      m_values.begin() + offset + valueCount,
+                      m_values.begin() + count);
+        } else {
+            m_values.insert(m_values.end(), values, values + valueCount);
+        }
+    }
+    m_offsets.push_back(m_values.size());
+
+    m_labels.push_back(internLabel(label));
+}
+
+void
+FeatureColumns::append(const Plugin::Feature &feature)
+{
+    append(feature.hasTimestamp, feature.timestamp,
+           feature.hasDuration, feature.duration,
+           feature.values.empty() ? 0 : &feature.values[0],
+           feature.values.size(),
+           feature.label.c_str());
+}
+
+void
+FeatureColumns::append(const FeatureColumns &other, size_t i)
+{
+    const string &label = other.getLabel(i);
+    
+    append(other.hasTimestamp(i), other.getTimestamp(i),
+           other.hasDuration(i), other.getDuration(i),
+           other.getValues(i), other.getValueCount(i),
+           label.c_str());
+}
+
+void
+FeatureColumns::setTimestamp(size_t i, RealTime timestamp)
+{
+    m_timestamps[i] = timestamp;
+    m_flags[i] |= TimestampFlag;
+}
+
+const string &
+FeatureColumns::getLabel(size_t i) const
+{
+    static const string none;
+    int index = m_labels[i];
+    if (index < 0) return none;
+    return m_labelTable[index];
+}
+
+Plugin::Feature
+FeatureColumns::getFeature(size_t i) const
+{
+    Plugin::Feature feature;
+    getFeature(i, feature);
+    return feature;
+}
+
+void
+FeatureColumns::getFeature(size_t i, Plugin::Feature &feature) const
+{
+    feature.hasTimestamp = hasTimestamp(i);
+    feature.timestamp = m_timestamps[i];
+    feature.hasDuration = hasDuration(i);
+    feature.duration = m_durations[i];
+    feature.values.assign(m_values.begin() + m_offsets[i],
+                          m_values.begin() + m_offsets[i+1]);
+    feature.label = getLabel(i);
+}
+
+void
+FeatureColumns::assign(const Plugin::FeatureList &list)
+{
+    clear();
+    for (size_t i = 0; i < list.size(); ++i) {
+        append(list[i]);
+    }
+}
+
+void
+FeatureColumns::toFeatureList(Plugin::FeatureList &list) const
+{
+    list.resize(size());
+    for (size_t i = 0; i < size(); ++i) {
+        getFeature(i, list[i]);
+    }
+}
+
+void
+convertFeatures(const Plugin::FeatureSet &from, FeatureColumnSet &to)
+{
+    for (FeatureColumnSet::iterator i = to.begin(); i != to.end(); ++i) {
+        i->second.clear();
+    }
+    for (Plugin::FeatureSet::const_iterator i = from.begin();
+         i != from.end(); ++i) {
+        to[i->first].assign(i->second);
+    }
+}
+
+void
+convertFeatures(const FeatureColumnSet &from, Plugin::FeatureSet &to)
+{
+    to.clear();
+    for (FeatureColumnSet::const_iterator i = from.begin();
+         i != from.end(); ++i) {
+        if (i->second.empty()) continue;
+        i->second.toFeatureList(to[i->first]);
+    }
+}
+
+void
+processColumns(Plugin *plugin,
+               const float *const *inputBuffers,
+               RealTime timestamp,
+               FeatureColumnSet &features)
+{
+    PluginWrapper *wrapper = dynamic_cast<PluginWrapper *>(plugin);
+    if (wrapper) {
+        wrapper->processColumns(inputBuffers, timestamp, features);
+        return;
+    }
+
+    PluginHostAdapter *adapter = dynamic_cast<PluginHostAdapter *>(plugin);
+    if (adapter) {
+        adapter->processColumns(inputBuffers, timestamp, features);
+        return;
+    }
+
+    convertFeatures(plugin->process(inputBuffers, timestamp), features);
+}
+
+}
+
+}
+
+_VAMP_SDK_HOSTSPACE_END(FeatureColumns.cpp)
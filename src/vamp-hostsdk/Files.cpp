@@ -37,10 +37,12 @@
 #include <vamp-hostsdk/PluginHostAdapter.h>
 
 #include "Files.h"
+#include "Thread.h"
 
 #include <cctype> // tolower
 
 #include <cstring>
+#include <sstream>
 
 #ifdef _WIN32
 
@@ -53,6 +55,9 @@
 #include <cstdlib>
 #include <dirent.h>
 #include <dlfcn.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef __APPLE__
 #define PLUGIN_SUFFIX "dylib"
@@ -153,14 +158,26 @@ Files::listLibraryFilesMatching(Filter filter)
 
 void *
 Files::loadLibrary(string path)
+{
+    string error;
+    void *handle = loadLibrary(path, error);
+    if (!handle) {
+        cerr << "Vamp::HostExt: " << error << endl;
+    }
+    return handle;
+}
+
+void *
+Files::loadLibrary(string path, string &error)
 {
     void *handle = 0;
+    error = "";
 #ifdef _WIN32
 #ifdef UNICODE
     int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), path.length(), 0, 0);
     if (wlen < 0) {
-        cerr << "Vamp::HostExt: Unable to convert library path \""
-             << path << "\" to wide characters " << endl;
+        error = "Unable to convert library path \"" + path +
+            "\" to wide characters ";
         return handle;
     }
     wchar_t *buffer = new wchar_t[wlen+1];
@@ -172,14 +189,14 @@ Files::loadLibrary(string path)
     handle = LoadLibrary(path.c_str());
 #endif
     if (!handle) {
-        cerr << "Vamp::HostExt: Unable to load library \""
-             << path << "\"" << endl;
+        error = "Unable to load library \"" + path + "\"";
     }
 #else
     handle = dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
     if (!handle) {
-        cerr << "Vamp::HostExt: Unable to load library \""
-             << path << "\": " << dlerror() << endl;
+        const char *message = dlerror();
+        error = "Unable to load library \"" + path + "\": " +
+            (message ? message : "");
     }
 #endif
     return handle;
@@ -428,3 +445,69 @@ Files::getEnvUtf8(std::string variable, std::string &value)
     
 #endif
 }
+
+bool
+Files::getFileStamp(std::string path, std::string &stamp)
+{
+    stamp = "";
+    std::ostringstream oss;
+
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+#ifdef UNICODE
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), int(path.length()), 0, 0);
+    if (wlen < 0) {
+        cerr << "Vamp::HostExt: Unable to convert file path \""
+             << path << "\" to wide characters" << endl;
+        return false;
+    }
+    wchar_t *buffer = new wchar_t[wlen+1];
+    (void)MultiByteToWideChar(CP_UTF8, 0, path.c_str(), int(path.length()), buffer, wlen);
+    buffer[wlen] = L'\0';
+    BOOL ok = GetFileAttributesEx(buffer, GetFileExInfoStandard, &data);
+    delete[] buffer;
+#else
+    BOOL ok = GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data);
+#endif
+    if (!ok) {
+        return false;
+    }
+    oss << data.nFileSizeHigh << "." << data.nFileSizeLow << "-"
+        << data.ftLastWriteTime.dwHighDateTime << "."
+        << data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    oss << (unsigned long)st.st_size << "-" << (unsigned long)st.st_mtime;
+#endif
+
+    stamp = oss.str();
+    return true;
+}
+
+static Mutex temporaryNameMutex;
+static unsigned long temporaryNameCount = 0;
+
+std::string
+Files::getTemporaryName(std::string path)
+{
+    // The process ID keeps apart processes writing alongside the same
+    // path at once, and the count keeps apart calls within a process
+
+    unsigned long count;
+    {
+        MutexLocker locker(&temporaryNameMutex);
+        count = ++temporaryNameCount;
+    }
+
+    std::ostringstream oss;
+#ifdef _WIN32
+    oss << path << "." << (unsigned long)GetCurrentProcessId();
+#else
+    oss << path << "." << (unsigned long)getpid();
+#endif
+    oss << "." << count << ".tmp";
+    return oss.str();
+}
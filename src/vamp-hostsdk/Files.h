@@ -56,6 +56,13 @@ public:
     static std::vector<std::string> listLibraryFilesMatching(Filter);
 
     static void *loadLibrary(std::string filename);
+
+    /**
+     * Load a library as loadLibrary does, but without printing
+     * anything: on failure, return NULL and set \arg error to a
+     * description of the problem.  Safe to call from any thread.
+     */
+    static void *loadLibrary(std::string filename, std::string &error);
     static void unloadLibrary(void *);
     static void *lookupInLibrary(void *, const char *symbol);
 
@@ -65,6 +72,20 @@ public:
 
     static bool isNonNative32Bit();
     static bool getEnvUtf8(std::string variable, std::string &value);
+
+    /**
+     * Obtain a string that changes whenever the file at the given
+     * path is modified (made from its size and modification time).
+     * Return false if the file could not be examined.
+     */
+    static bool getFileStamp(std::string path, std::string &stamp);
+
+    /**
+     * Return a name for a temporary file in the same directory as
+     * the given path, that no other call in this or any other process
+     * will return at the same time.
+     */
+    static std::string getTemporaryName(std::string path);
 };
 
 #endif
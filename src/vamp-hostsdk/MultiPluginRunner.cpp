@@ -0,0 +1,595 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include <vamp-hostsdk/MultiPluginRunner.h>
+#include <vamp-hostsdk/PluginWrapper.h>
+#include <vamp-hostsdk/PluginInputDomainAdapter.h>
+
+#include "Thread.h"
+
+#include <iostream>
+#include <vector>
+
+_VAMP_SDK_HOSTSPACE_BEGIN(MultiPluginRunner.cpp)
+
+namespace Vamp {
+
+namespace HostExt {
+
+class MultiPluginRunner::Impl
+{
+public:
+    Impl(size_t channels, int threads);
+    ~Impl();
+
+    int addPlugin(Plugin *plugin, size_t stepSize, size_t blockSize,
+                  bool initialise);
+
+    int getPluginCount() const;
+    Plugin *getPlugin(int index) const;
+    size_t getStepSize(int index) const;
+    size_t getBlockSize(int index) const;
+
+    void process(const float *const *inputBuffers, size_t frameCount);
+    void finish();
+
+    Plugin::FeatureSet takeFeatures(int index, BlockFrameSet *blockFrames);
+
+protected:
+    typedef PluginInputDomainAdapter::SharedSpectrum SharedSpectrum;
+    
+    struct Group {
+        size_t stepSize;
+        size_t blockSize;
+        SharedSpectrum *spectrum;
+    };
+
+    struct Entry {
+        Plugin *plugin;
+        size_t stepSize;
+        size_t blockSize;
+        unsigned int rate;
+        size_t nextFrame; // start of the next block to be processed
+        PluginInputDomainAdapter *sharing; // if we attached a spectrum
+        std::vector<const float *> buffers;
+        Plugin::FeatureSet features;
+        BlockFrameSet frames; // block start for each of the features
+    };
+
+    class PluginTask : public ThreadPool::Task
+    {
+    public:
+        PluginTask(Impl *impl, size_t index) :
+            m_impl(impl), m_index(index) { }
+        void perform() {
+            m_impl->runPlugin(m_index);
+        }
+    private:
+        Impl *m_impl;
+        size_t m_index;
+    };
+    friend class PluginTask;
+
+    size_t m_channels;
+    ThreadPool m_pool;
+    std::vector<Group> m_groups;
+    std::vector<Entry> m_entries;
+    std::vector<PluginTask> m_pluginTasks;
+    std::vector<ThreadPool::Task *> m_tasks;
+
+    // Input received but not yet consumed by every plugin, one
+    // vector per channel starting at frame m_inputStart
+    std::vector<std::vector<float> > m_input;
+    size_t m_inputStart;
+    size_t m_inputEnd;
+
+    bool m_started;
+    bool m_finished;
+    size_t m_dataEnd; // end of the real input, once finished
+
+    // The number of blocks each plugin processes before the others
+    // catch up with it, so that the plugins in a group stay close
+    // enough together to share their spectra
+    static const size_t m_roundBlocks = 32;
+
+    int addEntry(Plugin *plugin, size_t stepSize, size_t blockSize);
+    bool checkIndex(int index) const;
+    void start();
+    size_t getFinalEnd(const Entry &e) const;
+    size_t getPendingBlocks(const Entry &e) const;
+    void runPlugin(size_t index);
+    void runRounds();
+    void discardConsumedInput();
+    void detachSpectra();
+    void appendFeatures(Entry &e, const Plugin::FeatureSet &features,
+                        size_t frame);
+};
+
+MultiPluginRunner::MultiPluginRunner(size_t channels, int threads)
+{
+    m_impl = new Impl(channels, threads);
+}
+
+MultiPluginRunner::~MultiPluginRunner()
+{
+    delete m_impl;
+}
+
+int
+MultiPluginRunner::addPlugin(Plugin *plugin, size_t stepSize, size_t blockSize)
+{
+    return m_impl->addPlugin(plugin, stepSize, blockSize, true);
+}
+
+int
+MultiPluginRunner::addInitialisedPlugin(Plugin *plugin,
+                                        size_t stepSize,
+                                        size_t blockSize)
+{
+    return m_impl->addPlugin(plugin, stepSize, blockSize, false);
+}
+
+int
+MultiPluginRunner::getPluginCount() const
+{
+    return m_impl->getPluginCount();
+}
+
+Plugin *
+MultiPluginRunner::getPlugin(int index) const
+{
+    return m_impl->getPlugin(index);
+}
+
+size_t
+MultiPluginRunner::getStepSize(int index) const
+{
+    return m_impl->getStepSize(index);
+}
+
+size_t
+MultiPluginRunner::getBlockSize(int index) const
+{
+    return m_impl->getBlockSize(index);
+}
+
+void
+MultiPluginRunner::process(const float *const *inputBuffers, size_t frameCount)
+{
+    m_impl->process(inputBuffers, frameCount);
+}
+
+void
+MultiPluginRunner::finish()
+{
+    m_impl->finish();
+}
+
+Plugin::FeatureSet
+MultiPluginRunner::takeFeatures(int index)
+{
+    return m_impl->takeFeatures(index, 0);
+}
+
+Plugin::FeatureSet
+MultiPluginRunner::takeFeatures(int index, BlockFrameSet &blockFrames)
+{
+    return m_impl->takeFeatures(index, &blockFrames);
+}
+
+MultiPluginRunner::Impl::Impl(size_t channels, int threads) :
+    m_channels(channels),
+    m_pool(threads > 1 ? threads - 1 : 0), // the calling thread joins in
+    m_input(channels),
+    m_inputStart(0),
+    m_inputEnd(0),
+    m_started(false),
+    m_finished(false),
+    m_dataEnd(0)
+{
+}
+
+MultiPluginRunner::Impl::~Impl()
+{
+    // The plugins belong to the host and may outlive us, so they
+    // must not be left referring to our spectra
+    detachSpectra();
+    
+    for (size_t i = 0; i < m_groups.size(); ++i) {
+        delete m_groups[i].spectrum;
+    }
+}
+
+int
+MultiPluginRunner::Impl::addPlugin(Plugin *plugin,
+                                   size_t stepSize,
+                                   size_t blockSize,
+                                   bool initialise)
+{
+    if (!plugin) return -1;
+    
+    if (m_started) {
+        std::cerr << "MultiPluginRunner::addPlugin: ERROR: Cannot add plugins once processing has begun" << std::endl;
+        return -1;
+    }
+
+    if (!initialise) {
+        if (stepSize == 0 || blockSize == 0) {
+            std::cerr << "MultiPluginRunner::addInitialisedPlugin: ERROR: Step and block size must be given" << std::endl;
+            return -1;
+        }
+        return addEntry(plugin, stepSize, blockSize);
+    }
+
+    // The same defaults as vamp-simple-host
+    
+    if (blockSize == 0) blockSize = plugin->getPreferredBlockSize();
+    if (stepSize == 0) stepSize = plugin->getPreferredStepSize();
+
+    if (blockSize == 0) {
+        blockSize = 1024;
+    }
+    if (stepSize == 0) {
+        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
+            stepSize = blockSize/2;
+        } else {
+            stepSize = blockSize;
+        }
+    } else if (stepSize > blockSize) {
+        std::cerr << "MultiPluginRunner::addPlugin: WARNING: stepSize " << stepSize << " > blockSize " << blockSize << ", resetting blockSize to ";
+        if (plugin->getInputDomain() == Plugin::FrequencyDomain) {
+            blockSize = stepSize * 2;
+        } else {
+            blockSize = stepSize;
+        }
+        std::cerr << blockSize << std::endl;
+    }
+
+    if (!plugin->initialise(m_channels, stepSize, blockSize)) {
+        std::cerr << "MultiPluginRunner::addPlugin: ERROR: Plugin initialise (channels = " << m_channels << ", stepSize = " << stepSize << ", blockSize = " << blockSize << ") failed" << std::endl;
+        return -1;
+    }
+
+    return addEntry(plugin, stepSize, blockSize);
+}
+
+int
+MultiPluginRunner::Impl::addEntry(Plugin *plugin,
+                                  size_t stepSize,
+                                  size_t blockSize)
+{
+    Entry e;
+    e.plugin = plugin;
+    e.stepSize = stepSize;
+    e.blockSize = blockSize;
+    e.rate = (unsigned int)(plugin->getInputSampleRate() + 0.5);
+    e.nextFrame = 0;
+    e.sharing = 0;
+    e.buffers.resize(m_channels);
+
+    PluginWrapper *wrapper = dynamic_cast<PluginWrapper *>(plugin);
+    PluginInputDomainAdapter *ida = 0;
+    if (wrapper) {
+        ida = wrapper->getWrapper<PluginInputDomainAdapter>();
+    }
+    
+    if (ida && !ida->getSharedSpectrum()) {
+
+        size_t g = 0;
+        while (g < m_groups.size() &&
+               (m_groups[g].stepSize != stepSize ||
+                m_groups[g].blockSize != blockSize)) {
+            ++g;
+        }
+        if (g == m_groups.size()) {
+            Group group;
+            group.stepSize = stepSize;
+            group.blockSize = blockSize;
+            group.spectrum = new SharedSpectrum
+                (int(m_channels * m_roundBlocks));
+            m_groups.push_back(group);
+        }
+
+        ida->setSharedSpectrum(m_groups[g].spectrum);
+        e.sharing = ida;
+    }
+
+    m_entries.push_back(e);
+    return int(m_entries.size()) - 1;
+}
+
+bool
+MultiPluginRunner::Impl::checkIndex(int index) const
+{
+    if (index < 0 || index >= int(m_entries.size())) {
+        std::cerr << "MultiPluginRunner: ERROR: Plugin index " << index << " out of range" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int
+MultiPluginRunner::Impl::getPluginCount() const
+{
+    return int(m_entries.size());
+}
+
+Plugin *
+MultiPluginRunner::Impl::getPlugin(int index) const
+{
+    if (!checkIndex(index)) return 0;
+    return m_entries[index].plugin;
+}
+
+size_t
+MultiPluginRunner::Impl::getStepSize(int index) const
+{
+    if (!checkIndex(index)) return 0;
+    return m_entries[index].stepSize;
+}
+
+size_t
+MultiPluginRunner::Impl::getBlockSize(int index) const
+{
+    if (!checkIndex(index)) return 0;
+    return m_entries[index].blockSize;
+}
+
+Plugin::FeatureSet
+MultiPluginRunner::Impl::takeFeatures(int index, BlockFrameSet *blockFrames)
+{
+    Plugin::FeatureSet features;
+    if (blockFrames) blockFrames->clear();
+    if (!checkIndex(index)) return features;
+    features.swap(m_entries[index].features);
+    if (blockFrames) {
+        blockFrames->swap(m_entries[index].frames);
+    } else {
+        m_entries[index].frames.clear();
+    }
+    return features;
+}
+
+void
+MultiPluginRunner::Impl::process(const float *const *inputBuffers,
+                                 size_t frameCount)
+{
+    if (m_finished) {
+        std::cerr << "MultiPluginRunner::process: ERROR: Cannot process after finish() has been called" << std::endl;
+        return;
+    }
+
+    start();
+    
+    for (size_t c = 0; c < m_channels; ++c) {
+        m_input[c].insert(m_input[c].end(),
+                          inputBuffers[c], inputBuffers[c] + frameCount);
+    }
+    m_inputEnd += frameCount;
+
+    runRounds();
+    discardConsumedInput();
+}
+
+void
+MultiPluginRunner::Impl::finish()
+{
+    if (m_finished) return;
+
+    start();
+    
+    m_finished = true;
+    m_dataEnd = m_inputEnd;
+
+    // Pad with enough zeros to complete the last block of every
+    // plugin
+    
+    size_t end = m_inputEnd;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        size_t e = getFinalEnd(m_entries[i]);
+        if (e > end) end = e;
+    }
+    for (size_t c = 0; c < m_channels; ++c) {
+        m_input[c].resize(m_input[c].size() + (end - m_inputEnd), 0.f);
+    }
+    m_inputEnd = end;
+
+    runRounds();
+
+    // And one final round for the remaining features, which runPlugin
+    // knows to collect because it has no blocks left
+    
+    m_tasks.clear();
+    for (size_t i = 0; i < m_pluginTasks.size(); ++i) {
+        m_tasks.push_back(&m_pluginTasks[i]);
+    }
+    m_pool.run(m_tasks);
+
+    for (size_t c = 0; c < m_channels; ++c) {
+        m_input[c].clear();
+    }
+
+    // Processing is complete, and the host may now delete the
+    // plugins before it deletes us
+    detachSpectra();
+}
+
+void
+MultiPluginRunner::Impl::detachSpectra()
+{
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].sharing) {
+            m_entries[i].sharing->setSharedSpectrum(0);
+            m_entries[i].sharing = 0;
+        }
+    }
+}
+
+void
+MultiPluginRunner::Impl::start()
+{
+    if (m_started) return;
+    m_started = true;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        m_pluginTasks.push_back(PluginTask(this, i));
+    }
+}
+
+size_t
+MultiPluginRunner::Impl::getFinalEnd(const Entry &e) const
+{
+    // The end of the last block to be processed once finished.  As in
+    // the runPlugin function of vamp-simple-host, that is every
+    // complete block of the real input followed by blockSize /
+    // stepSize - 1 blocks (but at least one) that are partly or
+    // wholly padding
+
+    size_t complete = 0;
+    if (m_dataEnd >= e.blockSize) {
+        complete = (m_dataEnd - e.blockSize) / e.stepSize + 1;
+    }
+
+    size_t padded = e.blockSize / e.stepSize;
+    padded = (padded > 2 ? padded - 1 : 1);
+
+    return (complete + padded - 1) * e.stepSize + e.blockSize;
+}
+
+size_t
+MultiPluginRunner::Impl::getPendingBlocks(const Entry &e) const
+{
+    if (m_finished) {
+        // blocks up to the final end
+        size_t end = getFinalEnd(e);
+        if (e.nextFrame + e.blockSize > end) return 0;
+        return (end - e.nextFrame - e.blockSize) / e.stepSize + 1;
+    } else {
+        // complete blocks
+        if (e.nextFrame + e.blockSize > m_inputEnd) return 0;
+        return (m_inputEnd - e.nextFrame - e.blockSize) / e.stepSize + 1;
+    }
+}
+
+void
+MultiPluginRunner::Impl::runRounds()
+{
+    while (true) {
+        m_tasks.clear();
+        for (size_t i = 0; i < m_entries.size(); ++i) {
+            if (getPendingBlocks(m_entries[i]) > 0) {
+                m_tasks.push_back(&m_pluginTasks[i]);
+            }
+        }
+        if (m_tasks.empty()) break;
+        m_pool.run(m_tasks);
+    }
+}
+
+void
+MultiPluginRunner::Impl::runPlugin(size_t index)
+{
+    Entry &e = m_entries[index];
+
+    size_t blocks = getPendingBlocks(e);
+
+    if (blocks == 0) {
+        if (m_finished) {
+            // As in vamp-simple-host, these belong to the frame
+            // following the last block
+            appendFeatures(e, e.plugin->getRemainingFeatures(), e.nextFrame);
+        }
+        return;
+    }
+
+    if (blocks > m_roundBlocks) blocks = m_roundBlocks;
+
+    // One block at a time rather than through processBatch, whose
+    // features for many blocks come back merged, so that we know
+    // which block each feature was returned for
+
+    for (size_t b = 0; b < blocks; ++b) {
+
+        for (size_t c = 0; c < m_channels; ++c) {
+            e.buffers[c] = &m_input[c][e.nextFrame - m_inputStart];
+        }
+
+        appendFeatures(e, e.plugin->process
+                       (m_channels > 0 ? &e.buffers[0] : 0,
+                        RealTime::frame2RealTime(long(e.nextFrame), e.rate)),
+                       e.nextFrame);
+
+        e.nextFrame += e.stepSize;
+    }
+}
+
+void
+MultiPluginRunner::Impl::appendFeatures(Entry &e,
+                                        const Plugin::FeatureSet &features,
+                                        size_t frame)
+{
+    for (Plugin::FeatureSet::const_iterator i = features.begin();
+         i != features.end(); ++i) {
+        Plugin::FeatureList &list = e.features[i->first];
+        list.insert(list.end(), i->second.begin(), i->second.end());
+        std::vector<size_t> &frames = e.frames[i->first];
+        frames.insert(frames.end(), i->second.size(), frame);
+    }
+}
+
+void
+MultiPluginRunner::Impl::discardConsumedInput()
+{
+    size_t consumed = m_inputEnd;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].nextFrame < consumed) {
+            consumed = m_entries[i].nextFrame;
+        }
+    }
+
+    if (consumed <= m_inputStart) return;
+
+    for (size_t c = 0; c < m_channels; ++c) {
+        m_input[c].erase(m_input[c].begin(),
+                         m_input[c].begin() + (consumed - m_inputStart));
+    }
+    m_inputStart = consumed;
+}
+
+}
+
+}
+
+_VAMP_SDK_HOSTSPACE_END(MultiPluginRunner.cpp)
@@ -75,15 +75,30 @@ public:
     void reset();
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
+
+    void processColumns(const float *const *inputBuffers,
+                        RealTime timestamp,
+                        FeatureColumnSet &features);
+
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp);
 		
     FeatureSet getRemainingFeatures();
+
+    int getWarmUpFrames() const;
 		
 protected:
+    // The ring buffer keeps a mirror of its first "mirror" samples
+    // just past the end of the buffer proper, so that any read of up
+    // to that many samples is contiguous in memory and can be handed
+    // straight to the plugin without copying.
     class RingBuffer
     {
     public:
-        RingBuffer(int n) :
-            m_buffer(new float[n+1]), m_writer(0), m_reader(0), m_size(n+1) { }
+        RingBuffer(int n, int mirror = 0) :
+            m_buffer(new float[n+1+mirror]), m_writer(0), m_reader(0),
+            m_size(n+1), m_mirror(mirror) { }
         virtual ~RingBuffer() { delete[] m_buffer; }
 
         int getSize() const { return m_size-1; }
@@ -139,6 +154,16 @@ protected:
             return n;
         }
 
+        // Return a pointer to n contiguous readable samples, or 0 if
+        // fewer than n are available or they wrap around the end of
+        // the buffer and are not covered by the mirror
+        const float *getReadPointer(int n) const {
+
+            if (n > getReadSpace()) return 0;
+            if (m_reader + n > m_size + m_mirror) return 0;
+            return m_buffer + m_reader;
+        }
+
         int skip(int n) {
             
             int available = getReadSpace();
@@ -170,6 +195,7 @@ protected:
                 for (int i = 0; i < n; ++i) {
                     bufbase[i] = source[i];
                 }
+                updateMirror(writer, n);
             } else {
                 for (int i = 0; i < here; ++i) {
                     bufbase[i] = source[i];
@@ -180,6 +206,7 @@ protected:
                 for (int i = 0; i < nh; ++i) {
                     buf[i] = srcbase[i];
                 }
+                updateMirror(0, nh);
             }
 
             writer += n;
@@ -205,6 +232,7 @@ protected:
                 for (int i = 0; i < n; ++i) {
                     bufbase[i] = 0.f;
                 }
+                updateMirror(writer, n);
             } else {
                 for (int i = 0; i < here; ++i) {
                     bufbase[i] = 0.f;
@@ -213,6 +241,7 @@ protected:
                 for (int i = 0; i < nh; ++i) {
                     m_buffer[i] = 0.f;
                 }
+                updateMirror(0, nh);
             }
             
             writer += n;
@@ -227,6 +256,17 @@ protected:
         int    m_writer;
         int    m_reader;
         int    m_size;
+        int    m_mirror;
+
+        void updateMirror(int start, int n) {
+            if (start >= m_mirror) return;
+            if (start + n > m_mirror) n = m_mirror - start;
+            float *const mirbase = m_buffer + m_size + start;
+            const float *const bufbase = m_buffer + start;
+            for (int i = 0; i < n; ++i) {
+                mirbase[i] = bufbase[i];
+            }
+        }
 
     private:
         RingBuffer(const RingBuffer &); // not provided
@@ -242,16 +282,26 @@ protected:
     size_t m_blockSize;      // value actually used to initialise plugin
     size_t m_channels;
     vector<RingBuffer *> m_queue;
-    float **m_buffers;
+    const float **m_buffers;
     float m_inputSampleRate;
     long m_frame;
     bool m_unrun;
     mutable OutputList m_outputs;
     mutable std::map<int, bool> m_rewriteOutputTimes;
     std::map<int, int> m_fixedRateFeatureNos; // output no -> feature no
+    FeatureColumnSet m_blockColumns; // reused by processBlock for columns
 		
+    void queueInput(const float *const *inputBuffers, RealTime timestamp);
+    RealTime prepareBlock();
+    RealTime getTimestampAdjustment() const;
+    void stepForward();
     void processBlock(FeatureSet& allFeatureSets);
+    void processBlock(FeatureColumnSet& allFeatures);
     void adjustFixedRateFeatureTime(int outputNo, Feature &);
+    void adjustFixedRateFeatureTime(int outputNo, bool hasTimestamp,
+                                    RealTime &timestamp);
+    bool rewriteFeatureTime(int outputNo, bool hasTimestamp,
+                            RealTime &timestamp, RealTime blockTime);
 };
 		
 PluginBufferingAdapter::PluginBufferingAdapter(Plugin *plugin) :
@@ -344,12 +394,37 @@ PluginBufferingAdapter::process(const float *const *inputBuffers,
 {
     return m_impl->process(inputBuffers, timestamp);
 }
+
+void
+PluginBufferingAdapter::processColumns(const float *const *inputBuffers,
+                                       RealTime timestamp,
+                                       FeatureColumnSet &features)
+{
+    m_impl->processColumns(inputBuffers, timestamp, features);
+}
+
+PluginBufferingAdapter::FeatureSet
+PluginBufferingAdapter::processBatch(const float *const *inputBuffers,
+                                     size_t frameCount,
+                                     RealTime startTimestamp,
+                                     size_t,
+                                     size_t,
+                                     size_t)
+{
+    return m_impl->processBatch(inputBuffers, frameCount, startTimestamp);
+}
 		
 PluginBufferingAdapter::FeatureSet
 PluginBufferingAdapter::getRemainingFeatures()
 {
     return m_impl->getRemainingFeatures();
 }
+
+int
+PluginBufferingAdapter::getWarmUpFrames() const
+{
+    return m_impl->getWarmUpFrames();
+}
 		
 PluginBufferingAdapter::Impl::Impl(Plugin *plugin, float inputSampleRate) :
     m_plugin(plugin),
@@ -375,7 +450,6 @@ PluginBufferingAdapter::Impl::~Impl()
 
     for (size_t i = 0; i < m_channels; ++i) {
         delete m_queue[i];
-        delete[] m_buffers[i];
     }
     delete[] m_buffers;
 }
@@ -478,11 +552,12 @@ PluginBufferingAdapter::Impl::initialise(size_t channels, size_t stepSize, size_
 //    std::cerr << "PluginBufferingAdapter::initialise: NOTE: stepSize " << m_inputStepSize << " -> " << m_stepSize 
 //              << ", blockSize " << m_inputBlockSize << " -> " << m_blockSize << std::endl;			
 
-    m_buffers = new float *[m_channels];
+    m_buffers = new const float *[m_channels];
 
     for (size_t i = 0; i < m_channels; ++i) {
-        m_queue.push_back(new RingBuffer(int(m_blockSize + m_inputBlockSize)));
-        m_buffers[i] = new float[m_blockSize];
+        m_queue.push_back(new RingBuffer(int(m_blockSize + m_inputBlockSize),
+                                         int(m_blockSize)));
+        m_buffers[i] = 0;
     }
     
     bool success = m_plugin->initialise(m_channels, m_stepSize, m_blockSize);
@@ -586,14 +661,49 @@ PluginBufferingAdapter::Impl::process(const float *const *inputBuffers,
 
     FeatureSet allFeatureSets;
 
+    queueInput(inputBuffers, timestamp);
+    
+    // process as much as we can
+
+    while (m_queue[0]->getReadSpace() >= int(m_blockSize)) {
+        processBlock(allFeatureSets);
+    }	
+    
+    return allFeatureSets;
+}
+
+void
+PluginBufferingAdapter::Impl::processColumns(const float *const *inputBuffers,
+                                             RealTime timestamp,
+                                             FeatureColumnSet &allFeatures)
+{
+    for (FeatureColumnSet::iterator i = allFeatures.begin();
+         i != allFeatures.end(); ++i) {
+        i->second.clear();
+    }
+    
+    if (m_inputStepSize == 0) {
+        std::cerr << "PluginBufferingAdapter::processColumns: ERROR: Plugin has not been initialised" << std::endl;
+        return;
+    }
+
+    queueInput(inputBuffers, timestamp);
+
+    while (m_queue[0]->getReadSpace() >= int(m_blockSize)) {
+        processBlock(allFeatures);
+    }	
+}
+
+void
+PluginBufferingAdapter::Impl::queueInput(const float *const *inputBuffers,
+                                         RealTime timestamp)
+{
     if (m_unrun) {
         m_frame = RealTime::realTime2Frame(timestamp,
                                            int(m_inputSampleRate + 0.5));
         m_unrun = false;
     }
 			
-    // queue the new input
-    
     for (size_t i = 0; i < m_channels; ++i) {
         int written = m_queue[i]->write(inputBuffers[i], int(m_inputBlockSize));
         if (written < int(m_inputBlockSize) && i == 0) {
@@ -605,13 +715,51 @@ PluginBufferingAdapter::Impl::process(const float *const *inputBuffers,
                       << std::endl;
         }
     }    
-    
-    // process as much as we can
+}
+
+PluginBufferingAdapter::FeatureSet
+PluginBufferingAdapter::Impl::processBatch(const float *const *inputBuffers,
+                                           size_t frameCount,
+                                           RealTime startTimestamp)
+{
+    if (m_inputStepSize == 0) {
+        std::cerr << "PluginBufferingAdapter::processBatch: ERROR: Plugin has not been initialised" << std::endl;
+        return FeatureSet();
+    }
+
+    FeatureSet allFeatureSets;
+
+    if (m_unrun) {
+        m_frame = RealTime::realTime2Frame(startTimestamp,
+                                           int(m_inputSampleRate + 0.5));
+        m_unrun = false;
+    }
+
+    // Our own step and block sizes are the same, so the batch is a
+    // series of abutting input blocks.  Rather than queueing them one
+    // at a time, queue as much as will fit, then process as much as
+    // we can, and repeat
+
+    const size_t available =
+        (frameCount / m_inputBlockSize) * m_inputBlockSize;
+    size_t queued = 0;
+
+    while (queued < available) {
+
+        size_t n = available - queued;
+        size_t space = size_t(m_queue[0]->getWriteSpace());
+        if (n > space) n = space;
+
+        for (size_t i = 0; i < m_channels; ++i) {
+            m_queue[i]->write(inputBuffers[i] + queued, int(n));
+        }
+        queued += n;
+
+        while (m_queue[0]->getReadSpace() >= int(m_blockSize)) {
+            processBlock(allFeatureSets);
+        }
+    }
 
-    while (m_queue[0]->getReadSpace() >= int(m_blockSize)) {
-        processBlock(allFeatureSets);
-    }	
-    
     return allFeatureSets;
 }
     
@@ -619,30 +767,69 @@ void
 PluginBufferingAdapter::Impl::adjustFixedRateFeatureTime(int outputNo,
                                                          Feature &feature)
 {
-//    cerr << "adjustFixedRateFeatureTime: from " << feature.timestamp;
+    adjustFixedRateFeatureTime(outputNo, feature.hasTimestamp,
+                               feature.timestamp);
+    feature.hasTimestamp = true;
+}    
+
+void
+PluginBufferingAdapter::Impl::adjustFixedRateFeatureTime(int outputNo,
+                                                         bool hasTimestamp,
+                                                         RealTime &timestamp)
+{
+//    cerr << "adjustFixedRateFeatureTime: from " << timestamp;
     
     double rate = m_outputs[outputNo].sampleRate;
     if (rate == 0.0) {
         rate = m_inputSampleRate / float(m_stepSize);
     }
     
-    if (feature.hasTimestamp) {
-        double secs = feature.timestamp.sec;
-        secs += feature.timestamp.nsec / 1e9;
+    if (hasTimestamp) {
+        double secs = timestamp.sec;
+        secs += timestamp.nsec / 1e9;
         m_fixedRateFeatureNos[outputNo] = int(secs * rate + 0.5);
 //        cerr << " [secs = " << secs << ", no = " << m_fixedRateFeatureNos[outputNo] << "]";
     }
 
-    feature.timestamp = RealTime::fromSeconds
+    timestamp = RealTime::fromSeconds
         (m_fixedRateFeatureNos[outputNo] / rate);
 
-//    cerr << " to " << feature.timestamp << " (rate = " << rate << ", hasTimestamp = " << feature.hasTimestamp << ")" << endl;
-    
-    feature.hasTimestamp = true;
+//    cerr << " to " << timestamp << " (rate = " << rate << ", hasTimestamp = " << hasTimestamp << ")" << endl;
     
     m_fixedRateFeatureNos[outputNo] = m_fixedRateFeatureNos[outputNo] + 1;
 }    
 
+bool
+PluginBufferingAdapter::Impl::rewriteFeatureTime(int outputNo,
+                                                 bool hasTimestamp,
+                                                 RealTime &timestamp,
+                                                 RealTime blockTime)
+{
+    // Set the timestamp of a feature returned from a block starting
+    // at blockTime (already adjusted for any input domain adapter's
+    // timestamp shift) according to its output's sample type, and
+    // return true if it was set
+
+    switch (m_outputs[outputNo].sampleType) {
+
+    case OutputDescriptor::OneSamplePerStep:
+        // use our internal timestamp, always
+        timestamp = blockTime;
+        return true;
+
+    case OutputDescriptor::FixedSampleRate:
+        adjustFixedRateFeatureTime(outputNo, hasTimestamp, timestamp);
+        return true;
+
+    case OutputDescriptor::VariableSampleRate:
+        // plugin must set timestamp
+        return false;
+
+    default:
+        return false;
+    }
+}
+
 PluginBufferingAdapter::FeatureSet
 PluginBufferingAdapter::Impl::getRemainingFeatures() 
 {
@@ -685,19 +872,52 @@ PluginBufferingAdapter::Impl::getRemainingFeatures()
     return allFeatureSets;
 }
     
-void
-PluginBufferingAdapter::Impl::processBlock(FeatureSet& allFeatureSets)
+RealTime
+PluginBufferingAdapter::Impl::prepareBlock()
 {
+    // The queues mirror a whole block's worth of samples, so the
+    // plugin can read each block directly from the queue memory
+
     for (size_t i = 0; i < m_channels; ++i) {
-        m_queue[i]->peek(m_buffers[i], int(m_blockSize));
+        m_buffers[i] = m_queue[i]->getReadPointer(int(m_blockSize));
     }
 
     long frame = m_frame;
-    RealTime timestamp = RealTime::frame2RealTime
-        (frame, int(m_inputSampleRate + 0.5));
+    return RealTime::frame2RealTime(frame, int(m_inputSampleRate + 0.5));
+}
 
-    FeatureSet featureSet = m_plugin->process(m_buffers, timestamp);
-    
+int
+PluginBufferingAdapter::Impl::getWarmUpFrames() const
+{
+    int frames = m_plugin->getWarmUpFrames();
+    if (frames < 0) return frames;
+
+    if (m_stepSize == 0 || m_inputStepSize % m_stepSize != 0) {
+        return -1;
+    }
+
+    // We number the features of fixed-rate outputs that lack
+    // timestamps ourselves, counting from the start of our input
+    for (int i = 0; i < int(m_outputs.size()); ++i) {
+        if (m_outputs[i].sampleType == OutputDescriptor::FixedSampleRate) {
+            return -1;
+        }
+    }
+
+    // The features returned for the first block after a split come
+    // from those of the plugin's blocks that end within it, the
+    // earliest of which may start up to a block before the split
+    if (m_blockSize % m_stepSize == 0) {
+        frames += int(m_blockSize - m_stepSize);
+    } else {
+        frames += int(m_blockSize);
+    }
+    return frames;
+}
+
+RealTime
+PluginBufferingAdapter::Impl::getTimestampAdjustment() const
+{
     PluginWrapper *wrapper = dynamic_cast<PluginWrapper *>(m_plugin);
     RealTime adjustment;
     if (wrapper) {
@@ -705,6 +925,28 @@ PluginBufferingAdapter::Impl::processBlock(FeatureSet& allFeatureSets)
             wrapper->getWrapper<PluginInputDomainAdapter>();
         if (ida) adjustment = ida->getTimestampAdjustment();
     }
+    return adjustment;
+}
+
+void
+PluginBufferingAdapter::Impl::stepForward()
+{
+    for (size_t i = 0; i < m_channels; ++i) {
+        m_queue[i]->skip(int(m_stepSize));
+    }
+    
+    // increment internal frame counter each time we step forward
+    m_frame += m_stepSize;
+}
+
+void
+PluginBufferingAdapter::Impl::processBlock(FeatureSet& allFeatureSets)
+{
+    RealTime timestamp = prepareBlock();
+
+    FeatureSet featureSet = m_plugin->process(m_buffers, timestamp);
+    
+    RealTime adjustment = getTimestampAdjustment();
 
     for (FeatureSet::iterator iter = featureSet.begin();
          iter != featureSet.end(); ++iter) {
@@ -717,27 +959,14 @@ PluginBufferingAdapter::Impl::processBlock(FeatureSet& allFeatureSets)
 	
             for (size_t i = 0; i < featureList.size(); ++i) {
 
-                switch (m_outputs[outputNo].sampleType) {
-
-                case OutputDescriptor::OneSamplePerStep:
-                    // use our internal timestamp, always
-                    featureList[i].timestamp = timestamp + adjustment;
-                    featureList[i].hasTimestamp = true;
-                    break;
-
-                case OutputDescriptor::FixedSampleRate:
-                    adjustFixedRateFeatureTime(outputNo, featureList[i]);
-                    break;
-
-                case OutputDescriptor::VariableSampleRate:
-                    // plugin must set timestamp
-                    break;
-
-                default:
-                    break;
+                Feature &feature = featureList[i];
+                if (rewriteFeatureTime(outputNo, feature.hasTimestamp,
+                                       feature.timestamp,
+                                       timestamp + adjustment)) {
+                    feature.hasTimestamp = true;
                 }
             
-                allFeatureSets[outputNo].push_back(featureList[i]);
+                allFeatureSets[outputNo].push_back(feature);
             }
         } else {
             for (size_t i = 0; i < iter->second.size(); ++i) {
@@ -745,15 +974,48 @@ PluginBufferingAdapter::Impl::processBlock(FeatureSet& allFeatureSets)
             }
         }
     }
+
+    stepForward();
+}
+
+void
+PluginBufferingAdapter::Impl::processBlock(FeatureColumnSet& allFeatures)
+{
+    // As above, but copying columns from our reusable block feature
+    // set rather than copying Feature objects
+
+    RealTime timestamp = prepareBlock();
+
+    HostExt::processColumns(m_plugin, m_buffers, timestamp, m_blockColumns);
     
-    // step forward
+    RealTime adjustment = getTimestampAdjustment();
 
-    for (size_t i = 0; i < m_channels; ++i) {
-        m_queue[i]->skip(int(m_stepSize));
+    for (FeatureColumnSet::iterator iter = m_blockColumns.begin();
+         iter != m_blockColumns.end(); ++iter) {
+
+        const FeatureColumns &source = iter->second;
+        if (source.empty()) continue;
+
+        int outputNo = iter->first;
+        FeatureColumns &target = allFeatures[outputNo];
+        bool rewrite = m_rewriteOutputTimes[outputNo];
+        
+        for (size_t i = 0; i < source.size(); ++i) {
+
+            target.append(source, i);
+            if (!rewrite) continue;
+
+            size_t n = target.size() - 1;
+
+            RealTime t = target.getTimestamp(n);
+            if (rewriteFeatureTime(outputNo, target.hasTimestamp(n), t,
+                                   timestamp + adjustment)) {
+                target.setTimestamp(n, t);
+            }
+        }
     }
-    
-    // increment internal frame counter each time we step forward
-    m_frame += m_stepSize;
+
+    stepForward();
 }
 
 }
@@ -36,6 +36,12 @@
 
 #include <vamp-hostsdk/PluginChannelAdapter.h>
 
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "VectorOps.h"
+
 _VAMP_SDK_HOSTSPACE_BEGIN(PluginChannelAdapter.cpp)
 
 namespace Vamp {
@@ -48,19 +54,42 @@ public:
     Impl(Plugin *plugin);
     ~Impl();
 
+    bool setMixingMatrix(size_t pluginChannels, size_t inputChannels,
+                         const std::vector<float> &gains);
+    
     bool initialise(size_t channels, size_t stepSize, size_t blockSize);
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
+    void processColumns(const float *const *inputBuffers, RealTime timestamp,
+                        FeatureColumnSet &features);
     FeatureSet processInterleaved(const float *inputBuffers, RealTime timestamp);
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp);
 
 protected:
     Plugin *m_plugin;
+    size_t m_stepSize;
     size_t m_blockSize;
     size_t m_inputChannels;
     size_t m_pluginChannels;
     float **m_buffer;
     float **m_deinterleave;
     const float **m_forwardPtrs;
+    std::vector<float> m_batchBuffer;
+
+    // For each plugin channel, the input channels that contribute to
+    // it and their gains, if a mixing matrix has been set
+    std::vector<std::vector<size_t> > m_mixChannels;
+    std::vector<std::vector<float> > m_mixGains;
+    size_t m_mixInputChannels; // input channel count of the matrix
+    size_t m_mixInputsUsed; // one more than the highest input used
+    std::vector<const float *> m_mixSources;
+    std::vector<float> m_mixBuffer;
+
+    const float *const *prepareInput(const float *const *inputBuffers);
+    const float *const *applyMatrix(const float *const *inputBuffers,
+                                    size_t n, float *buffers);
 };
 
 PluginChannelAdapter::PluginChannelAdapter(Plugin *plugin) :
@@ -74,6 +103,14 @@ PluginChannelAdapter::~PluginChannelAdapter()
     delete m_impl;
 }
 
+bool
+PluginChannelAdapter::setMixingMatrix(size_t pluginChannels,
+                                      size_t inputChannels,
+                                      const std::vector<float> &gains)
+{
+    return m_impl->setMixingMatrix(pluginChannels, inputChannels, gains);
+}
+
 bool
 PluginChannelAdapter::initialise(size_t channels, size_t stepSize, size_t blockSize)
 {
@@ -87,6 +124,25 @@ PluginChannelAdapter::process(const float *const *inputBuffers,
     return m_impl->process(inputBuffers, timestamp);
 }
 
+void
+PluginChannelAdapter::processColumns(const float *const *inputBuffers,
+                                     RealTime timestamp,
+                                     FeatureColumnSet &features)
+{
+    m_impl->processColumns(inputBuffers, timestamp, features);
+}
+
+PluginChannelAdapter::FeatureSet
+PluginChannelAdapter::processBatch(const float *const *inputBuffers,
+                                   size_t frameCount,
+                                   RealTime startTimestamp,
+                                   size_t,
+                                   size_t,
+                                   size_t)
+{
+    return m_impl->processBatch(inputBuffers, frameCount, startTimestamp);
+}
+
 PluginChannelAdapter::FeatureSet
 PluginChannelAdapter::processInterleaved(const float *inputBuffers,
                                          RealTime timestamp)
@@ -96,12 +152,15 @@ PluginChannelAdapter::processInterleaved(const float *inputBuffers,
 
 PluginChannelAdapter::Impl::Impl(Plugin *plugin) :
     m_plugin(plugin),
+    m_stepSize(0),
     m_blockSize(0),
     m_inputChannels(0),
     m_pluginChannels(0),
     m_buffer(0),
     m_deinterleave(0),
-    m_forwardPtrs(0)
+    m_forwardPtrs(0),
+    m_mixInputChannels(0),
+    m_mixInputsUsed(0)
 {
 }
 
@@ -135,9 +194,52 @@ PluginChannelAdapter::Impl::~Impl()
     }
 }
 
+bool
+PluginChannelAdapter::Impl::setMixingMatrix(size_t pluginChannels,
+                                            size_t inputChannels,
+                                            const std::vector<float> &gains)
+{
+    if (m_blockSize != 0) {
+        std::cerr << "PluginChannelAdapter::setMixingMatrix: ERROR: Mixing matrix must be set before initialise()" << std::endl;
+        return false;
+    }
+
+    m_mixChannels.clear();
+    m_mixGains.clear();
+    m_mixInputChannels = 0;
+    m_mixInputsUsed = 0;
+
+    if (gains.empty()) return true;
+
+    if (pluginChannels == 0 || inputChannels == 0 ||
+        gains.size() != pluginChannels * inputChannels) {
+        std::cerr << "PluginChannelAdapter::setMixingMatrix: ERROR: Expected "
+                  << pluginChannels << " x " << inputChannels
+                  << " gains, got " << gains.size() << std::endl;
+        return false;
+    }
+
+    m_mixChannels.resize(pluginChannels);
+    m_mixGains.resize(pluginChannels);
+
+    for (size_t p = 0; p < pluginChannels; ++p) {
+        for (size_t i = 0; i < inputChannels; ++i) {
+            float gain = gains[p * inputChannels + i];
+            if (gain == 0.f) continue;
+            m_mixChannels[p].push_back(i);
+            m_mixGains[p].push_back(gain);
+            if (i >= m_mixInputsUsed) m_mixInputsUsed = i + 1;
+        }
+    }
+
+    m_mixInputChannels = inputChannels;
+    return true;
+}
+
 bool
 PluginChannelAdapter::Impl::initialise(size_t channels, size_t stepSize, size_t blockSize)
 {
+    m_stepSize = stepSize;
     m_blockSize = blockSize;
 
     size_t minch = m_plugin->getMinChannelCount();
@@ -145,6 +247,27 @@ PluginChannelAdapter::Impl::initialise(size_t channels, size_t stepSize, size_t
 
     m_inputChannels = channels;
 
+    if (!m_mixChannels.empty()) {
+
+        if (channels != m_mixInputChannels) {
+            std::cerr << "PluginChannelAdapter::initialise: ERROR: Mixing matrix expects " << m_mixInputChannels << " input channels, not " << channels << std::endl;
+            return false;
+        }
+
+        m_pluginChannels = m_mixChannels.size();
+
+        if (m_pluginChannels < minch || m_pluginChannels > maxch) {
+            std::cerr << "PluginChannelAdapter::initialise: ERROR: Mixing matrix produces " << m_pluginChannels << " channels, but plugin accepts only " << minch << " to " << maxch << std::endl;
+            return false;
+        }
+
+        m_forwardPtrs = new const float *[m_pluginChannels];
+        m_mixSources.resize(channels);
+        m_mixBuffer.resize(m_pluginChannels * blockSize);
+
+        return m_plugin->initialise(m_pluginChannels, stepSize, blockSize);
+    }
+
     if (m_inputChannels < minch) {
 
         m_forwardPtrs = new const float *[minch];
@@ -153,7 +276,7 @@ PluginChannelAdapter::Impl::initialise(size_t channels, size_t stepSize, size_t
             // We need a set of zero-valued buffers to add to the
             // forwarded pointers
             m_buffer = new float*[minch - channels];
-            for (size_t i = 0; i < minch; ++i) {
+            for (size_t i = 0; i < minch - channels; ++i) {
                 m_buffer[i] = new float[blockSize];
                 for (size_t j = 0; j < blockSize; ++j) {
                     m_buffer[i][j] = 0.f;
@@ -197,6 +320,20 @@ PluginChannelAdapter::FeatureSet
 PluginChannelAdapter::Impl::processInterleaved(const float *inputBuffers,
                                                RealTime timestamp)
 {
+    if (m_inputChannels == 1) {
+        // Interleaved mono is already in the form we want
+        return process(&inputBuffers, timestamp);
+    }
+    
+    if (m_mixChannels.empty() &&
+        m_inputChannels > m_pluginChannels && m_pluginChannels == 1) {
+        // Mix down straight from the interleaved input, rather than
+        // de-interleaving every channel first only to sum them again
+        VectorOps::mixDownInterleaved(inputBuffers, m_inputChannels,
+                                      m_buffer[0], m_blockSize);
+        return m_plugin->process(m_buffer, timestamp);
+    }
+    
     if (!m_deinterleave) {
         m_deinterleave = new float *[m_inputChannels];
         for (size_t i = 0; i < m_inputChannels; ++i) {
@@ -204,11 +341,14 @@ PluginChannelAdapter::Impl::processInterleaved(const float *inputBuffers,
         }
     }
 
-    for (size_t i = 0; i < m_inputChannels; ++i) {
-        for (size_t j = 0; j < m_blockSize; ++j) {
-            m_deinterleave[i][j] = inputBuffers[j * m_inputChannels + i];
-        }
-    }
+    // Any channels beyond those the plugin accepts (or the mixing
+    // matrix refers to) would be ignored, so there is no need to
+    // extract them
+    size_t needed = m_mixChannels.empty() ?
+        std::min(m_inputChannels, m_pluginChannels) : m_mixInputsUsed;
+    
+    VectorOps::deinterleave(inputBuffers, m_inputChannels,
+                            m_deinterleave, needed, m_blockSize);
 
     return process(m_deinterleave, timestamp);
 }
@@ -216,9 +356,28 @@ PluginChannelAdapter::Impl::processInterleaved(const float *inputBuffers,
 PluginChannelAdapter::FeatureSet
 PluginChannelAdapter::Impl::process(const float *const *inputBuffers,
                                     RealTime timestamp)
+{
+    return m_plugin->process(prepareInput(inputBuffers), timestamp);
+}
+
+void
+PluginChannelAdapter::Impl::processColumns(const float *const *inputBuffers,
+                                           RealTime timestamp,
+                                           FeatureColumnSet &features)
+{
+    HostExt::processColumns(m_plugin, prepareInput(inputBuffers),
+                            timestamp, features);
+}
+
+const float *const *
+PluginChannelAdapter::Impl::prepareInput(const float *const *inputBuffers)
 {
 //    std::cerr << "PluginChannelAdapter::process: " << m_inputChannels << " -> " << m_pluginChannels << " channels" << std::endl;
 
+    if (!m_mixChannels.empty()) {
+        return applyMatrix(inputBuffers, m_blockSize, &m_mixBuffer[0]);
+    }
+    
     if (m_inputChannels < m_pluginChannels) {
 
         if (m_inputChannels == 1) {
@@ -234,31 +393,109 @@ PluginChannelAdapter::Impl::process(const float *const *inputBuffers,
             }
         }
 
-        return m_plugin->process(m_forwardPtrs, timestamp);
+        return m_forwardPtrs;
 
     } else if (m_inputChannels > m_pluginChannels) {
 
         if (m_pluginChannels == 1) {
-            for (size_t j = 0; j < m_blockSize; ++j) {
-                m_buffer[0][j] = inputBuffers[0][j];
-            }
-            for (size_t i = 1; i < m_inputChannels; ++i) {
-                for (size_t j = 0; j < m_blockSize; ++j) {
-                    m_buffer[0][j] += inputBuffers[i][j];
-                }
+            VectorOps::mixDown(inputBuffers, m_inputChannels,
+                               m_buffer[0], m_blockSize);
+            return m_buffer;
+        } else {
+            return inputBuffers;
+        }
+
+    } else {
+
+        return inputBuffers;
+    }
+}
+
+const float *const *
+PluginChannelAdapter::Impl::applyMatrix(const float *const *inputBuffers,
+                                        size_t n, float *buffers)
+{
+    // Mix each plugin channel in a single pass into its own n-sample
+    // region of buffers, unless it can be forwarded from the input
+    // as it is
+    
+    for (size_t p = 0; p < m_pluginChannels; ++p) {
+
+        const std::vector<size_t> &channels = m_mixChannels[p];
+        const std::vector<float> &gains = m_mixGains[p];
+
+        if (channels.size() == 1 && gains[0] == 1.f) {
+            m_forwardPtrs[p] = inputBuffers[channels[0]];
+            continue;
+        }
+
+        float *out = buffers + p * n;
+        
+        if (channels.empty()) {
+            std::fill(out, out + n, 0.f);
+        } else {
+            for (size_t k = 0; k < channels.size(); ++k) {
+                m_mixSources[k] = inputBuffers[channels[k]];
             }
-            for (size_t j = 0; j < m_blockSize; ++j) {
-                m_buffer[0][j] /= float(m_inputChannels);
+            VectorOps::mix(&m_mixSources[0], &gains[0], channels.size(),
+                           out, n);
+        }
+
+        m_forwardPtrs[p] = out;
+    }
+
+    return m_forwardPtrs;
+}
+
+PluginChannelAdapter::FeatureSet
+PluginChannelAdapter::Impl::processBatch(const float *const *inputBuffers,
+                                         size_t frameCount,
+                                         RealTime startTimestamp)
+{
+    // As process(), except that the whole batch is mixed at once and
+    // the extra or mixed-down channels need to be frameCount long
+
+    if (frameCount < m_blockSize) return FeatureSet();
+
+    if (!m_mixChannels.empty()) {
+        m_batchBuffer.resize(m_pluginChannels * frameCount);
+        return m_plugin->processBatch
+            (applyMatrix(inputBuffers, frameCount, &m_batchBuffer[0]),
+             frameCount, startTimestamp,
+             m_pluginChannels, m_stepSize, m_blockSize);
+    }
+    
+    const float *const *forward = inputBuffers;
+
+    if (m_inputChannels < m_pluginChannels) {
+
+        if (m_inputChannels == 1) {
+            for (size_t i = 0; i < m_pluginChannels; ++i) {
+                m_forwardPtrs[i] = inputBuffers[0];
             }
-            return m_plugin->process(m_buffer, timestamp);
         } else {
-            return m_plugin->process(inputBuffers, timestamp);
+            m_batchBuffer.assign(frameCount, 0.f);
+            for (size_t i = 0; i < m_inputChannels; ++i) {
+                m_forwardPtrs[i] = inputBuffers[i];
+            }
+            for (size_t i = m_inputChannels; i < m_pluginChannels; ++i) {
+                m_forwardPtrs[i] = &m_batchBuffer[0];
+            }
         }
+        forward = m_forwardPtrs;
 
-    } else {
+    } else if (m_inputChannels > m_pluginChannels && m_pluginChannels == 1) {
 
-        return m_plugin->process(inputBuffers, timestamp);
+        m_batchBuffer.resize(frameCount);
+        float *mix = &m_batchBuffer[0];
+        VectorOps::mixDown(inputBuffers, m_inputChannels, mix, frameCount);
+        const float *mixed[1] = { mix };
+        return m_plugin->processBatch(mixed, frameCount, startTimestamp,
+                                      m_pluginChannels, m_stepSize, m_blockSize);
     }
+
+    return m_plugin->processBatch(forward, frameCount, startTimestamp,
+                                  m_pluginChannels, m_stepSize, m_blockSize);
 }
 
 }
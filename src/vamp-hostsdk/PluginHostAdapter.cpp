@@ -36,10 +36,12 @@
 
 #include <vamp-hostsdk/PluginHostAdapter.h>
 #include <cstdlib>
+#include <climits>
+#include <iostream>
 
 #include "Files.h"
 
-#if ( VAMP_SDK_MAJOR_VERSION != 2 || VAMP_SDK_MINOR_VERSION != 8 )
+#if ( VAMP_SDK_MAJOR_VERSION != 2 || VAMP_SDK_MINOR_VERSION != 9 )
 #error Unexpected version of Vamp SDK header included
 #endif
 
@@ -49,9 +51,16 @@ namespace Vamp
 {
 
 PluginHostAdapter::PluginHostAdapter(const VampPluginDescriptor *descriptor,
-                                     float inputSampleRate) :
+                                     float inputSampleRate,
+                                     const VampPluginBatchExtension *batchExtension,
+                                     const VampPluginWarmUpExtension *warmUpExtension) :
     Plugin(inputSampleRate),
-    m_descriptor(descriptor)
+    m_descriptor(descriptor),
+    m_batchExtension(batchExtension),
+    m_warmUpExtension(warmUpExtension),
+    m_outputsValid(false),
+    m_outputCount(0),
+    m_outputCountValid(false)
 {
 //    std::cerr << "PluginHostAdapter::PluginHostAdapter (plugin = " << descriptor->name << ")" << std::endl;
     m_handle = m_descriptor->instantiate(m_descriptor, inputSampleRate);
@@ -131,6 +140,7 @@ PluginHostAdapter::initialise(size_t channels,
                               size_t blockSize)
 {
     if (!m_handle) return false;
+    invalidateOutputs();
     return m_descriptor->initialise
         (m_handle,
          (unsigned int)channels,
@@ -251,6 +261,7 @@ PluginHostAdapter::setParameter(std::string param,
     for (unsigned int i = 0; i < m_descriptor->parameterCount; ++i) {
         if (param == m_descriptor->parameters[i]->identifier) {
             m_descriptor->setParameter(m_handle, i, value);
+            invalidateOutputs();
             return;
         }
     }
@@ -289,6 +300,7 @@ PluginHostAdapter::selectProgram(std::string program)
     for (unsigned int i = 0; i < m_descriptor->programCount; ++i) {
         if (program == m_descriptor->programs[i]) {
             m_descriptor->selectProgram(m_handle, i);
+            invalidateOutputs();
             return;
         }
     }
@@ -331,7 +343,11 @@ PluginHostAdapter::getOutputDescriptors() const
         return list;
     }
 
-    unsigned int count = m_descriptor->getOutputCount(m_handle);
+    if (m_outputsValid) {
+        return m_outputs;
+    }
+
+    unsigned int count = getOutputCount();
 
     for (unsigned int i = 0; i < count; ++i) {
         VampOutputDescriptor *sd = m_descriptor->getOutputDescriptor(m_handle, i);
@@ -375,9 +391,30 @@ PluginHostAdapter::getOutputDescriptors() const
         m_descriptor->releaseOutputDescriptor(sd);
     }
 
+    m_outputs = list;
+    m_outputsValid = true;
+
     return list;
 }
 
+unsigned int
+PluginHostAdapter::getOutputCount() const
+{
+    if (!m_outputCountValid) {
+        m_outputCount = m_descriptor->getOutputCount(m_handle);
+        m_outputCountValid = true;
+    }
+    return m_outputCount;
+}
+
+void
+PluginHostAdapter::invalidateOutputs()
+{
+    m_outputs.clear();
+    m_outputsValid = false;
+    m_outputCountValid = false;
+}
+
 PluginHostAdapter::FeatureSet
 PluginHostAdapter::process(const float *const *inputBuffers,
                            RealTime timestamp)
@@ -397,6 +434,76 @@ PluginHostAdapter::process(const float *const *inputBuffers,
     return fs;
 }
 
+void
+PluginHostAdapter::process(const float *const *inputBuffers,
+                           RealTime timestamp,
+                           FeatureSet &fs)
+{
+    if (!m_handle) {
+        fs.clear();
+        return;
+    }
+
+    VampFeatureList *features = m_descriptor->process(m_handle,
+                                                      inputBuffers,
+                                                      timestamp.sec,
+                                                      timestamp.nsec);
+    
+    convertFeaturesInPlace(features, fs);
+    m_descriptor->releaseFeatureSet(features);
+}
+
+void
+PluginHostAdapter::processColumns(const float *const *inputBuffers,
+                                  RealTime timestamp,
+                                  HostExt::FeatureColumnSet &fs)
+{
+    VampFeatureList *features = 0;
+
+    if (m_handle) {
+        features = m_descriptor->process(m_handle,
+                                         inputBuffers,
+                                         timestamp.sec,
+                                         timestamp.nsec);
+    }
+    
+    convertFeatureColumns(features, fs);
+    if (features) m_descriptor->releaseFeatureSet(features);
+}
+
+PluginHostAdapter::FeatureSet
+PluginHostAdapter::processBatch(const float *const *inputBuffers,
+                                size_t frameCount,
+                                RealTime startTimestamp,
+                                size_t channels,
+                                size_t stepSize,
+                                size_t blockSize)
+{
+    FeatureSet fs;
+    if (!m_handle) return fs;
+
+    if (m_descriptor->inputDomain != vampTimeDomain) {
+        std::cerr << "WARNING: PluginHostAdapter::processBatch: Batch processing is only available for time-domain plugins" << std::endl;
+        return fs;
+    }
+
+    if (m_batchExtension && frameCount <= UINT_MAX) {
+
+        VampFeatureList *features = m_batchExtension->processBatch
+            (m_handle, inputBuffers, (unsigned int)frameCount,
+             startTimestamp.sec, startTimestamp.nsec);
+
+        convertFeatures(features, fs);
+        m_descriptor->releaseFeatureSet(features);
+        return fs;
+    }
+
+    // The plugin can't do it for us, so call process for each block
+
+    return Plugin::processBatch(inputBuffers, frameCount, startTimestamp,
+                                channels, stepSize, blockSize);
+}
+
 PluginHostAdapter::FeatureSet
 PluginHostAdapter::getRemainingFeatures()
 {
@@ -410,13 +517,20 @@ PluginHostAdapter::getRemainingFeatures()
     return fs;
 }
 
+int
+PluginHostAdapter::getWarmUpFrames() const
+{
+    if (!m_handle || !m_warmUpExtension) return -1;
+    return m_warmUpExtension->getWarmUpFrames(m_handle);
+}
+
 void
 PluginHostAdapter::convertFeatures(VampFeatureList *features,
                                    FeatureSet &fs)
 {
     if (!features) return;
 
-    unsigned int outputs = m_descriptor->getOutputCount(m_handle);
+    unsigned int outputs = getOutputCount();
 
     for (unsigned int i = 0; i < outputs; ++i) {
         
@@ -424,45 +538,136 @@ PluginHostAdapter::convertFeatures(VampFeatureList *features,
 
         if (list.featureCount > 0) {
 
-            Feature feature;
-            feature.values.reserve(list.features[0].v1.valueCount);
+            FeatureList &target = fs[i];
+            size_t base = target.size();
+            target.resize(base + list.featureCount);
 
             for (unsigned int j = 0; j < list.featureCount; ++j) {
+                convertFeature(list, j, target[base + j]);
+            }
+        }
+    }
+}
 
-                feature.hasTimestamp = list.features[j].v1.hasTimestamp;
-                feature.timestamp = RealTime(list.features[j].v1.sec,
-                                             list.features[j].v1.nsec);
-                feature.hasDuration = false;
+void
+PluginHostAdapter::convertFeaturesInPlace(VampFeatureList *features,
+                                          FeatureSet &fs)
+{
+    // As convertFeatures, but overwriting the existing contents of
+    // fs, so as to reuse the storage of its lists, values and labels
 
-                if (m_descriptor->vampApiVersion >= 2) {
-                    unsigned int j2 = j + list.featureCount;
-                    feature.hasDuration = list.features[j2].v2.hasDuration;
-                    feature.duration = RealTime(list.features[j2].v2.durationSec,
-                                                list.features[j2].v2.durationNsec);
-                }
+    if (!features) {
+        for (FeatureSet::iterator i = fs.begin(); i != fs.end(); ++i) {
+            i->second.clear();
+        }
+        return;
+    }
 
-                for (unsigned int k = 0; k < list.features[j].v1.valueCount; ++k) {
-                    feature.values.push_back(list.features[j].v1.values[k]);
-                }
+    unsigned int outputs = getOutputCount();
 
-                if (list.features[j].v1.label) {
-                    feature.label = list.features[j].v1.label;
-                }
+    FeatureSet::iterator fi = fs.begin();
+    
+    for (unsigned int i = 0; i < outputs; ++i) {
 
-                fs[i].push_back(feature);
+        // Empty any lists for outputs that have no features this time
+        while (fi != fs.end() && fi->first < int(i)) {
+            fi->second.clear();
+            ++fi;
+        }
+        
+        VampFeatureList &list = features[i];
+
+        if (list.featureCount == 0) continue;
+
+        if (fi == fs.end() || fi->first != int(i)) {
+            fi = fs.insert(fi, FeatureSet::value_type(i, FeatureList()));
+        }
+
+        FeatureList &target = fi->second;
+        target.resize(list.featureCount);
+
+        for (unsigned int j = 0; j < list.featureCount; ++j) {
+            convertFeature(list, j, target[j]);
+        }
+
+        ++fi;
+    }
 
-                if (list.features[j].v1.valueCount > 0) {
-                    feature.values.clear();
-                }
+    while (fi != fs.end()) {
+        fi->second.clear();
+        ++fi;
+    }
+}
 
-                if (list.features[j].v1.label) {
-                    feature.label = "";
-                }
+void
+PluginHostAdapter::convertFeatureColumns(VampFeatureList *features,
+                                         HostExt::FeatureColumnSet &fs)
+{
+    for (HostExt::FeatureColumnSet::iterator i = fs.begin();
+         i != fs.end(); ++i) {
+        i->second.clear();
+    }
+
+    if (!features) return;
+    
+    unsigned int outputs = getOutputCount();
+    bool v2 = (m_descriptor->vampApiVersion >= 2);
+
+    for (unsigned int i = 0; i < outputs; ++i) {
+        
+        VampFeatureList &list = features[i];
+        if (list.featureCount == 0) continue;
+
+        HostExt::FeatureColumns &target = fs[i];
+
+        for (unsigned int j = 0; j < list.featureCount; ++j) {
+
+            const VampFeature &f = list.features[j].v1;
+            bool hasDuration = false;
+            RealTime duration;
+
+            if (v2) {
+                const VampFeatureV2 &f2 =
+                    list.features[j + list.featureCount].v2;
+                hasDuration = f2.hasDuration;
+                duration = RealTime(f2.durationSec, f2.durationNsec);
             }
+
+            target.append(f.hasTimestamp, RealTime(f.sec, f.nsec),
+                          hasDuration, duration,
+                          f.values, f.valueCount,
+                          f.label);
         }
     }
 }
 
+void
+PluginHostAdapter::convertFeature(const VampFeatureList &list,
+                                  unsigned int j,
+                                  Feature &feature)
+{
+    const VampFeature &f = list.features[j].v1;
+    
+    feature.hasTimestamp = f.hasTimestamp;
+    feature.timestamp = RealTime(f.sec, f.nsec);
+    feature.hasDuration = false;
+    feature.duration = RealTime();
+
+    if (m_descriptor->vampApiVersion >= 2) {
+        const VampFeatureV2 &f2 = list.features[j + list.featureCount].v2;
+        feature.hasDuration = f2.hasDuration;
+        feature.duration = RealTime(f2.durationSec, f2.durationNsec);
+    }
+
+    feature.values.assign(f.values, f.values + f.valueCount);
+
+    if (f.label) {
+        feature.label = f.label;
+    } else {
+        feature.label.clear();
+    }
+}
+
 }
 
 _VAMP_SDK_HOSTSPACE_END(PluginHostAdapter.cpp)
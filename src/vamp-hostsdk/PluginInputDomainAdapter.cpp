@@ -42,6 +42,7 @@
 #include <cmath>
 
 #include "Window.h"
+#include "Thread.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -49,6 +50,9 @@
 #include <string.h>
 #include <limits.h>
 
+#include <map>
+#include <vector>
+
 _VAMP_SDK_HOSTSPACE_BEGIN(PluginInputDomainAdapter.cpp)
 
 #include "../vamp-sdk/FFTimpl.cpp"
@@ -57,6 +61,51 @@ namespace Vamp {
 
 namespace HostExt {
 
+class PluginInputDomainAdapter::SharedSpectrum::Impl
+{
+public:
+    Impl(int capacity) :
+        m_capacity(capacity < 1 ? 1 : size_t(capacity)),
+        m_next(0) { }
+    ~Impl();
+
+    bool lookup(int blockSize, WindowType windowType,
+                const float *source, float *spectrum);
+
+    void store(int blockSize, WindowType windowType,
+               const float *source, const float *spectrum);
+
+private:
+    // Entries are found by a key made from a sample of the source
+    // block, so that a lookup examines at most one entry however many
+    // there are.  The mutex guards only the index and the use counts:
+    // an entry's data are written before it is published in m_index,
+    // and an entry in use is not overwritten but retired, to be
+    // deleted by its last user, so they can be read without the lock
+
+    struct Entry {
+        size_t key;
+        int blockSize;
+        WindowType windowType;
+        std::vector<float> source; // blockSize samples
+        std::vector<float> spectrum; // blockSize + 2 values
+        int users; // threads reading or writing the data
+        bool retired; // replaced while in use
+        Entry() : key(0), blockSize(0), windowType(HanningWindow),
+                  users(0), retired(false) { }
+    };
+
+    static size_t makeKey(int blockSize, WindowType windowType,
+                          const float *source);
+    void release(Entry *e); // call with m_mutex held
+
+    Mutex m_mutex;
+    std::map<size_t, Entry *> m_index; // key -> latest entry stored
+    std::vector<Entry *> m_entries; // in order of replacement
+    size_t m_capacity;
+    size_t m_next; // entry to be replaced next, once we're at capacity
+};
+
 class PluginInputDomainAdapter::Impl
 {
 public:
@@ -70,15 +119,25 @@ public:
     size_t getPreferredBlockSize() const;
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
+    void processColumns(const float *const *inputBuffers, RealTime timestamp,
+                        FeatureColumnSet &features);
 
     void setProcessTimestampMethod(ProcessTimestampMethod m);
     ProcessTimestampMethod getProcessTimestampMethod() const;
     
     RealTime getTimestampAdjustment() const;
 
+    int getWarmUpFrames() const;
+
     WindowType getWindowType() const;
     void setWindowType(WindowType type);
 
+    int getThreadCount() const;
+    void setThreadCount(int threads);
+
+    SharedSpectrum *getSharedSpectrum() const;
+    void setSharedSpectrum(SharedSpectrum *spectrum);
+
 protected:
     Plugin *m_plugin;
     float m_inputSampleRate;
@@ -86,7 +145,7 @@ protected:
     int m_stepSize;
     int m_blockSize;
     float **m_freqbuf;
-    Kiss::vamp_kiss_fft_scalar *m_ri;
+    SharedSpectrum *m_shared;
 
     WindowType m_windowType;
     typedef Window<Kiss::vamp_kiss_fft_scalar> W;
@@ -96,11 +155,44 @@ protected:
     int m_processCount;
     float **m_shiftBuffers;
 
-    Kiss::vamp_kiss_fftr_cfg m_cfg;
-    Kiss::vamp_kiss_fft_cpx *m_cbuf;
-
-    FeatureSet processShiftingTimestamp(const float *const *inputBuffers, RealTime timestamp);
-    FeatureSet processShiftingData(const float *const *inputBuffers, RealTime timestamp);
+    // Scratch space for transforming one channel. There is one of
+    // these per channel if we are transforming channels in parallel,
+    // or a single one shared by all channels otherwise
+    struct Transform {
+        Kiss::vamp_kiss_fft_scalar *ri;
+        Kiss::vamp_kiss_fftr_cfg cfg;
+        Kiss::vamp_kiss_fft_cpx *cbuf;
+    };
+    std::vector<Transform> m_transforms;
+
+    class ChannelTask : public ThreadPool::Task
+    {
+    public:
+        ChannelTask(Impl *impl, int channel) :
+            source(0), m_impl(impl), m_channel(channel) { }
+        void perform() {
+            m_impl->transformChannel(m_channel, source,
+                                     m_impl->m_transforms[m_channel]);
+        }
+        const float *source;
+    private:
+        Impl *m_impl;
+        int m_channel;
+    };
+    friend class ChannelTask;
+
+    int m_threadCount;
+    ThreadPool *m_pool;
+    std::vector<ChannelTask> m_channelTasks;
+    std::vector<ThreadPool::Task *> m_tasks;
+
+    void transformChannel(int c, const float *source, Transform &t);
+    void transformChannels(const float *const *sources);
+    void deallocate();
+
+    const float *const *prepareInput(const float *const *inputBuffers, RealTime &timestamp);
+    const float *const *prepareShiftingTimestamp(const float *const *inputBuffers, RealTime &timestamp);
+    const float *const *prepareShiftingData(const float *const *inputBuffers);
 
     size_t makeBlockSizeAcceptable(size_t) const;
     
@@ -154,6 +246,35 @@ PluginInputDomainAdapter::process(const float *const *inputBuffers, RealTime tim
     return m_impl->process(inputBuffers, timestamp);
 }
 
+void
+PluginInputDomainAdapter::processColumns(const float *const *inputBuffers,
+                                         RealTime timestamp,
+                                         FeatureColumnSet &features)
+{
+    m_impl->processColumns(inputBuffers, timestamp, features);
+}
+
+Plugin::FeatureSet
+PluginInputDomainAdapter::processBatch(const float *const *inputBuffers,
+                                       size_t frameCount,
+                                       RealTime startTimestamp,
+                                       size_t channels,
+                                       size_t stepSize,
+                                       size_t blockSize)
+{
+    if (m_plugin->getInputDomain() == TimeDomain) {
+        return PluginWrapper::processBatch(inputBuffers, frameCount,
+                                           startTimestamp, channels,
+                                           stepSize, blockSize);
+    }
+
+    // The plugin can only take one spectrum at a time, so transform
+    // and process each block in turn
+    
+    return Plugin::processBatch(inputBuffers, frameCount, startTimestamp,
+                                channels, stepSize, blockSize);
+}
+
 void
 PluginInputDomainAdapter::setProcessTimestampMethod(ProcessTimestampMethod m)
 {
@@ -172,6 +293,12 @@ PluginInputDomainAdapter::getTimestampAdjustment() const
     return m_impl->getTimestampAdjustment();
 }
 
+int
+PluginInputDomainAdapter::getWarmUpFrames() const
+{
+    return m_impl->getWarmUpFrames();
+}
+
 PluginInputDomainAdapter::WindowType
 PluginInputDomainAdapter::getWindowType() const
 {
@@ -184,6 +311,168 @@ PluginInputDomainAdapter::setWindowType(WindowType w)
     m_impl->setWindowType(w);
 }
 
+int
+PluginInputDomainAdapter::getThreadCount() const
+{
+    return m_impl->getThreadCount();
+}
+
+void
+PluginInputDomainAdapter::setThreadCount(int threads)
+{
+    m_impl->setThreadCount(threads);
+}
+
+PluginInputDomainAdapter::SharedSpectrum *
+PluginInputDomainAdapter::getSharedSpectrum() const
+{
+    return m_impl->getSharedSpectrum();
+}
+
+void
+PluginInputDomainAdapter::setSharedSpectrum(SharedSpectrum *spectrum)
+{
+    m_impl->setSharedSpectrum(spectrum);
+}
+
+PluginInputDomainAdapter::SharedSpectrum::SharedSpectrum(int capacity) :
+    m_impl(new Impl(capacity))
+{
+}
+
+PluginInputDomainAdapter::SharedSpectrum::~SharedSpectrum()
+{
+    delete m_impl;
+}
+
+PluginInputDomainAdapter::SharedSpectrum::Impl::~Impl()
+{
+    // The adapters have all gone, so no entry is in use
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        delete m_entries[i];
+    }
+}
+
+size_t
+PluginInputDomainAdapter::SharedSpectrum::Impl::makeKey(int blockSize,
+                                                        WindowType windowType,
+                                                        const float *source)
+{
+    // FNV-1a over the bits of up to 64 evenly spaced samples.  Blocks
+    // that differ only elsewhere share a key, and then only the one
+    // stored most recently can be found, which costs a transform but
+    // never gives a wrong result
+
+    unsigned int h = 2166136261u;
+    h = (h ^ (unsigned int)blockSize) * 16777619u;
+    h = (h ^ (unsigned int)windowType) * 16777619u;
+
+    int stride = blockSize / 64;
+    if (stride < 1) stride = 1;
+
+    for (int i = 0; i < blockSize; i += stride) {
+        unsigned int bits;
+        memcpy(&bits, source + i, sizeof(bits));
+        h = (h ^ bits) * 16777619u;
+    }
+
+    return h;
+}
+
+void
+PluginInputDomainAdapter::SharedSpectrum::Impl::release(Entry *e)
+{
+    if (--e->users == 0 && e->retired) {
+        delete e;
+    }
+}
+
+bool
+PluginInputDomainAdapter::SharedSpectrum::Impl::lookup(int blockSize,
+                                                       WindowType windowType,
+                                                       const float *source,
+                                                       float *spectrum)
+{
+    size_t key = makeKey(blockSize, windowType, source);
+    
+    Entry *e = 0;
+    {
+        MutexLocker locker(&m_mutex);
+        std::map<size_t, Entry *>::iterator i = m_index.find(key);
+        if (i == m_index.end()) return false;
+        e = i->second;
+        if (e->blockSize != blockSize || e->windowType != windowType) {
+            return false;
+        }
+        ++e->users;
+    }
+
+    bool found =
+        !memcmp(&e->source[0], source, blockSize * sizeof(float));
+    if (found) {
+        memcpy(spectrum, &e->spectrum[0], (blockSize + 2) * sizeof(float));
+    }
+
+    MutexLocker locker(&m_mutex);
+    release(e);
+    return found;
+}
+
+void
+PluginInputDomainAdapter::SharedSpectrum::Impl::store(int blockSize,
+                                                      WindowType windowType,
+                                                      const float *source,
+                                                      const float *spectrum)
+{
+    size_t key = makeKey(blockSize, windowType, source);
+
+    // Claim the next entry, taking it out of the index
+
+    Entry *e = 0;
+    {
+        MutexLocker locker(&m_mutex);
+
+        if (m_entries.size() < m_capacity) {
+            m_entries.push_back(0);
+            m_next = m_entries.size() - 1;
+        }
+
+        e = m_entries[m_next];
+
+        if (e) {
+            std::map<size_t, Entry *>::iterator i = m_index.find(e->key);
+            if (i != m_index.end() && i->second == e) {
+                m_index.erase(i);
+            }
+            if (e->users > 0) {
+                e->retired = true;
+                e = 0;
+            }
+        }
+
+        if (!e) {
+            e = new Entry;
+            m_entries[m_next] = e;
+        }
+
+        e->users = 1;
+        m_next = (m_next + 1) % m_capacity;
+    }
+
+    e->key = key;
+    e->blockSize = blockSize;
+    e->windowType = windowType;
+    e->source.assign(source, source + blockSize);
+    e->spectrum.assign(spectrum, spectrum + blockSize + 2);
+
+    // Publish it, unless it was claimed again meanwhile
+
+    MutexLocker locker(&m_mutex);
+    if (!e->retired) {
+        m_index[key] = e;
+    }
+    release(e);
+}
 
 PluginInputDomainAdapter::Impl::Impl(Plugin *plugin, float inputSampleRate) :
     m_plugin(plugin),
@@ -192,14 +481,14 @@ PluginInputDomainAdapter::Impl::Impl(Plugin *plugin, float inputSampleRate) :
     m_stepSize(0),
     m_blockSize(0),
     m_freqbuf(0),
-    m_ri(0),
+    m_shared(0),
     m_windowType(HanningWindow),
     m_window(0),
     m_method(ShiftTimestamp),
     m_processCount(0),
     m_shiftBuffers(0),
-    m_cfg(0),
-    m_cbuf(0)
+    m_threadCount(1),
+    m_pool(0)
 {
 }
 
@@ -214,20 +503,35 @@ PluginInputDomainAdapter::Impl::~Impl()
         delete[] m_shiftBuffers;
     }
 
-    if (m_channels > 0) {
+    deallocate();
+}
+
+void
+PluginInputDomainAdapter::Impl::deallocate()
+{
+    if (m_freqbuf) {
         for (int c = 0; c < m_channels; ++c) {
             delete[] m_freqbuf[c];
         }
         delete[] m_freqbuf;
-        delete[] m_ri;
-        if (m_cfg) {
-            Kiss::vamp_kiss_fftr_free(m_cfg);
-            m_cfg = 0;
-            delete[] m_cbuf;
-            m_cbuf = 0;
-        }
-        delete m_window;
+        m_freqbuf = 0;
     }
+
+    for (size_t i = 0; i < m_transforms.size(); ++i) {
+        delete[] m_transforms[i].ri;
+        Kiss::vamp_kiss_fftr_release(m_transforms[i].cfg);
+        delete[] m_transforms[i].cbuf;
+    }
+    m_transforms.clear();
+
+    m_channelTasks.clear();
+    m_tasks.clear();
+
+    delete m_pool;
+    m_pool = 0;
+
+    delete m_window;
+    m_window = 0;
 }
 
 // for some visual studii apparently
@@ -257,20 +561,7 @@ PluginInputDomainAdapter::Impl::initialise(size_t channels, size_t stepSize, siz
         return false;
     }
 
-    if (m_channels > 0) {
-        for (int c = 0; c < m_channels; ++c) {
-            delete[] m_freqbuf[c];
-        }
-        delete[] m_freqbuf;
-        delete[] m_ri;
-        if (m_cfg) {
-            Kiss::vamp_kiss_fftr_free(m_cfg);
-            m_cfg = 0;
-            delete[] m_cbuf;
-            m_cbuf = 0;
-        }
-        delete m_window;
-    }
+    deallocate();
 
     m_stepSize = int(stepSize);
     m_blockSize = int(blockSize);
@@ -280,12 +571,38 @@ PluginInputDomainAdapter::Impl::initialise(size_t channels, size_t stepSize, siz
     for (int c = 0; c < m_channels; ++c) {
         m_freqbuf[c] = new float[m_blockSize + 2];
     }
-    m_ri = new Kiss::vamp_kiss_fft_scalar[m_blockSize];
 
     m_window = new W(convertType(m_windowType), m_blockSize);
 
-    m_cfg = Kiss::vamp_kiss_fftr_alloc(m_blockSize, false, 0, 0);
-    m_cbuf = new Kiss::vamp_kiss_fft_cpx[m_blockSize/2+1];
+    // The kiss_fftr config contains scratch space of its own, so
+    // each thread needs its own config as well as its own buffers.
+    // Configs come from a process-wide cache, so that we don't have
+    // to recalculate twiddle factors for every plugin instance
+
+    int threads = m_threadCount;
+    if (threads > m_channels) threads = m_channels;
+    if (threads < 1) threads = 1;
+    
+    int transforms = (threads > 1 ? m_channels : 1);
+
+    for (int i = 0; i < transforms; ++i) {
+        Transform t;
+        t.ri = new Kiss::vamp_kiss_fft_scalar[m_blockSize];
+        t.cfg = Kiss::vamp_kiss_fftr_acquire(m_blockSize, false);
+        t.cbuf = new Kiss::vamp_kiss_fft_cpx[m_blockSize/2+1];
+        m_transforms.push_back(t);
+    }
+
+    if (threads > 1) {
+        // The calling thread joins in, so we need one fewer workers
+        m_pool = new ThreadPool(threads - 1);
+        for (int c = 0; c < m_channels; ++c) {
+            m_channelTasks.push_back(ChannelTask(this, c));
+        }
+        for (int c = 0; c < m_channels; ++c) {
+            m_tasks.push_back(&m_channelTasks[c]);
+        }
+    }
 
     m_processCount = 0;
 
@@ -359,6 +676,18 @@ PluginInputDomainAdapter::Impl::getTimestampAdjustment() const
     }
 }
 
+int
+PluginInputDomainAdapter::Impl::getWarmUpFrames() const
+{
+    int frames = m_plugin->getWarmUpFrames();
+    if (frames < 0) return frames;
+    if (m_plugin->getInputDomain() == FrequencyDomain &&
+        m_method == ShiftData) {
+        frames += m_blockSize/2;
+    }
+    return frames;
+}
+
 void
 PluginInputDomainAdapter::Impl::setProcessTimestampMethod(ProcessTimestampMethod m)
 {
@@ -388,6 +717,30 @@ PluginInputDomainAdapter::Impl::getWindowType() const
     return m_windowType;
 }
 
+void
+PluginInputDomainAdapter::Impl::setThreadCount(int threads)
+{
+    m_threadCount = (threads < 1 ? 1 : threads);
+}
+
+int
+PluginInputDomainAdapter::Impl::getThreadCount() const
+{
+    return m_threadCount;
+}
+
+void
+PluginInputDomainAdapter::Impl::setSharedSpectrum(SharedSpectrum *spectrum)
+{
+    m_shared = spectrum;
+}
+
+PluginInputDomainAdapter::SharedSpectrum *
+PluginInputDomainAdapter::Impl::getSharedSpectrum() const
+{
+    return m_shared;
+}
+
 PluginInputDomainAdapter::Impl::W::WindowType
 PluginInputDomainAdapter::Impl::convertType(WindowType t) const
 {
@@ -414,21 +767,81 @@ PluginInputDomainAdapter::Impl::convertType(WindowType t) const
 Plugin::FeatureSet
 PluginInputDomainAdapter::Impl::process(const float *const *inputBuffers,
                                         RealTime timestamp)
+{
+    const float *const *buffers = prepareInput(inputBuffers, timestamp);
+    return m_plugin->process(buffers, timestamp);
+}
+
+void
+PluginInputDomainAdapter::Impl::processColumns(const float *const *inputBuffers,
+                                               RealTime timestamp,
+                                               FeatureColumnSet &features)
+{
+    const float *const *buffers = prepareInput(inputBuffers, timestamp);
+    HostExt::processColumns(m_plugin, buffers, timestamp, features);
+}
+
+const float *const *
+PluginInputDomainAdapter::Impl::prepareInput(const float *const *inputBuffers,
+                                             RealTime &timestamp)
 {
     if (m_plugin->getInputDomain() == TimeDomain) {
-        return m_plugin->process(inputBuffers, timestamp);
+        return inputBuffers;
     }
 
     if (m_method == ShiftTimestamp || m_method == NoShift) {
-        return processShiftingTimestamp(inputBuffers, timestamp);
+        return prepareShiftingTimestamp(inputBuffers, timestamp);
     } else {
-        return processShiftingData(inputBuffers, timestamp);
+        return prepareShiftingData(inputBuffers);
     }
 }
 
-Plugin::FeatureSet
-PluginInputDomainAdapter::Impl::processShiftingTimestamp(const float *const *inputBuffers,
-                                                         RealTime timestamp)
+void
+PluginInputDomainAdapter::Impl::transformChannel(int c,
+                                                 const float *source,
+                                                 Transform &t)
+{
+    if (m_shared &&
+        m_shared->m_impl->lookup(m_blockSize, m_windowType,
+                                 source, m_freqbuf[c])) {
+        return;
+    }
+    
+    m_window->cutAndShift(source, t.ri);
+
+    Kiss::vamp_kiss_fftr(t.cfg, t.ri, t.cbuf);
+        
+    for (int i = 0; i <= m_blockSize/2; ++i) {
+        m_freqbuf[c][i * 2] = float(t.cbuf[i].r);
+        m_freqbuf[c][i * 2 + 1] = float(t.cbuf[i].i);
+    }
+
+    if (m_shared) {
+        m_shared->m_impl->store(m_blockSize, m_windowType,
+                                source, m_freqbuf[c]);
+    }
+}
+
+void
+PluginInputDomainAdapter::Impl::transformChannels(const float *const *sources)
+{
+    if (!m_pool) {
+        for (int c = 0; c < m_channels; ++c) {
+            transformChannel(c, sources[c], m_transforms[0]);
+        }
+        return;
+    }
+
+    for (int c = 0; c < m_channels; ++c) {
+        m_channelTasks[c].source = sources[c];
+    }
+
+    m_pool->run(m_tasks);
+}
+
+const float *const *
+PluginInputDomainAdapter::Impl::prepareShiftingTimestamp(const float *const *inputBuffers,
+                                                         RealTime &timestamp)
 {
     unsigned int roundedRate = 1;
     if (m_inputSampleRate > 0.f) {
@@ -446,31 +859,13 @@ PluginInputDomainAdapter::Impl::processShiftingTimestamp(const float *const *inp
         }
     }
 
-    for (int c = 0; c < m_channels; ++c) {
-
-        m_window->cut(inputBuffers[c], m_ri);
-
-        for (int i = 0; i < m_blockSize/2; ++i) {
-            // FFT shift
-            Kiss::vamp_kiss_fft_scalar value = m_ri[i];
-            m_ri[i] = m_ri[i + m_blockSize/2];
-            m_ri[i + m_blockSize/2] = value;
-        }
+    transformChannels(inputBuffers);
 
-        Kiss::vamp_kiss_fftr(m_cfg, m_ri, m_cbuf);
-        
-        for (int i = 0; i <= m_blockSize/2; ++i) {
-            m_freqbuf[c][i * 2] = float(m_cbuf[i].r);
-            m_freqbuf[c][i * 2 + 1] = float(m_cbuf[i].i);
-        }
-    }
-
-    return m_plugin->process(m_freqbuf, timestamp);
+    return m_freqbuf;
 }
 
-Plugin::FeatureSet
-PluginInputDomainAdapter::Impl::processShiftingData(const float *const *inputBuffers,
-                                                    RealTime timestamp)
+const float *const *
+PluginInputDomainAdapter::Impl::prepareShiftingData(const float *const *inputBuffers)
 {
     if (m_processCount == 0) {
         if (!m_shiftBuffers) {
@@ -495,28 +890,11 @@ PluginInputDomainAdapter::Impl::processShiftingData(const float *const *inputBuf
         }
     }
 
-    for (int c = 0; c < m_channels; ++c) {
-
-        m_window->cut(m_shiftBuffers[c], m_ri);
-
-        for (int i = 0; i < m_blockSize/2; ++i) {
-            // FFT shift
-            Kiss::vamp_kiss_fft_scalar value = m_ri[i];
-            m_ri[i] = m_ri[i + m_blockSize/2];
-            m_ri[i + m_blockSize/2] = value;
-        }
-
-        Kiss::vamp_kiss_fftr(m_cfg, m_ri, m_cbuf);
-        
-        for (int i = 0; i <= m_blockSize/2; ++i) {
-            m_freqbuf[c][i * 2] = float(m_cbuf[i].r);
-            m_freqbuf[c][i * 2 + 1] = float(m_cbuf[i].i);
-        }
-    }
+    transformChannels(m_shiftBuffers);
 
     ++m_processCount;
 
-    return m_plugin->process(m_freqbuf, timestamp);
+    return m_freqbuf;
 }
 
 }
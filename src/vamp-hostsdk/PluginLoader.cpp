@@ -43,8 +43,11 @@
 #include <vamp/vamp.h>
 
 #include "Files.h"
+#include "Thread.h"
 
 #include <fstream>
+#include <cstdio>
+#include <set>
 
 using namespace std;
 
@@ -74,6 +77,9 @@ public:
 
     string getLibraryPathForPlugin(PluginKey key);
 
+    void setIndexFile(string path);
+    void setScanThreadCount(int threads);
+
     static void setInstanceToClean(PluginLoader *instance);
 
 protected:
@@ -81,6 +87,9 @@ protected:
     public:
         PluginDeletionNotifyAdapter(Plugin *plugin, Impl *loader);
         virtual ~PluginDeletionNotifyAdapter();
+        void processColumns(const float *const *inputBuffers,
+                            RealTime timestamp,
+                            FeatureColumnSet &features);
     protected:
         Impl *m_loader;
     };
@@ -111,6 +120,37 @@ protected:
     /// that were added to it
     vector<PluginKey> enumeratePlugins(Enumeration);
 
+    /// The identifiers of the plugins found in a single library,
+    /// and where they came from
+    struct LibrarySearch : public ThreadPool::Task {
+        string fullPath;
+        string stamp;
+        vector<string> identifiers;
+        bool loaded;
+        bool hasDescriptorFunction;
+        bool fromIndex;
+        string error; // from loading the library, to be printed later
+        LibrarySearch() :
+            loaded(false), hasDescriptorFunction(false), fromIndex(false) { }
+        /// Load the library and list its plugins
+        void perform();
+    };
+
+    int m_scanThreadCount;
+
+    struct IndexEntry {
+        string stamp;
+        vector<string> identifiers;
+    };
+    map<string, IndexEntry> m_index; // library path -> entry
+    string m_indexFile;
+    bool m_indexLoaded;
+    bool m_indexChanged;
+    void loadIndex();
+    void saveIndex();
+    bool lookUpIndex(LibrarySearch &search);
+    void updateIndex(const LibrarySearch &search);
+
     map<PluginKey, PluginCategoryHierarchy> m_taxonomy;
     void generateTaxonomy();
 
@@ -194,10 +234,29 @@ PluginLoader::getLibraryPathForPlugin(PluginKey key)
 {
     return m_impl->getLibraryPathForPlugin(key);
 }
+
+void
+PluginLoader::setIndexFile(string path)
+{
+    m_impl->setIndexFile(path);
+}
+
+void
+PluginLoader::setScanThreadCount(int threads)
+{
+    m_impl->setScanThreadCount(threads);
+}
  
 PluginLoader::Impl::Impl() :
-    m_allPluginsEnumerated(false)
+    m_allPluginsEnumerated(false),
+    m_scanThreadCount(1),
+    m_indexLoaded(false),
+    m_indexChanged(false)
 {
+    string path;
+    if (Files::getEnvUtf8("VAMP_PLUGIN_INDEX", path)) {
+        m_indexFile = path;
+    }
 }
 
 PluginLoader::Impl::~Impl()
@@ -298,40 +357,70 @@ PluginLoader::Impl::enumeratePlugins(Enumeration enumeration)
                      enumeration.type == Enumeration::InLibraries);
 
     vector<PluginKey> added;
-    
+
+    if (m_indexFile != "" && !m_indexLoaded) {
+        loadIndex();
+    }
+
+    // Take what we can from the index, and search the remaining
+    // libraries (possibly concurrently), before merging the results
+    // in path order so that the outcome is the same however the
+    // searches were carried out
+
+    vector<LibrarySearch> searches(fullPaths.size());
+    vector<ThreadPool::Task *> tasks;
+
     for (size_t i = 0; i < fullPaths.size(); ++i) {
+        searches[i].fullPath = fullPaths[i];
+        if (!lookUpIndex(searches[i])) {
+            tasks.push_back(&searches[i]);
+        }
+    }
 
-        string fullPath = fullPaths[i];
-        void *handle = Files::loadLibrary(fullPath);
-        if (!handle) continue;
-            
-        VampGetPluginDescriptorFunction fn =
-            (VampGetPluginDescriptorFunction)Files::lookupInLibrary
-            (handle, "vampGetPluginDescriptor");
-            
-        if (!fn) {
-            if (specific) {
-                cerr << "Vamp::HostExt::PluginLoader: "
-                    << "No vampGetPluginDescriptor function found in library \""
-                     << fullPath << "\"" << endl;
-            }
-            Files::unloadLibrary(handle);
-            continue;
+    int threads = m_scanThreadCount;
+    if (threads > int(tasks.size())) threads = int(tasks.size());
+
+    if (threads > 1) {
+        // The calling thread joins in, so we need one fewer workers
+        ThreadPool pool(threads - 1);
+        pool.run(tasks);
+    } else {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            tasks[i]->perform();
+        }
+    }
+    
+    for (size_t i = 0; i < searches.size(); ++i) {
+
+        const LibrarySearch &search = searches[i];
+        string fullPath = search.fullPath;
+
+        if (search.error != "") {
+            cerr << "Vamp::HostExt: " << search.error << endl;
+        }
+
+        if (!search.loaded) continue;
+
+        if (!search.hasDescriptorFunction && specific) {
+            cerr << "Vamp::HostExt::PluginLoader: "
+                 << "No vampGetPluginDescriptor function found in library \""
+                 << fullPath << "\"" << endl;
+        }
+
+        if (!search.fromIndex) {
+            updateIndex(search);
         }
             
-        int index = 0;
-        const VampPluginDescriptor *descriptor = 0;
         bool found = false;
             
-        while ((descriptor = fn(VAMP_API_VERSION, index))) {
-            ++index;
+        for (size_t j = 0; j < search.identifiers.size(); ++j) {
             if (identifier != "") {
-                if (descriptor->identifier != identifier) {
+                if (search.identifiers[j] != identifier) {
                     continue;
                 }
             }
             found = true;
-            PluginKey key = composePluginKey(fullPath, descriptor->identifier);
+            PluginKey key = composePluginKey(fullPath, search.identifiers[j]);
             if (m_pluginLibraryNameMap.find(key) ==
                 m_pluginLibraryNameMap.end()) {
                 m_pluginLibraryNameMap[key] = fullPath;
@@ -344,17 +433,206 @@ PluginLoader::Impl::enumeratePlugins(Enumeration enumeration)
                  << identifier << "\" not found in library \""
                  << fullPath << "\"" << endl;
         }
-            
-        Files::unloadLibrary(handle);
     }
 
     if (enumeration.type == Enumeration::All) {
         m_allPluginsEnumerated = true;
     }
 
+    if (m_indexFile != "") {
+        if (enumeration.type == Enumeration::All) {
+            // Forget any libraries that are no longer on the path
+            set<string> present(fullPaths.begin(), fullPaths.end());
+            map<string, IndexEntry>::iterator i = m_index.begin();
+            while (i != m_index.end()) {
+                if (present.find(i->first) == present.end()) {
+                    m_index.erase(i++);
+                    m_indexChanged = true;
+                } else {
+                    ++i;
+                }
+            }
+        }
+        if (m_indexChanged) {
+            saveIndex();
+        }
+    }
+
     return added;
 }
 
+void
+PluginLoader::Impl::LibrarySearch::perform()
+{
+    // This may be called from a scanning thread, so must not touch
+    // the loader or print anything
+
+    void *handle = Files::loadLibrary(fullPath, error);
+    if (!handle) return;
+
+    loaded = true;
+            
+    VampGetPluginDescriptorFunction fn =
+        (VampGetPluginDescriptorFunction)Files::lookupInLibrary
+        (handle, "vampGetPluginDescriptor");
+            
+    if (fn) {
+        hasDescriptorFunction = true;
+        int index = 0;
+        const VampPluginDescriptor *descriptor = 0;
+        while ((descriptor = fn(VAMP_API_VERSION, index))) {
+            ++index;
+            identifiers.push_back(descriptor->identifier);
+        }
+    }
+
+    Files::unloadLibrary(handle);
+}
+
+bool
+PluginLoader::Impl::lookUpIndex(LibrarySearch &search)
+{
+    if (m_indexFile == "" ||
+        !Files::getFileStamp(search.fullPath, search.stamp)) {
+        return false;
+    }
+
+    map<string, IndexEntry>::const_iterator i = m_index.find(search.fullPath);
+    if (i == m_index.end() || i->second.stamp != search.stamp) {
+        return false;
+    }
+
+    search.identifiers = i->second.identifiers;
+    search.loaded = true;
+    search.hasDescriptorFunction = true;
+    search.fromIndex = true;
+    return true;
+}
+
+void
+PluginLoader::Impl::updateIndex(const LibrarySearch &search)
+{
+    if (m_indexFile == "" || search.stamp == "") return;
+
+    // A library with no plugin descriptor function is indexed with
+    // no plugins, so that we don't keep reloading it
+    IndexEntry entry;
+    entry.stamp = search.stamp;
+    entry.identifiers = search.identifiers;
+    m_index[search.fullPath] = entry;
+    m_indexChanged = true;
+}
+
+void
+PluginLoader::Impl::setScanThreadCount(int threads)
+{
+    m_scanThreadCount = (threads < 1 ? 1 : threads);
+}
+
+void
+PluginLoader::Impl::setIndexFile(string path)
+{
+    if (path == m_indexFile) return;
+    m_indexFile = path;
+    m_index.clear();
+    m_indexLoaded = false;
+    m_indexChanged = false;
+}
+
+// The index file is plain text: a header line, then for each library
+// a line "library <stamp> <path>" followed by a line "plugin <id>"
+// for each plugin in it, then a line "end". Anything unreadable
+// means the whole file is ignored and the index will be rebuilt.
+
+static const char *const indexHeader = "Vamp plugin index 1";
+
+void
+PluginLoader::Impl::loadIndex()
+{
+    m_indexLoaded = true;
+    m_index.clear();
+    
+    ifstream is(m_indexFile.c_str(), ifstream::in | ifstream::binary);
+    if (is.fail()) return;
+
+    map<string, IndexEntry> index;
+    IndexEntry *entry = 0;
+    bool complete = false;
+    string line;
+
+    if (!getline(is, line) || line != indexHeader) return;
+
+    while (getline(is, line)) {
+        if (line == "end") {
+            complete = true;
+            break;
+        }
+        if (line.substr(0, 8) == "library ") {
+            string::size_type si = line.find(' ', 8);
+            if (si == string::npos) return;
+            string path = line.substr(si + 1);
+            entry = &index[path];
+            entry->stamp = line.substr(8, si - 8);
+        } else if (line.substr(0, 7) == "plugin " && entry) {
+            entry->identifiers.push_back(line.substr(7));
+        } else {
+            return;
+        }
+    }
+
+    if (complete) {
+        m_index = index;
+    }
+}
+
+void
+PluginLoader::Impl::saveIndex()
+{
+    // Write to a temporary file and move it into place, so that
+    // another process never sees a partly-written index.  The
+    // temporary file is unique to this call, so that two processes
+    // saving at once cannot move each other's partial files
+    string tmpFile = Files::getTemporaryName(m_indexFile);
+    
+    ofstream os(tmpFile.c_str(), ofstream::out | ofstream::binary);
+    if (os.fail()) {
+        cerr << "WARNING: Vamp::HostExt::PluginLoader: Failed to write "
+             << "plugin index file \"" << tmpFile << "\"" << endl;
+        return;
+    }
+
+    os << indexHeader << "\n";
+    for (map<string, IndexEntry>::const_iterator i = m_index.begin();
+         i != m_index.end(); ++i) {
+        os << "library " << i->second.stamp << " " << i->first << "\n";
+        for (size_t j = 0; j < i->second.identifiers.size(); ++j) {
+            os << "plugin " << i->second.identifiers[j] << "\n";
+        }
+    }
+    os << "end\n";
+    os.close();
+
+    if (os.fail()) {
+        cerr << "WARNING: Vamp::HostExt::PluginLoader: Failed to write "
+             << "plugin index file \"" << tmpFile << "\"" << endl;
+        remove(tmpFile.c_str());
+        return;
+    }
+
+#ifdef _WIN32
+    // rename does not replace an existing file here
+    remove(m_indexFile.c_str());
+#endif
+    if (rename(tmpFile.c_str(), m_indexFile.c_str()) != 0) {
+        cerr << "WARNING: Vamp::HostExt::PluginLoader: Failed to replace "
+             << "plugin index file \"" << m_indexFile << "\"" << endl;
+        remove(tmpFile.c_str());
+        return;
+    }
+
+    m_indexChanged = false;
+}
+
 PluginLoader::PluginKey
 PluginLoader::Impl::composePluginKey(string libraryName, string identifier)
 {
@@ -434,6 +712,14 @@ PluginLoader::Impl::loadPlugin(PluginKey key,
         return 0;
     }
 
+    // Optional; older plugin libraries will not have it
+    VampGetPluginBatchExtensionFunction batchFn =
+        (VampGetPluginBatchExtensionFunction)Files::lookupInLibrary
+        (handle, "vampGetPluginBatchExtension");
+    VampGetPluginWarmUpExtensionFunction warmUpFn =
+        (VampGetPluginWarmUpExtensionFunction)Files::lookupInLibrary
+        (handle, "vampGetPluginWarmUpExtension");
+
     int index = 0;
     const VampPluginDescriptor *descriptor = 0;
 
@@ -441,8 +727,16 @@ PluginLoader::Impl::loadPlugin(PluginKey key,
 
         if (string(descriptor->identifier) == identifier) {
 
+            const VampPluginBatchExtension *batchExtension = 0;
+            if (batchFn) batchExtension = batchFn(descriptor);
+
+            const VampPluginWarmUpExtension *warmUpExtension = 0;
+            if (warmUpFn) warmUpExtension = warmUpFn(descriptor);
+
             Vamp::PluginHostAdapter *plugin =
-                new Vamp::PluginHostAdapter(descriptor, inputSampleRate);
+                new Vamp::PluginHostAdapter(descriptor, inputSampleRate,
+                                            batchExtension,
+                                            warmUpExtension);
 
             Plugin *adapter = new PluginDeletionNotifyAdapter(plugin, this);
 
@@ -592,6 +886,15 @@ PluginLoader::Impl::PluginDeletionNotifyAdapter::~PluginDeletionNotifyAdapter()
     if (m_loader) m_loader->pluginDeleted(this);
 }
 
+void
+PluginLoader::Impl::PluginDeletionNotifyAdapter::processColumns(const float *const *inputBuffers,
+                                                                RealTime timestamp,
+                                                                FeatureColumnSet &features)
+{
+    // We don't change the features, so pass through to the plugin
+    HostExt::processColumns(m_plugin, inputBuffers, timestamp, features);
+}
+
 }
 
 }
@@ -37,10 +37,17 @@
 #include <vamp-hostsdk/PluginSummarisingAdapter.h>
 
 #include <map>
+#include <set>
+#include <deque>
+#include <iterator>
 #include <algorithm>
 #include <cmath>
 #include <climits>
 
+#include <cstring>
+
+#include "Thread.h"
+
 using namespace std;
 
 //#define DEBUG_PLUGIN_SUMMARISING_ADAPTER 1
@@ -52,6 +59,292 @@ namespace Vamp {
 
 namespace HostExt {
 
+/**
+ * A bounded-size record of a distribution of values, each with a
+ * count and a duration, from which to estimate median and modal
+ * values in streaming mode.  Values are held exactly until there are
+ * more than twice the capacity of distinct values, at which point the
+ * closest neighbouring values are merged until we are back within
+ * capacity.
+ */
+class ValueSketch
+{
+public:
+    ValueSketch() : m_count(0) { }
+
+    void add(double value, double count, double duration);
+
+    /// Median by count
+    double getMedian() const;
+
+    /// First value at which the accumulated duration exceeds half
+    /// of the given total duration
+    double getContinuousMedian(double totalDuration) const;
+
+    /// Value with the greatest count
+    double getMode() const;
+
+    /// Value with the greatest total duration
+    double getContinuousMode() const;
+
+private:
+    struct Entry {
+        double value;
+        double count;
+        double duration;
+        bool operator<(double v) const { return value < v; }
+    };
+    vector<Entry> m_entries; // ordered by value
+    double m_count;
+
+    static const size_t m_capacity = 256;
+
+    void compress();
+    double valueAtRank(double rank) const;
+};
+
+void
+ValueSketch::add(double value, double count, double duration)
+{
+    m_count += count;
+
+    vector<Entry>::iterator i =
+        lower_bound(m_entries.begin(), m_entries.end(), value);
+
+    if (i != m_entries.end() && i->value == value) {
+        i->count += count;
+        i->duration += duration;
+        return;
+    }
+
+    Entry e;
+    e.value = value;
+    e.count = count;
+    e.duration = duration;
+    m_entries.insert(i, e);
+
+    if (m_entries.size() > 2 * m_capacity) {
+        compress();
+    }
+}
+
+void
+ValueSketch::compress()
+{
+    while (m_entries.size() > m_capacity) {
+
+        size_t n = m_entries.size();
+        size_t excess = n - m_capacity;
+
+        // Merge neighbours separated by no more than the excess'th
+        // smallest gap, taking each entry at most once per pass
+
+        vector<double> gaps(n - 1);
+        for (size_t i = 0; i + 1 < n; ++i) {
+            gaps[i] = m_entries[i+1].value - m_entries[i].value;
+        }
+        vector<double> sorted(gaps);
+        nth_element(sorted.begin(), sorted.begin() + (excess - 1), sorted.end());
+        double threshold = sorted[excess - 1];
+
+        vector<Entry> merged;
+        merged.reserve(n);
+        size_t merges = 0;
+        size_t i = 0;
+
+        while (i < n) {
+            if (i + 1 < n && merges < excess && gaps[i] <= threshold) {
+                const Entry &a = m_entries[i];
+                const Entry &b = m_entries[i+1];
+                Entry e;
+                e.count = a.count + b.count;
+                e.duration = a.duration + b.duration;
+                if (e.count > 0) {
+                    e.value = (a.value * a.count + b.value * b.count) / e.count;
+                } else {
+                    e.value = (a.value + b.value) / 2;
+                }
+                merged.push_back(e);
+                ++merges;
+                i += 2;
+            } else {
+                merged.push_back(m_entries[i]);
+                ++i;
+            }
+        }
+
+        m_entries = merged;
+    }
+}
+
+double
+ValueSketch::valueAtRank(double rank) const
+{
+    double acc = 0.0;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        acc += m_entries[i].count;
+        if (acc > rank) return m_entries[i].value;
+    }
+    return m_entries.empty() ? 0.0 : m_entries[m_entries.size()-1].value;
+}
+
+double
+ValueSketch::getMedian() const
+{
+    double n = floor(m_count + 0.5);
+    if (n < 1.0) return 0.0;
+    double half = floor(n / 2);
+    if (fmod(n, 2.0) == 1.0) {
+        return valueAtRank(half);
+    } else {
+        return (valueAtRank(half - 1) + valueAtRank(half)) / 2;
+    }
+}
+
+double
+ValueSketch::getContinuousMedian(double totalDuration) const
+{
+    if (m_entries.empty()) return 0.0;
+    double acc = 0.0;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        acc += m_entries[i].duration;
+        if (acc > totalDuration/2) return m_entries[i].value;
+    }
+    return m_entries[m_entries.size()-1].value;
+}
+
+double
+ValueSketch::getMode() const
+{
+    double mode = 0.0, best = 0.0;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].count > best) {
+            best = m_entries[i].count;
+            mode = m_entries[i].value;
+        }
+    }
+    return mode;
+}
+
+double
+ValueSketch::getContinuousMode() const
+{
+    double mode = 0.0, best = 0.0;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].duration > best) {
+            best = m_entries[i].duration;
+            mode = m_entries[i].value;
+        }
+    }
+    return mode;
+}
+
+/**
+ * A histogram of exact float values with a weight for each, held in
+ * an open-addressing hash table, for finding modal values in a
+ * single pass.  The table is kept between uses, so that clearing it
+ * costs time in proportion to the values added rather than to its
+ * size.
+ */
+class ValueHistogram
+{
+public:
+    ValueHistogram() : m_mask(0) { }
+
+    /// Empty the histogram, ready for up to n distinct values
+    void clear(size_t n);
+
+    void add(float value, double weight);
+
+    /// Value with the greatest weight, the lowest such if there are
+    /// several, or 0 if no value has positive weight
+    float getMode() const;
+
+private:
+    struct Slot {
+        float value;
+        double weight;
+        bool used;
+        Slot() : value(0), weight(0), used(false) { }
+    };
+    vector<Slot> m_slots;
+    vector<size_t> m_used; // indices of used slots
+    size_t m_mask;
+};
+
+void
+ValueHistogram::clear(size_t n)
+{
+    for (size_t i = 0; i < m_used.size(); ++i) {
+        m_slots[m_used[i]] = Slot();
+    }
+    m_used.clear();
+
+    size_t size = 16;
+    while (size < n * 2) size *= 2;
+    if (size > m_slots.size()) {
+        m_slots = vector<Slot>(size);
+        m_mask = size - 1;
+    }
+}
+
+void
+ValueHistogram::add(float value, double weight)
+{
+    if (value == 0.f) value = 0.f; // so that -0 and 0 are the same
+
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits ^= bits >> 16;
+    bits *= 0x45d9f3bu;
+    bits ^= bits >> 16;
+
+    size_t i = bits & m_mask;
+    while (m_slots[i].used && m_slots[i].value != value) {
+        i = (i + 1) & m_mask;
+    }
+
+    if (!m_slots[i].used) {
+        m_slots[i].used = true;
+        m_slots[i].value = value;
+        m_used.push_back(i);
+    }
+    m_slots[i].weight += weight;
+}
+
+float
+ValueHistogram::getMode() const
+{
+    float mode = 0.f;
+    double best = 0.0;
+    for (size_t i = 0; i < m_used.size(); ++i) {
+        const Slot &slot = m_slots[m_used[i]];
+        if (slot.weight > best ||
+            (slot.weight == best && best > 0.0 && slot.value < mode)) {
+            best = slot.weight;
+            mode = slot.value;
+        }
+    }
+    return mode;
+}
+
+struct ValueDurationFloatPair
+{
+    float value;
+    float duration;
+
+    ValueDurationFloatPair() : value(0), duration(0) { }
+    ValueDurationFloatPair(float v, float d) : value(v), duration(d) { }
+    ValueDurationFloatPair &operator=(const ValueDurationFloatPair &p) {
+        value = p.value;
+        duration = p.duration;
+        return *this;
+    }
+    bool operator<(const ValueDurationFloatPair &p) const {
+        return value < p.value;
+    }
+};
+
 class PluginSummarisingAdapter::Impl
 {
 public:
@@ -63,10 +356,18 @@ public:
     void reset();
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
+    void processColumns(const float *const *inputBuffers, RealTime timestamp,
+                        FeatureColumnSet &features);
     FeatureSet getRemainingFeatures();
 
     void setSummarySegmentBoundaries(const SegmentBoundaries &);
 
+    void setStreamingMode(bool streaming) { m_streaming = streaming; }
+    bool getStreamingMode() const { return m_streaming; }
+
+    void setThreadCount(int threads) { m_threadCount = max(threads, 1); }
+    int getThreadCount() const { return m_threadCount; }
+
     FeatureList getSummaryForOutput(int output,
                                     SummaryType type,
                                     AveragingMethod avg);
@@ -74,13 +375,32 @@ public:
     FeatureSet getSummaryForAllOutputs(SummaryType type,
                                        AveragingMethod avg);
 
+    FeatureList getCompletedSummaryForOutput(int output,
+                                             SummaryType type,
+                                             AveragingMethod avg);
+
+    FeatureSet getCompletedSummaryForAllOutputs(SummaryType type,
+                                                AveragingMethod avg);
+
+    void setSlidingWindow(RealTime length, RealTime hop, int history);
+    RealTime getSlidingWindowLength() const { return m_windowLength; }
+    RealTime getSlidingWindowHop() const { return m_windowHop; }
+    int getSlidingWindowHistory() const { return m_windowHistory; }
+
+    FeatureList getSlidingWindowSummaryForOutput(int output,
+                                                 SummaryType type);
+    FeatureSet getSlidingWindowSummaryForAllOutputs(SummaryType type);
+    void discardSlidingWindowSummaries();
+
 protected:
     Plugin *m_plugin;
     float m_inputSampleRate;
     size_t m_stepSize;
     size_t m_blockSize;
 
-    SegmentBoundaries m_boundaries;
+    // Segment n runs from boundary n-1 (or from zero, for segment 0)
+    // to boundary n (or to the end of the input, for the last segment)
+    vector<RealTime> m_boundaries; // in order
 
     typedef vector<float> ValueList;
 
@@ -101,9 +421,19 @@ protected:
     typedef map<int, OutputAccumulator> OutputAccumulatorMap;
     OutputAccumulatorMap m_accumulators; // output number -> accumulator
 
-    typedef map<RealTime, OutputAccumulator> SegmentAccumulatorMap;
-    typedef map<int, SegmentAccumulatorMap> OutputSegmentAccumulatorMap;
-    OutputSegmentAccumulatorMap m_segmentedAccumulators; // output -> segmented
+    // The results for each output are divided between the segments
+    // by reference, as chunks of results that lie within a segment
+
+    struct Chunk {
+        RealTime time;
+        RealTime duration;
+        int result; // index in the output's results
+    };
+
+    typedef vector<Chunk> ChunkList;
+    typedef vector<ChunkList> SegmentList; // segment number -> chunks
+    typedef map<int, SegmentList> OutputSegmentMap;
+    OutputSegmentMap m_segments; // output -> segmented
 
     typedef map<int, RealTime> OutputTimestampMap;
     OutputTimestampMap m_prevTimestamps; // output number -> timestamp
@@ -128,28 +458,258 @@ protected:
         double mode_c;
         double mean_c;
         double variance_c;
+
+        OutputBinSummary() :
+            count(0), minimum(0), maximum(0), sum(0),
+            median(0), mode(0), variance(0),
+            median_c(0), mode_c(0), mean_c(0), variance_c(0) { }
     };
 
-    typedef map<int, OutputBinSummary> OutputSummary;
+    typedef vector<OutputBinSummary> OutputSummary; // indexed by bin
     typedef map<RealTime, OutputSummary> SummarySegmentMap;
     typedef map<int, SummarySegmentMap> OutputSummarySegmentMap;
 
     OutputSummarySegmentMap m_summaries;
 
+    // Without streaming, the fields of OutputBinSummary are only
+    // calculated when a summary type that needs them is first
+    // requested.  These are the groups of fields calculated together
+
+    enum SummaryField {
+        ExtentsField   = 1 << 0, // minimum, maximum
+        SumField       = 1 << 1,
+        MedianField    = 1 << 2,
+        ModeField      = 1 << 3,
+        VarianceField  = 1 << 4, // requires sum
+        MedianCField   = 1 << 5,
+        ModeCField     = 1 << 6,
+        MeanCField     = 1 << 7,
+        VarianceCField = 1 << 8, // requires mean_c
+        AllFields      = (1 << 9) - 1
+    };
+
+    typedef map<int, int> OutputFieldMap;
+    OutputFieldMap m_reducedFields; // output -> fields calculated so far
+
+    // Once all of the fields have been calculated for an output, its
+    // results and segments are no longer needed and are released
+    void releaseReduced();
+
+    // In streaming mode, results are passed to these running
+    // accumulators (one per bin per segment per output) as soon as
+    // their durations are known, instead of being kept in
+    // m_accumulators and m_segments
+
+    bool m_streaming;
+
+    struct BinAccumulator {
+        bool seen;
+        double minimum;
+        double maximum;
+        double sum;
+        double shift; // first value, subtracted before squaring
+        double sum1;  // sum of (value - shift)
+        double sum2;  // sum of (value - shift)^2
+        double dsum;  // sum of duration
+        double dsum1; // sum of (value - shift) * duration
+        double dsum2; // sum of (value - shift)^2 * duration
+        ValueSketch sketch;
+        BinAccumulator() :
+            seen(false), minimum(0), maximum(0), sum(0), shift(0),
+            sum1(0), sum2(0), dsum(0), dsum1(0), dsum2(0) { }
+        void add(double value, double count, double duration);
+    };
+
+    struct StreamAccumulator {
+        int count;
+        double duration;  // total duration of results so far
+        RealTime lastEnd; // end of most recent result
+        vector<BinAccumulator> bins;
+        StreamAccumulator() : count(0), duration(0) { }
+        void add(const ValueList &values, int bins,
+                 double duration, RealTime end);
+        void extend(int bins);
+    };
+
+    typedef vector<StreamAccumulator> StreamSegmentList; // by segment
+    typedef map<int, StreamSegmentList> OutputStreamSegmentMap;
+    OutputStreamSegmentMap m_streamAccumulators; // output -> segmented
+
+    // Results usually arrive in time order, so the segment of each is
+    // found by moving on from that of the one before
+    typedef map<int, int> OutputSegmentCursorMap;
+    OutputSegmentCursorMap m_segmentCursors; // output -> segment number
+
+    // Segments that have been summarised before the end of the input,
+    // for getCompletedSummaryForOutput.  Their summaries are kept in
+    // m_summaries and their stream accumulators released
+    OutputSegmentCursorMap m_completedSegments; // output -> segment count
+
+    // Sliding windows start every m_windowHop from zero and last for
+    // m_windowLength.  The results of each output that lie within the
+    // window being filled are kept, with running state for each bin
+    // from which the window's summary is read off when a result at or
+    // after its end arrives.  Only the sample-average summaries other
+    // than the mode are available this way.  The summaries of the last
+    // m_windowHistory windows of each output are retained
+
+    RealTime m_windowLength; // zero if sliding windows are not in use
+    RealTime m_windowHop;
+    int m_windowHistory;
+
+    struct WindowBin {
+        // Candidates for the minimum and maximum, oldest first, as
+        // (result index, value): each is smaller (or larger) than
+        // all of those before it, which were superseded by it
+        deque<pair<size_t, float> > minima;
+        deque<pair<size_t, float> > maxima;
+        double shift; // near the mean, subtracted before squaring
+        double sum1;  // sum of (value - shift)
+        double sum2;  // sum of (value - shift)^2
+        multiset<float> sorted;
+        multiset<float>::iterator middle; // element number size/2
+        WindowBin() : shift(0), sum1(0), sum2(0) { }
+        WindowBin(const WindowBin &b) :
+            minima(b.minima), maxima(b.maxima),
+            shift(b.shift), sum1(b.sum1), sum2(b.sum2), sorted(b.sorted) {
+            findMiddle();
+        }
+        WindowBin &operator=(const WindowBin &b) {
+            minima = b.minima;
+            maxima = b.maxima;
+            shift = b.shift;
+            sum1 = b.sum1;
+            sum2 = b.sum2;
+            sorted = b.sorted;
+            findMiddle();
+            return *this;
+        }
+        void findMiddle() { // the copied iterator would refer to b.sorted
+            middle = sorted.begin();
+            advance(middle, sorted.size() / 2);
+        }
+        void add(size_t index, float value);
+        void remove(size_t index, float value);
+        void rebase(const deque<Result> &results, size_t bin);
+        double getMedian() const;
+    };
+
+    struct WindowBinSummary { // compact, as one is kept per window
+        float minimum;
+        float maximum;
+        float sum;
+        float mean;
+        float median;
+        float variance;
+    };
+
+    struct WindowSummary {
+        RealTime duration;
+        int count;
+        vector<WindowBinSummary> bins;
+    };
+
+    typedef map<RealTime, WindowSummary> WindowSummaryMap;
+
+    struct WindowAccumulator {
+        RealTime start;  // of the window being filled
+        size_t first;    // index of the oldest result still in it
+        size_t rebaseFirst; // first at which to rebase the bins next
+        size_t rebaseCount; // number of results at the last rebase
+        deque<Result> results;
+        vector<WindowBin> bins;
+        WindowSummaryMap summaries; // of the windows completed so far
+        WindowAccumulator() : first(0), rebaseFirst(0), rebaseCount(0) { }
+    };
+
+    typedef map<int, WindowAccumulator> OutputWindowMap;
+    OutputWindowMap m_windows; // output -> sliding windows
+
     bool m_reduced;
     RealTime m_endTime;
 
+    // The non-streaming reduce() summarises each bin of each segment
+    // of each output independently, and shares the bins out between
+    // m_threadCount threads, in runs of up to m_binsPerItem bins
+
+    int m_threadCount;
+    static const int m_binsPerItem = 16;
+
+    struct ReduceItem {
+        const ResultList *results;
+        const ChunkList *chunks;
+        double totalDuration;
+        int binStart;
+        int binEnd;
+        int fields;
+        OutputBinSummary *summaries; // indexed by bin
+    };
+
+    struct ReduceQueue {
+        vector<ReduceItem> items;
+        size_t next;
+        Mutex mutex;
+        ReduceQueue() : next(0) { }
+    };
+
+    struct ReduceScratch { // reused from one bin to the next
+        ValueList values;
+        vector<ValueDurationFloatPair> valvec;
+        ValueHistogram histogram;
+    };
+
+    class ReduceTask : public ThreadPool::Task
+    {
+    public:
+        ReduceTask(ReduceQueue *queue) : m_queue(queue) { }
+        void perform();
+    private:
+        ReduceQueue *m_queue;
+        ReduceScratch m_scratch;
+    };
+
+    static void reduceBin(const ResultList &results, const ChunkList &chunks,
+                          int bin, double totalDuration, int fields,
+                          ReduceScratch &scratch, OutputBinSummary &summary);
+    static float getContinuousMedian(vector<ValueDurationFloatPair> &valvec,
+                                     double totalDuration);
+
     void accumulate(const FeatureSet &fs, RealTime, bool final);
-    void accumulate(int output, const Feature &f, RealTime, bool final);
+    void accumulate(const FeatureColumnSet &fs, RealTime, bool final);
+    void accumulate(int output, bool hasDuration, RealTime duration,
+                    const float *values, int valueCount,
+                    RealTime, bool final);
     void accumulateFinalDurations();
-    void findSegmentBounds(RealTime t, RealTime &start, RealTime &end);
+    int findSegment(RealTime t, int &cursor) const;
+    RealTime getSegmentStart(int segment) const;
+    RealTime getSegmentEnd(int segment, RealTime endTime) const;
     void segment();
-    void reduce();
+    void segmentResult(int output, const Result &result, int index,
+                       int bins, RealTime endTime, int &cursor);
+    void createSummaries();
+    void reduce(int output, int fields);
+    void reduceStreamed();
+    void reduceStreamSegment(StreamAccumulator &accumulator,
+                             RealTime segmentStart, int bins,
+                             SummarySegmentMap &summaries);
+    void completeSegments(int output);
+    void windowResult(int output, const float *values, int valueCount,
+                      RealTime timestamp);
+    void closeWindow(WindowAccumulator &accumulator, RealTime duration);
+    void closeFinalWindows();
+    int getSummaryFields(SummaryType type, AveragingMethod avg);
+    FeatureList getSummaryFeatures(int output, SummaryType type,
+                                   AveragingMethod avg, RealTime endTime);
 
     string getSummaryLabel(SummaryType type, AveragingMethod avg);
 };
 
 static RealTime INVALID_DURATION(INT_MIN, INT_MIN);
+
+static double toSec(const RealTime &r)
+{
+    return r.sec + double(r.nsec) / 1000000000.0;
+}
     
 PluginSummarisingAdapter::PluginSummarisingAdapter(Plugin *plugin) :
     PluginWrapper(plugin)
@@ -183,18 +743,70 @@ PluginSummarisingAdapter::process(const float *const *inputBuffers, RealTime tim
     return m_impl->process(inputBuffers, timestamp);
 }
 
+void
+PluginSummarisingAdapter::processColumns(const float *const *inputBuffers,
+                                         RealTime timestamp,
+                                         FeatureColumnSet &features)
+{
+    m_impl->processColumns(inputBuffers, timestamp, features);
+}
+
+Plugin::FeatureSet
+PluginSummarisingAdapter::processBatch(const float *const *inputBuffers,
+                                       size_t frameCount,
+                                       RealTime startTimestamp,
+                                       size_t channels,
+                                       size_t stepSize,
+                                       size_t blockSize)
+{
+    // Features without timestamps are accumulated at the time of the
+    // block they came from, so we need to see them block by block
+    return Plugin::processBatch(inputBuffers, frameCount, startTimestamp,
+                                channels, stepSize, blockSize);
+}
+
 Plugin::FeatureSet
 PluginSummarisingAdapter::getRemainingFeatures()
 {
     return m_impl->getRemainingFeatures();
 }
 
+int
+PluginSummarisingAdapter::getWarmUpFrames() const
+{
+    return -1;
+}
+
 void
 PluginSummarisingAdapter::setSummarySegmentBoundaries(const SegmentBoundaries &b)
 {
     m_impl->setSummarySegmentBoundaries(b);
 }
 
+void
+PluginSummarisingAdapter::setStreamingMode(bool streaming)
+{
+    m_impl->setStreamingMode(streaming);
+}
+
+bool
+PluginSummarisingAdapter::getStreamingMode() const
+{
+    return m_impl->getStreamingMode();
+}
+
+void
+PluginSummarisingAdapter::setThreadCount(int threads)
+{
+    m_impl->setThreadCount(threads);
+}
+
+int
+PluginSummarisingAdapter::getThreadCount() const
+{
+    return m_impl->getThreadCount();
+}
+
 Plugin::FeatureList
 PluginSummarisingAdapter::getSummaryForOutput(int output,
                                               SummaryType type,
@@ -210,10 +822,72 @@ PluginSummarisingAdapter::getSummaryForAllOutputs(SummaryType type,
     return m_impl->getSummaryForAllOutputs(type, avg);
 }
 
+Plugin::FeatureList
+PluginSummarisingAdapter::getCompletedSummaryForOutput(int output,
+                                                       SummaryType type,
+                                                       AveragingMethod avg)
+{
+    return m_impl->getCompletedSummaryForOutput(output, type, avg);
+}
+
+Plugin::FeatureSet
+PluginSummarisingAdapter::getCompletedSummaryForAllOutputs(SummaryType type,
+                                                           AveragingMethod avg)
+{
+    return m_impl->getCompletedSummaryForAllOutputs(type, avg);
+}
+
+void
+PluginSummarisingAdapter::setSlidingWindow(RealTime length, RealTime hop,
+                                           int history)
+{
+    m_impl->setSlidingWindow(length, hop, history);
+}
+
+RealTime
+PluginSummarisingAdapter::getSlidingWindowLength() const
+{
+    return m_impl->getSlidingWindowLength();
+}
+
+RealTime
+PluginSummarisingAdapter::getSlidingWindowHop() const
+{
+    return m_impl->getSlidingWindowHop();
+}
+
+int
+PluginSummarisingAdapter::getSlidingWindowHistory() const
+{
+    return m_impl->getSlidingWindowHistory();
+}
+
+Plugin::FeatureList
+PluginSummarisingAdapter::getSlidingWindowSummaryForOutput(int output,
+                                                           SummaryType type)
+{
+    return m_impl->getSlidingWindowSummaryForOutput(output, type);
+}
+
+Plugin::FeatureSet
+PluginSummarisingAdapter::getSlidingWindowSummaryForAllOutputs(SummaryType type)
+{
+    return m_impl->getSlidingWindowSummaryForAllOutputs(type);
+}
+
+void
+PluginSummarisingAdapter::discardSlidingWindowSummaries()
+{
+    m_impl->discardSlidingWindowSummaries();
+}
+
 PluginSummarisingAdapter::Impl::Impl(Plugin *plugin, float inputSampleRate) :
     m_plugin(plugin),
     m_inputSampleRate(inputSampleRate),
-    m_reduced(false)
+    m_streaming(false),
+    m_windowHistory(0),
+    m_reduced(false),
+    m_threadCount(1)
 {
 }
 
@@ -233,10 +907,15 @@ void
 PluginSummarisingAdapter::Impl::reset()
 {
     m_accumulators.clear();
-    m_segmentedAccumulators.clear();
+    m_segments.clear();
+    m_streamAccumulators.clear();
+    m_segmentCursors.clear();
+    m_completedSegments.clear();
+    m_windows.clear();
     m_prevTimestamps.clear();
     m_prevDurations.clear();
     m_summaries.clear();
+    m_reducedFields.clear();
     m_reduced = false;
     m_endTime = RealTime();
     m_plugin->reset();
@@ -260,6 +939,20 @@ PluginSummarisingAdapter::Impl::process(const float *const *inputBuffers,
     return fs;
 }
 
+void
+PluginSummarisingAdapter::Impl::processColumns(const float *const *inputBuffers,
+                                               RealTime timestamp,
+                                               FeatureColumnSet &fs)
+{
+    if (m_reduced) {
+        cerr << "WARNING: Cannot call PluginSummarisingAdapter::process() or getRemainingFeatures() after one of the getSummary methods" << endl;
+    }
+    HostExt::processColumns(m_plugin, inputBuffers, timestamp, fs);
+    accumulate(fs, timestamp, false);
+    m_endTime = timestamp + 
+        RealTime::frame2RealTime(m_stepSize, int(m_inputSampleRate + 0.5));
+}
+
 Plugin::FeatureSet
 PluginSummarisingAdapter::Impl::getRemainingFeatures()
 {
@@ -268,16 +961,17 @@ PluginSummarisingAdapter::Impl::getRemainingFeatures()
     }
     FeatureSet fs = m_plugin->getRemainingFeatures();
     accumulate(fs, m_endTime, true);
+    closeFinalWindows();
     return fs;
 }
 
 void
 PluginSummarisingAdapter::Impl::setSummarySegmentBoundaries(const SegmentBoundaries &b)
 {
-    m_boundaries = b;
+    m_boundaries = vector<RealTime>(b.begin(), b.end());
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
     cerr << "PluginSummarisingAdapter::setSummarySegmentBoundaries: boundaries are:" << endl;
-    for (SegmentBoundaries::const_iterator i = m_boundaries.begin();
+    for (vector<RealTime>::const_iterator i = m_boundaries.begin();
          i != m_boundaries.end(); ++i) {
         cerr << *i << "  ";
     }
@@ -293,10 +987,21 @@ PluginSummarisingAdapter::Impl::getSummaryForOutput(int output,
     if (!m_reduced) {
         accumulateFinalDurations();
         segment();
-        reduce();
+        createSummaries();
         m_reduced = true;
     }
 
+    reduce(output, getSummaryFields(type, avg));
+
+    return getSummaryFeatures(output, type, avg, m_endTime);
+}
+
+Plugin::FeatureList
+PluginSummarisingAdapter::Impl::getSummaryFeatures(int output,
+                                                   SummaryType type,
+                                                   AveragingMethod avg,
+                                                   RealTime endTime)
+{
     bool continuous = (avg == ContinuousTimeAverage);
 
     FeatureList fl;
@@ -311,7 +1016,7 @@ PluginSummarisingAdapter::Impl::getSummaryForOutput(int output,
         f.hasDuration = true;
         SummarySegmentMap::const_iterator ii = i;
         if (++ii == m_summaries[output].end()) {
-            f.duration = m_endTime - f.timestamp;
+            f.duration = endTime - f.timestamp;
         } else {
             f.duration = ii->first - f.timestamp;
         }
@@ -321,11 +1026,11 @@ PluginSummarisingAdapter::Impl::getSummaryForOutput(int output,
         for (OutputSummary::const_iterator j = i->second.begin();
              j != i->second.end(); ++j) {
 
-            // these will be ordered by bin number, and no bin numbers
+            // these are indexed by bin number, and no bin numbers
             // will be missing except at the end (because of the way
             // the accumulators were initially filled in accumulate())
 
-            const OutputBinSummary &summary = j->second;
+            const OutputBinSummary &summary = *j;
             double result = 0.f;
 
             switch (type) {
@@ -396,10 +1101,14 @@ PluginSummarisingAdapter::Impl::getSummaryForAllOutputs(SummaryType type,
     if (!m_reduced) {
         accumulateFinalDurations();
         segment();
-        reduce();
+        createSummaries();
         m_reduced = true;
     }
 
+    // Calculate for all outputs together, so as to share the work
+    // out between threads as widely as possible
+    reduce(-1, getSummaryFields(type, avg));
+
     FeatureSet fs;
     for (OutputSummarySegmentMap::const_iterator i = m_summaries.begin();
          i != m_summaries.end(); ++i) {
@@ -408,27 +1117,124 @@ PluginSummarisingAdapter::Impl::getSummaryForAllOutputs(SummaryType type,
     return fs;
 }
 
-void
-PluginSummarisingAdapter::Impl::accumulate(const FeatureSet &fs,
-                                           RealTime timestamp, 
-                                           bool final)
+Plugin::FeatureList
+PluginSummarisingAdapter::Impl::getCompletedSummaryForOutput(int output,
+                                                             SummaryType type,
+                                                             AveragingMethod avg)
 {
-    for (FeatureSet::const_iterator i = fs.begin(); i != fs.end(); ++i) {
-        for (FeatureList::const_iterator j = i->second.begin();
-             j != i->second.end(); ++j) {
-            if (j->hasTimestamp) {
-                accumulate(i->first, *j, j->timestamp, final);
-            } else {
-                //!!! is this correct?
-                accumulate(i->first, *j, timestamp, final);
-            }
-        }
+    if (m_reduced) {
+        return getSummaryForOutput(output, type, avg);
     }
-}
 
-string
-PluginSummarisingAdapter::Impl::getSummaryLabel(SummaryType type,
-                                                AveragingMethod avg)
+    if (!m_streaming) {
+        cerr << "WARNING: PluginSummarisingAdapter::getCompletedSummaryForOutput() is only available in streaming mode" << endl;
+        return FeatureList();
+    }
+
+    completeSegments(output);
+
+    int completed = m_completedSegments[output];
+    if (completed == 0) return FeatureList();
+
+    return getSummaryFeatures(output, type, avg, m_boundaries[completed-1]);
+}
+
+Plugin::FeatureSet
+PluginSummarisingAdapter::Impl::getCompletedSummaryForAllOutputs(SummaryType type,
+                                                                 AveragingMethod avg)
+{
+    if (m_reduced) {
+        return getSummaryForAllOutputs(type, avg);
+    }
+
+    if (!m_streaming) {
+        cerr << "WARNING: PluginSummarisingAdapter::getCompletedSummaryForAllOutputs() is only available in streaming mode" << endl;
+        return FeatureSet();
+    }
+
+    FeatureSet fs;
+    for (OutputStreamSegmentMap::const_iterator i =
+             m_streamAccumulators.begin();
+         i != m_streamAccumulators.end(); ++i) {
+        FeatureList fl = getCompletedSummaryForOutput(i->first, type, avg);
+        if (!fl.empty()) fs[i->first] = fl;
+    }
+    return fs;
+}
+
+void
+PluginSummarisingAdapter::Impl::accumulate(const FeatureSet &fs,
+                                           RealTime timestamp, 
+                                           bool final)
+{
+    for (FeatureSet::const_iterator i = fs.begin(); i != fs.end(); ++i) {
+        for (FeatureList::const_iterator j = i->second.begin();
+             j != i->second.end(); ++j) {
+            const float *values = j->values.empty() ? 0 : &j->values[0];
+            if (j->hasTimestamp) {
+                accumulate(i->first, j->hasDuration, j->duration,
+                           values, int(j->values.size()),
+                           j->timestamp, final);
+            } else {
+                //!!! is this correct?
+                accumulate(i->first, j->hasDuration, j->duration,
+                           values, int(j->values.size()),
+                           timestamp, final);
+            }
+        }
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::accumulate(const FeatureColumnSet &fs,
+                                           RealTime timestamp, 
+                                           bool final)
+{
+    for (FeatureColumnSet::const_iterator i = fs.begin(); i != fs.end(); ++i) {
+        const FeatureColumns &columns = i->second;
+        for (size_t j = 0; j < columns.size(); ++j) {
+            accumulate(i->first, columns.hasDuration(j), columns.getDuration(j),
+                       columns.getValues(j), int(columns.getValueCount(j)),
+                       columns.hasTimestamp(j) ?
+                       columns.getTimestamp(j) : timestamp,
+                       final);
+        }
+    }
+}
+
+int
+PluginSummarisingAdapter::Impl::getSummaryFields(SummaryType type,
+                                                 AveragingMethod avg)
+{
+    bool continuous = (avg == ContinuousTimeAverage);
+
+    switch (type) {
+    case Minimum:
+    case Maximum:
+        return ExtentsField;
+    case Mean:
+        return continuous ? MeanCField : SumField;
+    case Median:
+        return continuous ? MedianCField : MedianField;
+    case Mode:
+        return continuous ? ModeCField : ModeField;
+    case Sum:
+        return SumField;
+    case Variance:
+    case StandardDeviation:
+        return continuous ?
+            (MeanCField | VarianceCField) : (SumField | VarianceField);
+    case Count:
+    case UnknownSummaryType:
+        break;
+    }
+
+    return 0;
+}
+
+string
+PluginSummarisingAdapter::Impl::getSummaryLabel(SummaryType type,
+                                                AveragingMethod avg)
 {
     string label;
     string avglabel;
@@ -454,7 +1260,10 @@ PluginSummarisingAdapter::Impl::getSummaryLabel(SummaryType type,
 
 void
 PluginSummarisingAdapter::Impl::accumulate(int output,
-                                           const Feature &f,
+                                           bool hasDuration,
+                                           RealTime duration,
+                                           const float *values,
+                                           int valueCount,
                                            RealTime timestamp,
                                            bool
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
@@ -532,19 +1341,32 @@ PluginSummarisingAdapter::Impl::accumulate(int output,
         cerr << "Pushing previous duration as " << prevDuration << endl;
 #endif
         
-        m_accumulators[output].results
-            [m_accumulators[output].results.size() - 1]
-            .duration = prevDuration;
+        OutputAccumulator &accumulator = m_accumulators[output];
+        Result &prev = accumulator.results[accumulator.results.size() - 1];
+        prev.duration = prevDuration;
+
+        if (m_streaming) {
+            // We now know all we need to about the previous result.
+            // Its segment may not end before the current end time,
+            // or before the result itself does
+            RealTime endTime = m_endTime;
+            if (prev.time + prev.duration > endTime) {
+                endTime = prev.time + prev.duration;
+            }
+            segmentResult(output, prev, 0, accumulator.bins, endTime,
+                          m_segmentCursors[output]);
+            accumulator.results.clear();
+        }
     }
 
-    if (f.hasDuration) m_prevDurations[output] = f.duration;
+    if (hasDuration) m_prevDurations[output] = duration;
     else m_prevDurations[output] = INVALID_DURATION;
 
     m_prevTimestamps[output] = timestamp;
 
-    if (f.hasDuration) {
+    if (hasDuration) {
         RealTime et = timestamp;
-        et = et + f.duration;
+        et = et + duration;
         if (et > m_endTime) m_endTime = et;
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
         cerr << "feature has duration, updating end time to " << m_endTime << endl;
@@ -555,15 +1377,19 @@ PluginSummarisingAdapter::Impl::accumulate(int output,
     result.time = timestamp;
     result.duration = INVALID_DURATION;
 
-    if (int(f.values.size()) > m_accumulators[output].bins) {
-        m_accumulators[output].bins = int(f.values.size());
+    if (valueCount > m_accumulators[output].bins) {
+        m_accumulators[output].bins = valueCount;
     }
 
-    for (int i = 0; i < int(f.values.size()); ++i) {
-        result.values.push_back(f.values[i]);
+    if (valueCount > 0) {
+        result.values.assign(values, values + valueCount);
     }
 
     m_accumulators[output].results.push_back(result);
+
+    if (m_windowLength != RealTime::zeroTime) {
+        windowResult(output, values, valueCount, timestamp);
+    }
 }
 
 void
@@ -610,32 +1436,45 @@ PluginSummarisingAdapter::Impl::accumulateFinalDurations()
     }
 }
 
-void
-PluginSummarisingAdapter::Impl::findSegmentBounds(RealTime t,
-                                                  RealTime &start,
-                                                  RealTime &end)
+int
+PluginSummarisingAdapter::Impl::findSegment(RealTime t, int &cursor) const
 {
+    // The segment containing t is the one numbered by how many
+    // boundaries are at or before t.  Starting from the last segment
+    // found, this takes constant time on average for results that
+    // arrive in time order; we fall back to a binary search for any
+    // that go backwards
+
+    int n = int(m_boundaries.size());
+    if (cursor > n) cursor = n;
+
+    if (cursor > 0 && t < m_boundaries[cursor-1]) {
+        cursor = int(upper_bound(m_boundaries.begin(), m_boundaries.end(), t)
+                     - m_boundaries.begin());
+    } else {
+        while (cursor < n && !(t < m_boundaries[cursor])) ++cursor;
+    }
+
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER_SEGMENT
-    cerr << "findSegmentBounds: t = " << t <<  endl;
+    cerr << "findSegment: " << t << " is in segment " << cursor << endl;
 #endif
 
-    SegmentBoundaries::const_iterator i = upper_bound
-        (m_boundaries.begin(), m_boundaries.end(), t);
-
-    start = RealTime::zeroTime;
-    end = m_endTime;
-
-    if (i != m_boundaries.end()) {
-        end = *i;
-    }
+    return cursor;
+}
 
-    if (i != m_boundaries.begin()) {
-        start = *--i;
-    }
+RealTime
+PluginSummarisingAdapter::Impl::getSegmentStart(int segment) const
+{
+    if (segment == 0) return RealTime::zeroTime;
+    return m_boundaries[segment-1];
+}
 
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER_SEGMENT
-    cerr << "findSegmentBounds: " << t << " is in segment " << start << " -> " << end << endl;
-#endif
+RealTime
+PluginSummarisingAdapter::Impl::getSegmentEnd(int segment,
+                                              RealTime endTime) const
+{
+    if (segment == int(m_boundaries.size())) return endTime;
+    return m_boundaries[segment];
 }
 
 void
@@ -656,334 +1495,1031 @@ PluginSummarisingAdapter::Impl::segment()
                   << source.results.size() << endl;
 #endif
 
+        m_segments[output].resize(m_boundaries.size() + 1);
+
         // This is basically nonsense if the results have no values
         // (i.e. their times and counts are the only things of
         // interest)... but perhaps it's the user's problem if they
         // ask for segmentation (or any summary at all) in that case
 
+        int cursor = 0;
+
         for (int n = 0; n < int(source.results.size()); ++n) {
-            
-            // This result spans source.results[n].time to
-            // source.results[n].time + source.results[n].duration.
-            // We need to dispose it into segments appropriately
+            segmentResult(output, source.results[n], n, source.bins,
+                          m_endTime, cursor);
+        }
+    }
+}
 
-            RealTime resultStart = source.results[n].time;
-            RealTime resultEnd = resultStart + source.results[n].duration;
+void
+PluginSummarisingAdapter::Impl::segmentResult(int output,
+                                              const Result &result,
+                                              int index,
+                                              int bins,
+                                              RealTime endTime,
+                                              int &cursor)
+{
+    // This result spans result.time to result.time + result.duration.
+    // We need to dispose it into segments appropriately
+
+    RealTime resultStart = result.time;
+    RealTime resultEnd = resultStart + result.duration;
 
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER_SEGMENT
-            cerr << "output: " << output << ", result start = " << resultStart << ", end = " << resultEnd << endl;
+    cerr << "output: " << output << ", result start = " << resultStart << ", end = " << resultEnd << endl;
 #endif
 
-            RealTime segmentStart = RealTime::zeroTime;
-            RealTime segmentEnd = resultEnd - RealTime(1, 0);
-            
-            RealTime prevSegmentStart = segmentStart - RealTime(1, 0);
+    SegmentList *segments = 0;
+    StreamSegmentList *streams = 0;
+
+    int completed = 0;
+
+    if (m_streaming) {
+        streams = &m_streamAccumulators[output];
+        if (streams->empty()) streams->resize(m_boundaries.size() + 1);
+        completed = m_completedSegments[output];
+    } else {
+        segments = &m_segments[output];
+    }
+
+    RealTime segmentEnd = resultEnd - RealTime(1, 0);
+    int prevSegment = -1;
 
-            while (segmentEnd < resultEnd) {
+    while (segmentEnd < resultEnd) {
 
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER_SEGMENT
-                cerr << "segment end " << segmentEnd << " < result end "
-                          << resultEnd << " (with result start " << resultStart << ")" <<  endl;
+        cerr << "segment end " << segmentEnd << " < result end "
+             << resultEnd << " (with result start " << resultStart << ")" <<  endl;
 #endif
 
-                findSegmentBounds(resultStart, segmentStart, segmentEnd);
+        int segment = findSegment(resultStart, cursor);
+        RealTime segmentStart = getSegmentStart(segment);
+        segmentEnd = getSegmentEnd(segment, endTime);
 
-                if (segmentStart == prevSegmentStart) {
-                    // This can happen when we reach the end of the
-                    // input, if a feature's end time overruns the
-                    // input audio end time
-                    break;
-                }
-                prevSegmentStart = segmentStart;
-                
-                RealTime chunkStart = resultStart;
-                if (chunkStart < segmentStart) chunkStart = segmentStart;
-
-                RealTime chunkEnd = resultEnd;
-                if (chunkEnd > segmentEnd) chunkEnd = segmentEnd;
+        if (segment == prevSegment) {
+            // This can happen when we reach the end of the
+            // input, if a feature's end time overruns the
+            // input audio end time
+            break;
+        }
+        prevSegment = segment;
                 
-                m_segmentedAccumulators[output][segmentStart].bins = source.bins;
+        RealTime chunkStart = resultStart;
+        if (chunkStart < segmentStart) chunkStart = segmentStart;
 
-                Result chunk;
-                chunk.time = chunkStart;
-                chunk.duration = chunkEnd - chunkStart;
-                chunk.values = source.results[n].values;
+        RealTime chunkEnd = resultEnd;
+        if (chunkEnd > segmentEnd) chunkEnd = segmentEnd;
 
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER_SEGMENT
-                cerr << "chunk for segment " << segmentStart << ": from " << chunk.time << ", duration " << chunk.duration << endl;
+        cerr << "chunk for segment " << segmentStart << ": from " << chunkStart << ", duration " << chunkEnd - chunkStart << endl;
 #endif
 
-                m_segmentedAccumulators[output][segmentStart].results
-                    .push_back(chunk);
+        if (streams) {
 
-                resultStart = chunkEnd;
+            if (segment < completed) {
+                cerr << "WARNING: PluginSummarisingAdapter: Result at "
+                     << result.time << " on output " << output
+                     << " is earlier than a segment already completed, and will be left out of its summary" << endl;
+            } else {
+                (*streams)[segment].add
+                    (result.values, bins, toSec(chunkEnd - chunkStart),
+                     chunkEnd);
             }
-        }
-    }
-}
 
-struct ValueDurationFloatPair
-{
-    float value;
-    float duration;
+        } else {
 
-    ValueDurationFloatPair() : value(0), duration(0) { }
-    ValueDurationFloatPair(float v, float d) : value(v), duration(d) { }
-    ValueDurationFloatPair &operator=(const ValueDurationFloatPair &p) {
-        value = p.value;
-        duration = p.duration;
-        return *this;
-    }
-    bool operator<(const ValueDurationFloatPair &p) const {
-        return value < p.value;
-    }
-};
+            Chunk chunk;
+            chunk.time = chunkStart;
+            chunk.duration = chunkEnd - chunkStart;
+            chunk.result = index;
 
-static double toSec(const RealTime &r)
-{
-    return r.sec + double(r.nsec) / 1000000000.0;
+            (*segments)[segment].push_back(chunk);
+        }
+
+        resultStart = chunkEnd;
+    }
 }
 
 void
-PluginSummarisingAdapter::Impl::reduce()
+PluginSummarisingAdapter::Impl::createSummaries()
 {
-    for (OutputSegmentAccumulatorMap::iterator i =
-             m_segmentedAccumulators.begin();
-         i != m_segmentedAccumulators.end(); ++i) {
+    if (m_streaming) {
+        reduceStreamed();
+        return;
+    }
+
+    // Create all of the summaries, with their counts, before any of
+    // the other fields are calculated, so that reduce() can fill them
+    // in from several threads without touching m_summaries itself
+    
+    for (OutputSegmentMap::iterator i = m_segments.begin();
+         i != m_segments.end(); ++i) {
 
         int output = i->first;
-        SegmentAccumulatorMap &segments = i->second;
+        const SegmentList &segments = i->second;
+        int bins = m_accumulators[output].bins;
 
-        for (SegmentAccumulatorMap::iterator j = segments.begin();
-             j != segments.end(); ++j) {
+        for (int j = 0; j < int(segments.size()); ++j) {
 
-            RealTime segmentStart = j->first;
-            OutputAccumulator &accumulator = j->second;
+            RealTime segmentStart = getSegmentStart(j);
 
-            int sz = int(accumulator.results.size());
+            int sz = int(segments[j].size());
 
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-            cerr << "reduce: segment starting at " << segmentStart
+            cerr << "createSummaries: segment starting at " << segmentStart
                       << " on output " << output << " has " << sz << " result(s)" << endl;
 #endif
 
+            if (sz == 0 || bins == 0) continue;
+
+            OutputSummary &summary = m_summaries[output][segmentStart];
+            summary.resize(bins);
+            for (int bin = 0; bin < bins; ++bin) {
+                summary[bin].count = sz;
+            }
+        }
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::reduce(int output, int fields)
+{
+    if (m_streaming) {
+        // everything was calculated in reduceStreamed
+        return;
+    }
+
+    ReduceQueue queue;
+    
+    for (OutputSegmentMap::iterator i = m_segments.begin();
+         i != m_segments.end(); ++i) {
+
+        if (output >= 0 && i->first != output) continue;
+
+        int wanted = fields & ~m_reducedFields[i->first];
+        if (!wanted) continue;
+        m_reducedFields[i->first] |= wanted;
+
+        const SegmentList &segments = i->second;
+        const OutputAccumulator &source = m_accumulators[i->first];
+        int bins = source.bins;
+
+        for (int j = 0; j < int(segments.size()); ++j) {
+
+            RealTime segmentStart = getSegmentStart(j);
+            const ChunkList &chunks = segments[j];
+
+            int sz = int(chunks.size());
+            if (sz == 0 || bins == 0) continue;
+
             double totalDuration = 0.0;
             //!!! is this right?
-            if (sz > 0) {
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << "last time = " << accumulator.results[sz-1].time 
-                          << ", duration = " << accumulator.results[sz-1].duration
-                          << " (step = " << m_stepSize << ", block = " << m_blockSize << ")"
-                          << endl;
+            cerr << "last time = " << chunks[sz-1].time 
+                      << ", duration = " << chunks[sz-1].duration
+                      << " (step = " << m_stepSize << ", block = " << m_blockSize << ")"
+                      << endl;
 #endif
-                totalDuration = toSec((accumulator.results[sz-1].time +
-                                       accumulator.results[sz-1].duration) -
-                                      segmentStart);
+            totalDuration = toSec((chunks[sz-1].time +
+                                   chunks[sz-1].duration) -
+                                  segmentStart);
+
+            OutputSummary &summary = m_summaries[i->first][segmentStart];
+
+            for (int bin = 0; bin < bins; bin += m_binsPerItem) {
+                ReduceItem item;
+                item.results = &source.results;
+                item.chunks = &chunks;
+                item.totalDuration = totalDuration;
+                item.binStart = bin;
+                item.binEnd = min(bin + m_binsPerItem, bins);
+                item.fields = wanted;
+                item.summaries = &summary[0];
+                queue.items.push_back(item);
             }
+        }
+    }
 
-            for (int bin = 0; bin < accumulator.bins; ++bin) {
+    // Each task takes items from the queue until it is empty, so
+    // the scratch space in each task serves a single thread
+
+    int threads = m_threadCount;
+    if (threads > int(queue.items.size())) threads = int(queue.items.size());
+
+    if (threads > 1) {
+        vector<ReduceTask> tasks(threads, ReduceTask(&queue));
+        vector<ThreadPool::Task *> taskPtrs;
+        for (int i = 0; i < threads; ++i) taskPtrs.push_back(&tasks[i]);
+        // The calling thread joins in, so we need one fewer workers
+        ThreadPool pool(threads - 1);
+        pool.run(taskPtrs);
+    } else {
+        ReduceTask task(&queue);
+        task.perform();
+    }
+
+    releaseReduced();
+}
+
+void
+PluginSummarisingAdapter::Impl::releaseReduced()
+{
+    OutputSegmentMap::iterator i = m_segments.begin();
+    while (i != m_segments.end()) {
+        int output = i->first;
+        if (m_reducedFields[output] != AllFields) {
+            ++i;
+            continue;
+        }
+        ResultList().swap(m_accumulators[output].results);
+        m_segments.erase(i++);
+    }
+}
 
-                // work on all values over time for a single bin
+void
+PluginSummarisingAdapter::Impl::ReduceTask::perform()
+{
+    while (true) {
+
+        const ReduceItem *item;
+
+        {
+            MutexLocker locker(&m_queue->mutex);
+            if (m_queue->next == m_queue->items.size()) return;
+            item = &m_queue->items[m_queue->next++];
+        }
+
+        for (int bin = item->binStart; bin < item->binEnd; ++bin) {
+            reduceBin(*item->results, *item->chunks, bin, item->totalDuration,
+                      item->fields, m_scratch, item->summaries[bin]);
+        }
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::reduceBin(const ResultList &results,
+                                          const ChunkList &chunks,
+                                          int bin,
+                                          double totalDuration,
+                                          int fields,
+                                          ReduceScratch &scratch,
+                                          OutputBinSummary &summary)
+{
+    // work on all values over time for a single bin
+
+    int sz = int(chunks.size());
 
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << "bin " << bin << ":" << endl;
+    cerr << "bin " << bin << ":" << endl;
 #endif
-                
-                OutputBinSummary summary;
 
-                summary.count = sz;
+    // Gather the values for this bin, taking results with fewer
+    // values than the output has bins to be zero in the missing bins
 
-                summary.minimum = 0.f;
-                summary.maximum = 0.f;
+    ValueList &values = scratch.values;
+    values.resize(sz);
 
-                summary.median = 0.f;
-                summary.mode = 0.f;
-                summary.sum = 0.f;
-                summary.variance = 0.f;
+    for (int k = 0; k < sz; ++k) {
+        const ValueList &v = results[chunks[k].result].values;
+        if (bin < int(v.size())) {
+            values[k] = v[bin];
+        } else {
+            values[k] = 0.f;
+        }
+    }
 
-                summary.median_c = 0.f;
-                summary.mode_c = 0.f;
-                summary.mean_c = 0.f;
-                summary.variance_c = 0.f;
+    if (fields & ExtentsField) {
+        float minimum = values[0], maximum = values[0];
+        for (int k = 1; k < sz; ++k) {
+            if (values[k] < minimum) minimum = values[k];
+            if (values[k] > maximum) maximum = values[k];
+        }
+        summary.minimum = minimum;
+        summary.maximum = maximum;
+    }
 
-                if (sz == 0) continue;
+    if (fields & SumField) {
+        summary.sum = 0.0;
+        for (int k = 0; k < sz; ++k) {
+            summary.sum += values[k];
+        }
+    }
 
-                vector<ValueDurationFloatPair> valvec;
+    if (fields & ModeField) {
+        ValueHistogram &histogram = scratch.histogram;
+        histogram.clear(sz);
+        for (int k = 0; k < sz; ++k) {
+            histogram.add(values[k], 1.0);
+        }
+        summary.mode = histogram.getMode();
+    }
 
-                for (int k = 0; k < sz; ++k) {
-                    while (int(accumulator.results[k].values.size()) <
-                           accumulator.bins) {
-                        accumulator.results[k].values.push_back(0.f);
-                    }
-                }
+    if (fields & ModeCField) {
+        ValueHistogram &histogram = scratch.histogram;
+        histogram.clear(sz);
+        for (int k = 0; k < sz; ++k) {
+            histogram.add(values[k], toSec(chunks[k].duration));
+        }
+        summary.mode_c = histogram.getMode();
+    }
 
-                for (int k = 0; k < sz; ++k) {
-                    float value = accumulator.results[k].values[bin];
-                    valvec.push_back
-                        (ValueDurationFloatPair
-                         (value,
-                          float(toSec(accumulator.results[k].duration))));
-                }
+    if (totalDuration > 0.0) {
 
-                sort(valvec.begin(), valvec.end());
+        if (fields & MeanCField) {
 
-                summary.minimum = valvec[0].value;
-                summary.maximum = valvec[sz-1].value;
+            double sum_c = 0.0;
 
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << "total duration = " << totalDuration << endl;
-#endif
+            for (int k = 0; k < sz; ++k) {
+                double value = values[k] * toSec(chunks[k].duration);
+                sum_c += value;
+            }
 
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-/*
-                cerr << "value vector for medians:" << endl;
-                for (int k = 0; k < sz; ++k) {
-                    cerr << "(" << valvec[k].value << "," << valvec[k].duration << ") ";
-                }
-                cerr << endl;
-*/
+            cerr << "mean_c = " << sum_c << " / " << totalDuration << " = "
+                 << sum_c / totalDuration << " (sz = " << sz << ")" << endl;
 #endif
+                
+            summary.mean_c = sum_c / totalDuration;
+        }
 
-                if (sz % 2 == 1) {
-                    summary.median = valvec[sz/2].value;
-                } else {
-                    summary.median = (valvec[sz/2].value + valvec[sz/2 + 1].value) / 2;
-                }
-            
-                double duracc = 0.0;
-                summary.median_c = valvec[sz-1].value;
-
-                for (int k = 0; k < sz; ++k) {
-                    duracc += valvec[k].duration;
-                    if (duracc > totalDuration/2) {
-                        summary.median_c = valvec[k].value;
-                        break;
-                    }
-                }
+        if (fields & VarianceCField) {
 
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << "median_c = " << summary.median_c << endl;
-                cerr << "median = " << summary.median << endl;
-#endif
-                
-                map<float, int> distribution;
+            summary.variance_c = 0.0;
+
+            for (int k = 0; k < sz; ++k) {
+                double value = values[k];
+                summary.variance_c +=
+                    (value - summary.mean_c) * (value - summary.mean_c)
+                    * toSec(chunks[k].duration);
+            }
+
+            summary.variance_c /= totalDuration;
+        }
+    }
+
+    if (fields & VarianceField) {
+
+        double mean = summary.sum / summary.count;
 
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << "summing (discrete): ";
+        cerr << "mean = " << summary.sum << " / " << summary.count << " = "
+             << summary.sum / summary.count << endl;
 #endif
-                for (int k = 0; k < sz; ++k) {
+
+        summary.variance = 0.0;
+
+        for (int k = 0; k < sz; ++k) {
+            float value = values[k];
+            summary.variance += (value - mean) * (value - mean);
+        }
+        summary.variance /= summary.count;
+    }
+
+    if (fields & MedianCField) {
+
+        vector<ValueDurationFloatPair> &valvec = scratch.valvec;
+        valvec.clear();
+
+        for (int k = 0; k < sz; ++k) {
+            valvec.push_back
+                (ValueDurationFloatPair
+                 (values[k], float(toSec(chunks[k].duration))));
+        }
+
+        summary.median_c = getContinuousMedian(valvec, totalDuration);
+
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                    cerr << accumulator.results[k].values[bin] << " ";
+        cerr << "median_c = " << summary.median_c << endl;
 #endif
-                    summary.sum += accumulator.results[k].values[bin];
-                    distribution[accumulator.results[k].values[bin]] += 1;
-                }
+    }
+
+    if (fields & MedianField) {
+
+        // This reorders the values, so it comes last
+
+        ValueList::iterator mid = values.begin() + sz/2;
+        nth_element(values.begin(), mid, values.end());
+
+        if (sz % 2 == 1) {
+            summary.median = *mid;
+        } else {
+            // the lower middle value is the greatest of those below
+            float lower = *max_element(values.begin(), mid);
+            summary.median = (double(lower) + double(*mid)) / 2;
+        }
+
 #ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << endl;
+        cerr << "median = " << summary.median << endl;
 #endif
+    }
+}
+
+float
+PluginSummarisingAdapter::Impl::getContinuousMedian
+(vector<ValueDurationFloatPair> &valvec, double totalDuration)
+{
+    // Find the first value, in order of value, at which the
+    // accumulated duration exceeds half of the total duration (or the
+    // greatest value if there is none).  Rather than sorting, we
+    // partition around the middle of the remaining range each time,
+    // and carry on in whichever side the value must be in
 
-                int md = 0;
+    typedef vector<ValueDurationFloatPair>::iterator Iterator;
 
-                for (map<float, int>::iterator di = distribution.begin();
-                     di != distribution.end(); ++di) {
-                    if (di->second > md) {
-                        md = di->second;
-                        summary.mode = di->first;
-                    }
-                }
+    Iterator lo = valvec.begin();
+    Iterator hi = valvec.end();
 
-                distribution.clear();
+    double half = totalDuration / 2;
+    if (half < 0.0) {
+        return min_element(valvec.begin(), valvec.end())->value;
+    }
 
-                map<float, double> distribution_c;
+    double acc = 0.0; // accumulated duration of everything before lo
 
-                for (int k = 0; k < sz; ++k) {
-                    distribution_c[accumulator.results[k].values[bin]]
-                        += toSec(accumulator.results[k].duration);
-                }
+    while (lo != hi) {
 
-                double mrd = 0.0;
+        Iterator mid = lo + (hi - lo) / 2;
+        nth_element(lo, mid, hi);
 
-                for (map<float, double>::iterator di = distribution_c.begin();
-                     di != distribution_c.end(); ++di) {
-                    if (di->second > mrd) {
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                        cerr << "element " << di->first << " spans time "
-                             << di->second << " and so is an improved mode "
-                             << "candidate over element " << summary.mode_c
-                             << " which spanned " << mrd << endl;
-#endif
-                        mrd = di->second;
-                        summary.mode_c = di->first;
-                    }
+        double below = 0.0;
+        for (Iterator i = lo; i != mid; ++i) {
+            below += i->duration;
+        }
+
+        if (acc + below > half) {
+            hi = mid;
+        } else if (acc + below + mid->duration > half) {
+            return mid->value;
+        } else {
+            acc += below + mid->duration;
+            lo = mid + 1;
+        }
+    }
+
+    return max_element(valvec.begin(), valvec.end())->value;
+}
+
+void
+PluginSummarisingAdapter::Impl::BinAccumulator::add(double value,
+                                                    double count,
+                                                    double duration)
+{
+    if (!seen) {
+        minimum = maximum = shift = value;
+        seen = true;
+    } else {
+        if (value < minimum) minimum = value;
+        if (value > maximum) maximum = value;
+    }
+
+    double x = value - shift;
+
+    sum += value * count;
+    sum1 += x * count;
+    sum2 += x * x * count;
+
+    dsum += duration;
+    dsum1 += x * duration;
+    dsum2 += x * x * duration;
+
+    sketch.add(value, count, duration);
+}
+
+void
+PluginSummarisingAdapter::Impl::StreamAccumulator::extend(int n)
+{
+    // A bin that turns up late is taken to have been zero in all of
+    // the results so far, as in the non-streaming reduce()
+    while (int(bins.size()) < n) {
+        BinAccumulator bin;
+        if (count > 0) {
+            bin.add(0.0, count, duration);
+        }
+        bins.push_back(bin);
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::StreamAccumulator::add(const ValueList &values,
+                                                       int n,
+                                                       double d,
+                                                       RealTime end)
+{
+    extend(n);
+
+    for (int bin = 0; bin < n; ++bin) {
+        double value = 0.0;
+        if (bin < int(values.size())) value = values[bin];
+        bins[bin].add(value, 1.0, d);
+    }
+
+    ++count;
+    duration += d;
+    lastEnd = end;
+}
+
+void
+PluginSummarisingAdapter::Impl::reduceStreamed()
+{
+    for (OutputStreamSegmentMap::iterator i = m_streamAccumulators.begin();
+         i != m_streamAccumulators.end(); ++i) {
+
+        int output = i->first;
+        int bins = m_accumulators[output].bins;
+        StreamSegmentList &segments = i->second;
+        int completed = m_completedSegments[output];
+
+        for (int j = 0; j < int(segments.size()); ++j) {
+
+            RealTime segmentStart = getSegmentStart(j);
+
+            if (j < completed) {
+
+                // Summarised already, but the output may have gained
+                // bins since, which were zero throughout the segment
+
+                SummarySegmentMap::iterator si =
+                    m_summaries[output].find(segmentStart);
+
+                if (si != m_summaries[output].end() &&
+                    int(si->second.size()) < bins) {
+                    OutputBinSummary zero;
+                    zero.count = si->second[0].count;
+                    si->second.resize(bins, zero);
                 }
 
-                distribution_c.clear();
+                continue;
+            }
 
-                if (totalDuration > 0.0) {
+            reduceStreamSegment(segments[j], segmentStart, bins,
+                                m_summaries[output]);
+        }
+    }
 
-                    double sum_c = 0.0;
+    m_streamAccumulators.clear();
+    m_accumulators.clear();
+}
 
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                    cerr << "summing (continuous): ";
-#endif
-                    for (int k = 0; k < sz; ++k) {
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                        cerr << accumulator.results[k].values[bin] << "*"
-                             << toSec(accumulator.results[k].duration) << " ";
-#endif
-                        double value = accumulator.results[k].values[bin]
-                            * toSec(accumulator.results[k].duration);
-                        sum_c += value;
-                    }
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << endl;
-#endif
+void
+PluginSummarisingAdapter::Impl::reduceStreamSegment(StreamAccumulator &accumulator,
+                                                    RealTime segmentStart,
+                                                    int bins,
+                                                    SummarySegmentMap &segmentSummaries)
+{
+    int sz = accumulator.count;
+    if (sz == 0 || bins == 0) return;
 
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                    cerr << "mean_c = " << sum_c << " / " << totalDuration << " = "
-                              << sum_c / totalDuration << " (sz = " << sz << ")" << endl;
-#endif
+    accumulator.extend(bins);
+
+    double totalDuration = toSec(accumulator.lastEnd - segmentStart);
+
+    OutputSummary &summaries = segmentSummaries[segmentStart];
+    summaries.resize(bins);
+
+    for (int bin = 0; bin < bins; ++bin) {
+
+        const BinAccumulator &acc = accumulator.bins[bin];
                 
-                    summary.mean_c = sum_c / totalDuration;
-
-                    for (int k = 0; k < sz; ++k) {
-                        double value = accumulator.results[k].values[bin];
-//                            * toSec(accumulator.results[k].duration);
-                        summary.variance_c +=
-                            (value - summary.mean_c) * (value - summary.mean_c)
-                            * toSec(accumulator.results[k].duration);
-                    }
-
-//                    summary.variance_c /= summary.count;
-                    summary.variance_c /= totalDuration;
-                }
+        OutputBinSummary summary;
 
-                double mean = summary.sum / summary.count;
+        summary.count = sz;
 
-#ifdef DEBUG_PLUGIN_SUMMARISING_ADAPTER
-                cerr << "mean = " << summary.sum << " / " << summary.count << " = "
-                          << summary.sum / summary.count << endl;
-#endif
+        summary.minimum = acc.minimum;
+        summary.maximum = acc.maximum;
+        summary.sum = acc.sum;
+
+        summary.median = acc.sketch.getMedian();
+        summary.mode = acc.sketch.getMode();
+                
+        double m = acc.sum1 / sz;
+        summary.variance = acc.sum2 / sz - m * m;
+        if (summary.variance < 0.0) summary.variance = 0.0;
+
+        summary.median_c = acc.sketch.getContinuousMedian(totalDuration);
+        summary.mode_c = acc.sketch.getContinuousMode();
+        summary.mean_c = 0.0;
+        summary.variance_c = 0.0;
+                
+        if (totalDuration > 0.0) {
+            summary.mean_c =
+                (acc.dsum1 + acc.shift * acc.dsum) / totalDuration;
+            double mc = summary.mean_c - acc.shift;
+            summary.variance_c =
+                (acc.dsum2 - 2 * mc * acc.dsum1 + mc * mc * acc.dsum)
+                / totalDuration;
+            if (summary.variance_c < 0.0) summary.variance_c = 0.0;
+        }
+
+        summaries[bin] = summary;
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::completeSegments(int output)
+{
+    // A segment is complete once the output's pending result (the
+    // latest, whose duration is not yet known) starts at or after
+    // the end of it, because every earlier result has already been
+    // passed to the segments it spans.  Only segments not yet
+    // completed are summarised here, so each call takes time in
+    // proportion to the results that arrived since the last one
+
+    OutputStreamSegmentMap::iterator i = m_streamAccumulators.find(output);
+    if (i == m_streamAccumulators.end()) return;
+
+    const OutputAccumulator &source = m_accumulators[output];
+    if (source.results.empty()) return;
+
+    RealTime pending = source.results[source.results.size()-1].time;
+
+    StreamSegmentList &segments = i->second;
+    int &completed = m_completedSegments[output];
+
+    while (completed < int(m_boundaries.size()) &&
+           !(pending < m_boundaries[completed])) {
+        reduceStreamSegment(segments[completed], getSegmentStart(completed),
+                            source.bins, m_summaries[output]);
+        segments[completed] = StreamAccumulator(); // release its memory
+        ++completed;
+    }
+}
+
+
+void
+PluginSummarisingAdapter::Impl::setSlidingWindow(RealTime length,
+                                                 RealTime hop,
+                                                 int history)
+{
+    if (length > RealTime::zeroTime && !(hop > RealTime::zeroTime)) {
+        cerr << "WARNING: PluginSummarisingAdapter::setSlidingWindow: Hop must be greater than zero, not using sliding windows" << endl;
+        length = RealTime::zeroTime;
+    }
+    if (!(length > RealTime::zeroTime)) {
+        m_windowLength = RealTime::zeroTime;
+        m_windowHop = RealTime::zeroTime;
+        m_windowHistory = 0;
+        return;
+    }
+    if (history < 1) {
+        cerr << "WARNING: PluginSummarisingAdapter::setSlidingWindow: History must be at least one window, retaining one" << endl;
+        history = 1;
+    }
+    m_windowLength = length;
+    m_windowHop = hop;
+    m_windowHistory = history;
+}
+
+Plugin::FeatureList
+PluginSummarisingAdapter::Impl::getSlidingWindowSummaryForOutput(int output,
+                                                                 SummaryType type)
+{
+    if (m_windowLength == RealTime::zeroTime) {
+        cerr << "WARNING: PluginSummarisingAdapter::getSlidingWindowSummaryForOutput: No sliding window has been set" << endl;
+        return FeatureList();
+    }
+
+    if (type == Mode || type == UnknownSummaryType) {
+        cerr << "WARNING: PluginSummarisingAdapter::getSlidingWindowSummaryForOutput: Summary type " << type << " is not available for sliding windows" << endl;
+        return FeatureList();
+    }
+
+    FeatureList fl;
 
-                for (int k = 0; k < sz; ++k) {
-                    float value = accumulator.results[k].values[bin];
-                    summary.variance += (value - mean) * (value - mean);
+    OutputWindowMap::const_iterator wi = m_windows.find(output);
+    if (wi == m_windows.end()) return fl;
+
+    // Windows completed before a late bin first appeared lack it,
+    // but it was zero throughout them
+    int bins = int(wi->second.bins.size());
+
+    for (WindowSummaryMap::const_iterator i = wi->second.summaries.begin();
+         i != wi->second.summaries.end(); ++i) {
+
+        const WindowSummary &summary = i->second;
+
+        Feature f;
+
+        f.hasTimestamp = true;
+        f.timestamp = i->first;
+
+        f.hasDuration = true;
+        f.duration = summary.duration;
+
+        f.label = getSummaryLabel(type, SampleAverage);
+
+        for (int bin = 0; bin < bins; ++bin) {
+
+            float result = 0.f;
+
+            if (type == Count) {
+                result = float(summary.count);
+            } else if (bin < int(summary.bins.size())) {
+                const WindowBinSummary &b = summary.bins[bin];
+                switch (type) {
+                case Minimum: result = b.minimum; break;
+                case Maximum: result = b.maximum; break;
+                case Mean: result = b.mean; break;
+                case Median: result = b.median; break;
+                case Sum: result = b.sum; break;
+                case Variance: result = b.variance; break;
+                case StandardDeviation: result = sqrtf(b.variance); break;
+                default: break;
                 }
-                summary.variance /= summary.count;
+            }
+
+            f.values.push_back(result);
+        }
 
-                m_summaries[output][segmentStart][bin] = summary;
+        fl.push_back(f);
+    }
+
+    return fl;
+}
+
+Plugin::FeatureSet
+PluginSummarisingAdapter::Impl::getSlidingWindowSummaryForAllOutputs(SummaryType type)
+{
+    FeatureSet fs;
+
+    if (m_windowLength == RealTime::zeroTime) {
+        cerr << "WARNING: PluginSummarisingAdapter::getSlidingWindowSummaryForAllOutputs: No sliding window has been set" << endl;
+        return fs;
+    }
+
+    for (OutputWindowMap::const_iterator i = m_windows.begin();
+         i != m_windows.end(); ++i) {
+        FeatureList fl = getSlidingWindowSummaryForOutput(i->first, type);
+        if (!fl.empty()) fs[i->first] = fl;
+    }
+    return fs;
+}
+
+void
+PluginSummarisingAdapter::Impl::discardSlidingWindowSummaries()
+{
+    for (OutputWindowMap::iterator i = m_windows.begin();
+         i != m_windows.end(); ++i) {
+        i->second.summaries.clear();
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::windowResult(int output,
+                                             const float *values,
+                                             int valueCount,
+                                             RealTime timestamp)
+{
+    WindowAccumulator &acc = m_windows[output];
+
+    // Close each window that ends at or before this result.  Results
+    // are expected in time order, so none of them can gain any more
+
+    while (!(timestamp < acc.start + m_windowLength)) {
+        if (acc.results.empty()) {
+            // nothing to summarise: step on without recording it
+            acc.start = acc.start + m_windowHop;
+        } else {
+            closeWindow(acc, m_windowLength);
+        }
+    }
+
+    if (timestamp < acc.start) {
+        // falls between the end of one window and the start of the
+        // next, when the hop is longer than the window
+        return;
+    }
+
+    size_t index = acc.first + acc.results.size();
+
+    // A bin that turns up late is taken to have been zero in all of
+    // the results so far, as elsewhere
+
+    int bins = int(acc.bins.size());
+    if (valueCount > bins) {
+        acc.bins.resize(valueCount);
+        for (int bin = bins; bin < valueCount; ++bin) {
+            for (size_t i = 0; i < acc.results.size(); ++i) {
+                acc.bins[bin].add(acc.first + i, 0.f);
             }
         }
+        bins = valueCount;
     }
 
-    m_segmentedAccumulators.clear();
-    m_accumulators.clear();
+    for (int bin = 0; bin < bins; ++bin) {
+        acc.bins[bin].add(index, bin < valueCount ? values[bin] : 0.f);
+    }
+
+    Result result;
+    result.time = timestamp;
+    result.duration = INVALID_DURATION;
+    if (valueCount > 0) {
+        result.values.assign(values, values + valueCount);
+    }
+    acc.results.push_back(result);
 }
 
+void
+PluginSummarisingAdapter::Impl::closeWindow(WindowAccumulator &acc,
+                                            RealTime duration)
+{
+    int count = int(acc.results.size());
 
+    if (count > 0) {
+
+        // The running sums lose precision as values come and go, by
+        // an amount that depends on the values that have gone.  So
+        // recalculate them once the results they were last calculated
+        // from have all been replaced, or half of them have gone,
+        // which adds only a constant amount of work per result
+
+        if (acc.first >= acc.rebaseFirst || count * 2 < int(acc.rebaseCount)) {
+            for (size_t bin = 0; bin < acc.bins.size(); ++bin) {
+                acc.bins[bin].rebase(acc.results, bin);
+            }
+            acc.rebaseFirst = acc.first + count;
+            acc.rebaseCount = count;
+        }
+
+        WindowSummary &summary = acc.summaries[acc.start];
+        summary.duration = duration;
+        summary.count = count;
+        summary.bins.resize(acc.bins.size());
+
+        for (size_t bin = 0; bin < acc.bins.size(); ++bin) {
+
+            const WindowBin &b = acc.bins[bin];
+            WindowBinSummary &bs = summary.bins[bin];
+
+            double m = b.sum1 / count;
+            double variance = b.sum2 / count - m * m;
+            if (variance < 0.0) variance = 0.0;
+
+            bs.minimum = b.minima.front().second;
+            bs.maximum = b.maxima.front().second;
+            bs.sum = float(b.shift * count + b.sum1);
+            bs.mean = float(b.shift + m);
+            bs.median = float(b.getMedian());
+            bs.variance = float(variance);
+        }
+
+        if (int(acc.summaries.size()) > m_windowHistory) {
+            acc.summaries.erase(acc.summaries.begin());
+        }
+    }
+
+    // Move on to the next window, letting go of the results that
+    // start before it
+
+    acc.start = acc.start + m_windowHop;
+
+    while (!acc.results.empty() && acc.results.front().time < acc.start) {
+        const ValueList &values = acc.results.front().values;
+        for (size_t bin = 0; bin < acc.bins.size(); ++bin) {
+            acc.bins[bin].remove(acc.first,
+                                 bin < values.size() ? values[bin] : 0.f);
+        }
+        acc.results.pop_front();
+        ++acc.first;
+    }
 }
 
+void
+PluginSummarisingAdapter::Impl::closeFinalWindows()
+{
+    // Summarise every window that has results left in it, as far as
+    // the end of the input
+
+    for (OutputWindowMap::iterator i = m_windows.begin();
+         i != m_windows.end(); ++i) {
+
+        WindowAccumulator &acc = i->second;
+
+        while (!acc.results.empty()) {
+            RealTime duration = m_windowLength;
+            if (acc.start + duration > m_endTime) {
+                duration = m_endTime - acc.start;
+                if (duration < RealTime::zeroTime) {
+                    duration = RealTime::zeroTime;
+                }
+            }
+            closeWindow(acc, duration);
+        }
+    }
 }
 
-_VAMP_SDK_HOSTSPACE_END(PluginSummarisingAdapter.cpp)
+void
+PluginSummarisingAdapter::Impl::WindowBin::add(size_t index, float value)
+{
+    if (sorted.empty()) {
+        shift = value;
+        sum1 = 0.0;
+        sum2 = 0.0;
+    }
+
+    double x = double(value) - shift;
+    sum1 += x;
+    sum2 += x * x;
+
+    while (!minima.empty() && !(minima.back().second < value)) {
+        minima.pop_back();
+    }
+    minima.push_back(pair<size_t, float>(index, value));
+
+    while (!maxima.empty() && !(maxima.back().second > value)) {
+        maxima.pop_back();
+    }
+    maxima.push_back(pair<size_t, float>(index, value));
+
+    // The new value goes after any equal to it, so it lies before
+    // the middle only if it is smaller.  Then move the middle so as
+    // to remain at element size/2
+
+    size_t n = sorted.size();
+    multiset<float>::iterator i = sorted.insert(value);
+
+    if (n == 0) {
+        middle = i;
+    } else if (value < *middle) {
+        if (n % 2 == 0) --middle;
+    } else {
+        if (n % 2 == 1) ++middle;
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::WindowBin::remove(size_t index, float value)
+{
+    // Results leave in the order they arrived, so this one is the
+    // oldest, and at the front of the deques if it is still there
+
+    if (!minima.empty() && minima.front().first == index) minima.pop_front();
+    if (!maxima.empty() && maxima.front().first == index) maxima.pop_front();
+
+    size_t n = sorted.size();
+
+    if (n <= 1) {
+        sorted.clear();
+        sum1 = 0.0;
+        sum2 = 0.0;
+        return;
+    }
+
+    double x = double(value) - shift;
+    sum1 -= x;
+    sum2 -= x * x;
+
+    // Remove the middle itself if it has this value, otherwise an
+    // element equal to it on the side it lies, then move the middle
+    // so as to remain at element size/2
+
+    if (value == *middle) {
+        multiset<float>::iterator gone = middle;
+        if (n % 2 == 1) ++middle;
+        else --middle;
+        sorted.erase(gone);
+    } else if (value < *middle) {
+        sorted.erase(sorted.lower_bound(value));
+        if (n % 2 == 1) ++middle;
+    } else {
+        sorted.erase(sorted.lower_bound(value));
+        if (n % 2 == 0) --middle;
+    }
+}
+
+void
+PluginSummarisingAdapter::Impl::WindowBin::rebase(const deque<Result> &results,
+                                                  size_t bin)
+{
+    // Shift by the mean, as near as the running sums know it
 
+    if (results.empty()) return;
+
+    shift += sum1 / double(results.size());
+    sum1 = 0.0;
+    sum2 = 0.0;
+
+    for (deque<Result>::const_iterator i = results.begin();
+         i != results.end(); ++i) {
+        double value = 0.0;
+        if (bin < i->values.size()) value = i->values[bin];
+        double x = value - shift;
+        sum1 += x;
+        sum2 += x * x;
+    }
+}
+
+double
+PluginSummarisingAdapter::Impl::WindowBin::getMedian() const
+{
+    if (sorted.empty()) return 0.0;
+    if (sorted.size() % 2 == 1) return *middle;
+    multiset<float>::const_iterator lower = middle;
+    --lower;
+    return (double(*lower) + double(*middle)) / 2;
+}
+
+}
+
+}
+
+_VAMP_SDK_HOSTSPACE_END(PluginSummarisingAdapter.cpp)
@@ -184,12 +184,38 @@ PluginWrapper::process(const float *const *inputBuffers, RealTime timestamp)
     return m_plugin->process(inputBuffers, timestamp);
 }
 
+Plugin::FeatureSet
+PluginWrapper::processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp,
+                            size_t channels,
+                            size_t stepSize,
+                            size_t blockSize)
+{
+    return m_plugin->processBatch(inputBuffers, frameCount, startTimestamp,
+                                  channels, stepSize, blockSize);
+}
+
 Plugin::FeatureSet
 PluginWrapper::getRemainingFeatures()
 {
     return m_plugin->getRemainingFeatures();
 }
 
+int
+PluginWrapper::getWarmUpFrames() const
+{
+    return m_plugin->getWarmUpFrames();
+}
+
+void
+PluginWrapper::processColumns(const float *const *inputBuffers,
+                              RealTime timestamp,
+                              FeatureColumnSet &features)
+{
+    convertFeatures(process(inputBuffers, timestamp), features);
+}
+
 }
 
 }
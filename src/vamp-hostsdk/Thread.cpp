@@ -0,0 +1,313 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "Thread.h"
+
+#include <iostream>
+
+_VAMP_SDK_HOSTSPACE_BEGIN(Thread.cpp)
+
+#ifdef _WIN32
+
+Mutex::Mutex()
+{
+    InitializeCriticalSection(&m_mutex);
+}
+
+Mutex::~Mutex()
+{
+    DeleteCriticalSection(&m_mutex);
+}
+
+void
+Mutex::lock()
+{
+    EnterCriticalSection(&m_mutex);
+}
+
+void
+Mutex::unlock()
+{
+    LeaveCriticalSection(&m_mutex);
+}
+
+Condition::Condition()
+{
+    InitializeConditionVariable(&m_condition);
+}
+
+Condition::~Condition()
+{
+}
+
+void
+Condition::wait(Mutex &mutex)
+{
+    SleepConditionVariableCS(&m_condition, &mutex.m_mutex, INFINITE);
+}
+
+void
+Condition::signal()
+{
+    WakeConditionVariable(&m_condition);
+}
+
+void
+Condition::broadcast()
+{
+    WakeAllConditionVariable(&m_condition);
+}
+
+Thread::Thread() :
+    m_thread(0),
+    m_running(false)
+{
+}
+
+Thread::~Thread()
+{
+    wait();
+}
+
+DWORD WINAPI
+Thread::staticRun(LPVOID arg)
+{
+    ((Thread *)arg)->run();
+    return 0;
+}
+
+bool
+Thread::start()
+{
+    if (m_running) return true;
+    m_thread = CreateThread(0, 0, staticRun, this, 0, 0);
+    if (!m_thread) {
+        std::cerr << "WARNING: Thread::start: Failed to create thread" << std::endl;
+        return false;
+    }
+    m_running = true;
+    return true;
+}
+
+void
+Thread::wait()
+{
+    if (!m_running) return;
+    WaitForSingleObject(m_thread, INFINITE);
+    CloseHandle(m_thread);
+    m_thread = 0;
+    m_running = false;
+}
+
+#else /* ! _WIN32 */
+
+Mutex::Mutex()
+{
+    pthread_mutex_init(&m_mutex, 0);
+}
+
+Mutex::~Mutex()
+{
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void
+Mutex::lock()
+{
+    pthread_mutex_lock(&m_mutex);
+}
+
+void
+Mutex::unlock()
+{
+    pthread_mutex_unlock(&m_mutex);
+}
+
+Condition::Condition()
+{
+    pthread_cond_init(&m_condition, 0);
+}
+
+Condition::~Condition()
+{
+    pthread_cond_destroy(&m_condition);
+}
+
+void
+Condition::wait(Mutex &mutex)
+{
+    pthread_cond_wait(&m_condition, &mutex.m_mutex);
+}
+
+void
+Condition::signal()
+{
+    pthread_cond_signal(&m_condition);
+}
+
+void
+Condition::broadcast()
+{
+    pthread_cond_broadcast(&m_condition);
+}
+
+Thread::Thread() :
+    m_running(false)
+{
+}
+
+Thread::~Thread()
+{
+    wait();
+}
+
+void *
+Thread::staticRun(void *arg)
+{
+    ((Thread *)arg)->run();
+    return 0;
+}
+
+bool
+Thread::start()
+{
+    if (m_running) return true;
+    if (pthread_create(&m_thread, 0, staticRun, this) != 0) {
+        std::cerr << "WARNING: Thread::start: Failed to create thread" << std::endl;
+        return false;
+    }
+    m_running = true;
+    return true;
+}
+
+void
+Thread::wait()
+{
+    if (!m_running) return;
+    pthread_join(m_thread, 0);
+    m_running = false;
+}
+
+#endif /* ! _WIN32 */
+
+ThreadPool::ThreadPool(int threads) :
+    m_tasks(0),
+    m_next(0),
+    m_outstanding(0),
+    m_exiting(false)
+{
+    for (int i = 0; i < threads; ++i) {
+        Worker *worker = new Worker(this);
+        if (!worker->start()) {
+            delete worker;
+            break;
+        }
+        m_workers.push_back(worker);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    m_mutex.lock();
+    m_exiting = true;
+    m_available.broadcast();
+    m_mutex.unlock();
+
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i]->wait();
+        delete m_workers[i];
+    }
+}
+
+void
+ThreadPool::run(const std::vector<Task *> &tasks)
+{
+    if (tasks.empty()) return;
+
+    if (m_workers.empty()) {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            tasks[i]->perform();
+        }
+        return;
+    }
+
+    MutexLocker locker(&m_mutex);
+
+    m_tasks = &tasks;
+    m_next = 0;
+    m_outstanding = tasks.size();
+    m_available.broadcast();
+
+    while (perform()) ;
+
+    while (m_outstanding > 0) {
+        m_done.wait(m_mutex);
+    }
+
+    m_tasks = 0;
+}
+
+void
+ThreadPool::work()
+{
+    MutexLocker locker(&m_mutex);
+
+    while (!m_exiting) {
+        if (!perform()) {
+            m_available.wait(m_mutex);
+        }
+    }
+}
+
+bool
+ThreadPool::perform()
+{
+    if (!m_tasks || m_next >= m_tasks->size()) return false;
+
+    Task *task = (*m_tasks)[m_next++];
+
+    m_mutex.unlock();
+    task->perform();
+    m_mutex.lock();
+
+    if (--m_outstanding == 0) {
+        m_done.signal();
+    }
+
+    return true;
+}
+
+_VAMP_SDK_HOSTSPACE_END(Thread.cpp)
@@ -0,0 +1,203 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _VAMP_THREAD_H_
+#define _VAMP_THREAD_H_
+
+#include <vamp-hostsdk/hostguard.h>
+
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+_VAMP_SDK_HOSTSPACE_BEGIN(Thread.h)
+
+/**
+ * These are private implementation classes for the Vamp Host SDK,
+ * providing the minimum of threading support needed by the adapters
+ * and loader without requiring anything beyond C++98.
+ */
+
+class Mutex
+{
+public:
+    Mutex();
+    ~Mutex();
+
+    void lock();
+    void unlock();
+
+private:
+#ifdef _WIN32
+    CRITICAL_SECTION m_mutex;
+#else
+    pthread_mutex_t m_mutex;
+#endif
+    friend class Condition;
+
+    Mutex(const Mutex &); // not provided
+    Mutex &operator=(const Mutex &); // not provided
+};
+
+class MutexLocker
+{
+public:
+    MutexLocker(Mutex *mutex) : m_mutex(mutex) { m_mutex->lock(); }
+    ~MutexLocker() { m_mutex->unlock(); }
+
+private:
+    Mutex *m_mutex;
+
+    MutexLocker(const MutexLocker &); // not provided
+    MutexLocker &operator=(const MutexLocker &); // not provided
+};
+
+class Condition
+{
+public:
+    Condition();
+    ~Condition();
+
+    /**
+     * Wait for the condition to be signalled. The mutex must be
+     * locked by the caller; it is released while waiting and locked
+     * again before returning.
+     */
+    void wait(Mutex &mutex);
+
+    void signal();
+    void broadcast();
+
+private:
+#ifdef _WIN32
+    CONDITION_VARIABLE m_condition;
+#else
+    pthread_cond_t m_condition;
+#endif
+
+    Condition(const Condition &); // not provided
+    Condition &operator=(const Condition &); // not provided
+};
+
+class Thread
+{
+public:
+    Thread();
+    virtual ~Thread();
+
+    bool start();
+    void wait();
+
+protected:
+    virtual void run() = 0;
+
+private:
+#ifdef _WIN32
+    HANDLE m_thread;
+    static DWORD WINAPI staticRun(LPVOID);
+#else
+    pthread_t m_thread;
+    static void *staticRun(void *);
+#endif
+    bool m_running;
+
+    Thread(const Thread &); // not provided
+    Thread &operator=(const Thread &); // not provided
+};
+
+/**
+ * A fixed set of worker threads that carry out batches of tasks on
+ * behalf of a single calling thread, which joins in with the work
+ * while it waits. A pool with n threads therefore runs up to n+1
+ * tasks at once. A pool with no threads just runs the tasks in turn
+ * in the calling thread.
+ */
+class ThreadPool
+{
+public:
+    class Task
+    {
+    public:
+        virtual ~Task() { }
+        virtual void perform() = 0;
+    };
+
+    ThreadPool(int threads);
+    ~ThreadPool();
+
+    int getThreadCount() const { return int(m_workers.size()); }
+
+    /**
+     * Carry out all of the given tasks, in no particular order and
+     * possibly concurrently, returning when all have completed. Must
+     * not be called from more than one thread at a time.
+     */
+    void run(const std::vector<Task *> &tasks);
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker(ThreadPool *pool) : m_pool(pool) { }
+    protected:
+        void run() { m_pool->work(); }
+    private:
+        ThreadPool *m_pool;
+    };
+
+    void work();
+    bool perform(); // called with m_mutex held; false if nothing to do
+
+    std::vector<Worker *> m_workers;
+    Mutex m_mutex;
+    Condition m_available;
+    Condition m_done;
+    const std::vector<Task *> *m_tasks;
+    size_t m_next;
+    size_t m_outstanding;
+    bool m_exiting;
+
+    ThreadPool(const ThreadPool &); // not provided
+    ThreadPool &operator=(const ThreadPool &); // not provided
+};
+
+_VAMP_SDK_HOSTSPACE_END(Thread.h)
+
+#endif
@@ -0,0 +1,449 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "VectorOps.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VAMP_VECTOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VAMP_VECTOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+// AVX is used only where we can compile it as a separate target and
+// check for it at runtime, i.e. with GCC 4.9+ or Clang on x86
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__clang__)
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_cpu_supports)
+#define VAMP_VECTOR_AVX 1
+#endif
+#endif
+#elif defined(__GNUC__)
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define VAMP_VECTOR_AVX 1
+#endif
+#endif
+#endif
+
+#ifdef VAMP_VECTOR_AVX
+#include <immintrin.h>
+#endif
+
+_VAMP_SDK_HOSTSPACE_BEGIN(VectorOps.cpp)
+
+#ifdef VAMP_VECTOR_AVX
+
+static bool
+checkAVX()
+{
+    // May be called from a static initialiser, before the CPU
+    // feature data would otherwise have been set up
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+}
+
+static const bool haveAVX = checkAVX();
+
+__attribute__((target("avx")))
+static size_t
+multiplyAVX(const float *src, const float *mul, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 s = _mm256_loadu_ps(src + i);
+        __m256 m = _mm256_loadu_ps(mul + i);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(s, m));
+    }
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+multiplyAVX(const float *src, const double *mul, double *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d s = _mm256_cvtps_pd(_mm_loadu_ps(src + i));
+        __m256d m = _mm256_loadu_pd(mul + i);
+        _mm256_storeu_pd(dst + i, _mm256_mul_pd(s, m));
+    }
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+mixDownAVX(const float *const *src, size_t channels, float *dst, size_t n)
+{
+    const __m256 divisor = _mm256_set1_ps(float(channels));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 acc = _mm256_loadu_ps(src[0] + i);
+        for (size_t c = 1; c < channels; ++c) {
+            acc = _mm256_add_ps(acc, _mm256_loadu_ps(src[c] + i));
+        }
+        _mm256_storeu_ps(dst + i, _mm256_div_ps(acc, divisor));
+    }
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+mixAVX(const float *const *src, const float *gains, size_t channels,
+       float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 acc = _mm256_mul_ps(_mm256_loadu_ps(src[0] + i),
+                                   _mm256_set1_ps(gains[0]));
+        for (size_t c = 1; c < channels; ++c) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(src[c] + i),
+                                                   _mm256_set1_ps(gains[c])));
+        }
+        _mm256_storeu_ps(dst + i, acc);
+    }
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+deinterleaveStereoAVX(const float *src, float *l, float *r, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(src + i*2);     // frames 0-3
+        __m256 b = _mm256_loadu_ps(src + i*2 + 8); // frames 4-7
+        __m256 lo = _mm256_permute2f128_ps(a, b, 0x20); // 0, 1, 4, 5
+        __m256 hi = _mm256_permute2f128_ps(a, b, 0x31); // 2, 3, 6, 7
+        _mm256_storeu_ps(l + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0)));
+        _mm256_storeu_ps(r + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1)));
+    }
+    return i;
+}
+
+#endif
+
+void
+VectorOps::multiply(const float *src, const float *mul, float *dst, size_t n)
+{
+    size_t i = 0;
+
+#ifdef VAMP_VECTOR_AVX
+    if (haveAVX) {
+        i = multiplyAVX(src, mul, dst, n);
+    }
+#endif
+
+#if defined(VAMP_VECTOR_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        __m128 s = _mm_loadu_ps(src + i);
+        __m128 m = _mm_loadu_ps(mul + i);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(s, m));
+    }
+#elif defined(VAMP_VECTOR_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t s = vld1q_f32(src + i);
+        float32x4_t m = vld1q_f32(mul + i);
+        vst1q_f32(dst + i, vmulq_f32(s, m));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        dst[i] = src[i] * mul[i];
+    }
+}
+
+void
+VectorOps::multiply(const float *src, const double *mul, double *dst, size_t n)
+{
+    size_t i = 0;
+
+#ifdef VAMP_VECTOR_AVX
+    if (haveAVX) {
+        i = multiplyAVX(src, mul, dst, n);
+    }
+#endif
+
+#if defined(VAMP_VECTOR_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        __m128 s = _mm_loadu_ps(src + i);
+        __m128d lo = _mm_cvtps_pd(s);
+        __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(s, s));
+        _mm_storeu_pd(dst + i, _mm_mul_pd(lo, _mm_loadu_pd(mul + i)));
+        _mm_storeu_pd(dst + i + 2, _mm_mul_pd(hi, _mm_loadu_pd(mul + i + 2)));
+    }
+#elif defined(VAMP_VECTOR_NEON) && defined(__aarch64__)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t s = vld1q_f32(src + i);
+        float64x2_t lo = vcvt_f64_f32(vget_low_f32(s));
+        float64x2_t hi = vcvt_high_f64_f32(s);
+        vst1q_f64(dst + i, vmulq_f64(lo, vld1q_f64(mul + i)));
+        vst1q_f64(dst + i + 2, vmulq_f64(hi, vld1q_f64(mul + i + 2)));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        dst[i] = src[i] * mul[i];
+    }
+}
+
+void
+VectorOps::deinterleave(const float *src, size_t srcChannels,
+                        float *const *dst, size_t dstChannels,
+                        size_t n)
+{
+    if (dstChannels == 0) return;
+    
+    size_t i = 0;
+
+    if (srcChannels == 1) {
+
+        for (; i < n; ++i) {
+            dst[0][i] = src[i];
+        }
+        return;
+    }
+
+    if (srcChannels == 2 && dstChannels == 2) {
+
+        float *l = dst[0];
+        float *r = dst[1];
+
+#ifdef VAMP_VECTOR_AVX
+        if (haveAVX) {
+            i = deinterleaveStereoAVX(src, l, r, n);
+        }
+#endif
+        
+#if defined(VAMP_VECTOR_SSE2)
+        for (; i + 4 <= n; i += 4) {
+            __m128 a = _mm_loadu_ps(src + i*2);
+            __m128 b = _mm_loadu_ps(src + i*2 + 4);
+            _mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)));
+            _mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1)));
+        }
+#elif defined(VAMP_VECTOR_NEON)
+        for (; i + 4 <= n; i += 4) {
+            float32x4x2_t v = vld2q_f32(src + i*2);
+            vst1q_f32(l + i, v.val[0]);
+            vst1q_f32(r + i, v.val[1]);
+        }
+#endif
+    }
+
+#if defined(VAMP_VECTOR_SSE2) || defined(VAMP_VECTOR_NEON)
+    if (srcChannels == 4) {
+        for (; i + 4 <= n; i += 4) {
+#if defined(VAMP_VECTOR_SSE2)
+            __m128 v[4];
+            for (int f = 0; f < 4; ++f) {
+                v[f] = _mm_loadu_ps(src + (i + f) * 4);
+            }
+            _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+            for (size_t c = 0; c < dstChannels; ++c) {
+                _mm_storeu_ps(dst[c] + i, v[c]);
+            }
+#else
+            float32x4x4_t v = vld4q_f32(src + i*4);
+            for (size_t c = 0; c < dstChannels; ++c) {
+                vst1q_f32(dst[c] + i, v.val[c]);
+            }
+#endif
+        }
+    }
+#endif
+
+    // Frame by frame, so as to read the source sequentially
+    for (; i < n; ++i) {
+        const float *frame = src + i * srcChannels;
+        for (size_t c = 0; c < dstChannels; ++c) {
+            dst[c][i] = frame[c];
+        }
+    }
+}
+
+void
+VectorOps::mixDown(const float *const *src, size_t channels,
+                   float *dst, size_t n)
+{
+    if (channels == 0) return;
+
+    // Sum every channel for each vector of samples before moving on
+    // to the next, rather than making a pass over dst per channel
+    
+    size_t i = 0;
+    
+#ifdef VAMP_VECTOR_AVX
+    if (haveAVX) {
+        i = mixDownAVX(src, channels, dst, n);
+    }
+#endif
+
+#if defined(VAMP_VECTOR_SSE2)
+    const __m128 divisor = _mm_set1_ps(float(channels));
+    for (; i + 4 <= n; i += 4) {
+        __m128 acc = _mm_loadu_ps(src[0] + i);
+        for (size_t c = 1; c < channels; ++c) {
+            acc = _mm_add_ps(acc, _mm_loadu_ps(src[c] + i));
+        }
+        _mm_storeu_ps(dst + i, _mm_div_ps(acc, divisor));
+    }
+#elif defined(VAMP_VECTOR_NEON) && defined(__aarch64__)
+    const float32x4_t divisor = vdupq_n_f32(float(channels));
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t acc = vld1q_f32(src[0] + i);
+        for (size_t c = 1; c < channels; ++c) {
+            acc = vaddq_f32(acc, vld1q_f32(src[c] + i));
+        }
+        vst1q_f32(dst + i, vdivq_f32(acc, divisor));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        float acc = src[0][i];
+        for (size_t c = 1; c < channels; ++c) {
+            acc += src[c][i];
+        }
+        dst[i] = acc / float(channels);
+    }
+}
+
+void
+VectorOps::mix(const float *const *src, const float *gains,
+               size_t channels, float *dst, size_t n)
+{
+    if (channels == 0) return;
+
+    size_t i = 0;
+    
+#ifdef VAMP_VECTOR_AVX
+    if (haveAVX) {
+        i = mixAVX(src, gains, channels, dst, n);
+    }
+#endif
+
+#if defined(VAMP_VECTOR_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        __m128 acc = _mm_mul_ps(_mm_loadu_ps(src[0] + i),
+                                _mm_set1_ps(gains[0]));
+        for (size_t c = 1; c < channels; ++c) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src[c] + i),
+                                             _mm_set1_ps(gains[c])));
+        }
+        _mm_storeu_ps(dst + i, acc);
+    }
+#elif defined(VAMP_VECTOR_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t acc = vmulq_n_f32(vld1q_f32(src[0] + i), gains[0]);
+        for (size_t c = 1; c < channels; ++c) {
+            // multiply and add separately, as vmlaq may be fused
+            acc = vaddq_f32(acc, vmulq_n_f32(vld1q_f32(src[c] + i), gains[c]));
+        }
+        vst1q_f32(dst + i, acc);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        float acc = src[0][i] * gains[0];
+        for (size_t c = 1; c < channels; ++c) {
+            acc += src[c][i] * gains[c];
+        }
+        dst[i] = acc;
+    }
+}
+
+void
+VectorOps::mixDownInterleaved(const float *src, size_t channels,
+                              float *dst, size_t n)
+{
+    if (channels == 0) return;
+    
+    size_t i = 0;
+
+#if defined(VAMP_VECTOR_SSE2)
+    const __m128 divisor = _mm_set1_ps(float(channels));
+    if (channels == 2) {
+        for (; i + 4 <= n; i += 4) {
+            __m128 a = _mm_loadu_ps(src + i*2);
+            __m128 b = _mm_loadu_ps(src + i*2 + 4);
+            __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+            __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+            _mm_storeu_ps(dst + i, _mm_div_ps(_mm_add_ps(l, r), divisor));
+        }
+    } else if (channels == 4) {
+        for (; i + 4 <= n; i += 4) {
+            __m128 v0 = _mm_loadu_ps(src + i*4);
+            __m128 v1 = _mm_loadu_ps(src + i*4 + 4);
+            __m128 v2 = _mm_loadu_ps(src + i*4 + 8);
+            __m128 v3 = _mm_loadu_ps(src + i*4 + 12);
+            _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+            __m128 acc = _mm_add_ps(_mm_add_ps(_mm_add_ps(v0, v1), v2), v3);
+            _mm_storeu_ps(dst + i, _mm_div_ps(acc, divisor));
+        }
+    }
+#elif defined(VAMP_VECTOR_NEON) && defined(__aarch64__)
+    const float32x4_t divisor = vdupq_n_f32(float(channels));
+    if (channels == 2) {
+        for (; i + 4 <= n; i += 4) {
+            float32x4x2_t v = vld2q_f32(src + i*2);
+            vst1q_f32(dst + i, vdivq_f32(vaddq_f32(v.val[0], v.val[1]),
+                                         divisor));
+        }
+    } else if (channels == 4) {
+        for (; i + 4 <= n; i += 4) {
+            float32x4x4_t v = vld4q_f32(src + i*4);
+            float32x4_t acc = vaddq_f32(vaddq_f32(vaddq_f32(v.val[0], v.val[1]),
+                                                  v.val[2]), v.val[3]);
+            vst1q_f32(dst + i, vdivq_f32(acc, divisor));
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        const float *frame = src + i * channels;
+        float acc = frame[0];
+        for (size_t c = 1; c < channels; ++c) {
+            acc += frame[c];
+        }
+        dst[i] = acc / float(channels);
+    }
+}
+
+_VAMP_SDK_HOSTSPACE_END(VectorOps.cpp)
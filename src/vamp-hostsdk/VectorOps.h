@@ -0,0 +1,107 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _VAMP_VECTOR_OPS_H_
+#define _VAMP_VECTOR_OPS_H_
+
+#include <vamp-hostsdk/hostguard.h>
+
+#include <cstddef>
+
+_VAMP_SDK_HOSTSPACE_BEGIN(VectorOps.h)
+
+/**
+ * This is a private implementation class for the Vamp Host SDK,
+ * providing the few vector loops that are hot enough to be worth
+ * hand-vectorising.  The float and double overloads use SSE2 or NEON
+ * where the compiler targets them, and AVX where the CPU turns out to
+ * support it at runtime.  All of them give exactly the same results
+ * as the plain loops.
+ */
+class VectorOps
+{
+public:
+    /**
+     * Multiply n values from src by the corresponding values from
+     * mul, writing the products to dst.  dst may be the same as src
+     * (where the types allow it) but must not otherwise overlap.
+     */
+    template <typename S, typename T>
+    static void multiply(const S *src, const T *mul, T *dst, size_t n) {
+        for (size_t i = 0; i < n; ++i) dst[i] = src[i] * mul[i];
+    }
+
+    static void multiply(const float *src, const float *mul,
+                         float *dst, size_t n);
+    static void multiply(const float *src, const double *mul,
+                         double *dst, size_t n);
+
+    /**
+     * De-interleave n frames of srcChannels-channel interleaved audio
+     * from src into the separate buffers dst[0] to
+     * dst[dstChannels-1].  Only the first dstChannels channels are
+     * extracted; dstChannels must not exceed srcChannels.
+     */
+    static void deinterleave(const float *src, size_t srcChannels,
+                             float *const *dst, size_t dstChannels,
+                             size_t n);
+
+    /**
+     * Write to dst the mean of n values from each of the given
+     * channels, summing the channels in order and then dividing by
+     * the channel count.
+     */
+    static void mixDown(const float *const *src, size_t channels,
+                        float *dst, size_t n);
+
+    /**
+     * Write to dst the sum of n values from each of the given
+     * channels multiplied by the corresponding gain, summing the
+     * channels in order.
+     */
+    static void mix(const float *const *src, const float *gains,
+                    size_t channels, float *dst, size_t n);
+
+    /**
+     * As mixDown, but reading n frames of interleaved audio.
+     */
+    static void mixDownInterleaved(const float *src, size_t channels,
+                                   float *dst, size_t n);
+};
+
+_VAMP_SDK_HOSTSPACE_END(VectorOps.h)
+
+#endif
@@ -39,6 +39,8 @@
 
 #include <vamp-hostsdk/hostguard.h>
 
+#include "VectorOps.h"
+
 #include <cmath>
 #include <cstdlib>
 
@@ -74,13 +76,27 @@ public:
     
     void cut(T *src) const { cut(src, src); }
     void cut(T *src, T *dst) const {
-	for (size_t i = 0; i < m_size; ++i) dst[i] = src[i] * m_cache[i];
+        VectorOps::multiply(src, m_cache, dst, m_size);
     }
     template <typename T0, typename T1>
     void cut(T0 *src, T1 *dst) const {
 	for (size_t i = 0; i < m_size; ++i) dst[i] = src[i] * m_cache[i];
     }
 
+    /**
+     * Window src into dst, rotating the result by half the window
+     * size so that the centre of the frame comes first, as wanted for
+     * a zero-phase FFT.  This is the same as cut() followed by
+     * swapping the two halves of dst, but done in a single pass.  The
+     * size must be even and src and dst must not overlap.
+     */
+    template <typename T0>
+    void cutAndShift(const T0 *src, T *dst) const {
+        size_t h = m_size/2;
+        VectorOps::multiply(src + h, m_cache + h, dst, h);
+        VectorOps::multiply(src, m_cache, dst + h, h);
+    }
+
     T getArea() { return m_area; }
     T getValue(size_t i) { return m_cache[i]; }
 
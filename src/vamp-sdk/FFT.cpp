@@ -41,7 +41,16 @@
 #include <math.h>
 #include <string.h>
 
-#if ( VAMP_SDK_MAJOR_VERSION != 2 || VAMP_SDK_MINOR_VERSION != 8 )
+#include <map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if ( VAMP_SDK_MAJOR_VERSION != 2 || VAMP_SDK_MINOR_VERSION != 9 )
 #error Unexpected version of Vamp SDK header included
 #endif
 
@@ -59,7 +68,7 @@ FFT::forward(unsigned int un,
 	     double *ro, double *io)
 {
     int n(un);
-    vamp_kiss_fft_cfg c = vamp_kiss_fft_alloc(n, false, 0, 0);
+    vamp_kiss_fft_cfg c = vamp_kiss_fft_acquire(n, false);
     vamp_kiss_fft_cpx *in = new vamp_kiss_fft_cpx[n];
     vamp_kiss_fft_cpx *out = new vamp_kiss_fft_cpx[n];
     for (int i = 0; i < n; ++i) {
@@ -76,7 +85,7 @@ FFT::forward(unsigned int un,
         ro[i] = out[i].r;
         io[i] = out[i].i;
     }
-    vamp_kiss_fft_free(c);
+    vamp_kiss_fft_release(c);
     delete[] in;
     delete[] out;
 }
@@ -87,7 +96,7 @@ FFT::inverse(unsigned int un,
 	     double *ro, double *io)
 {
     int n(un);
-    vamp_kiss_fft_cfg c = vamp_kiss_fft_alloc(n, true, 0, 0);
+    vamp_kiss_fft_cfg c = vamp_kiss_fft_acquire(n, true);
     vamp_kiss_fft_cpx *in = new vamp_kiss_fft_cpx[n];
     vamp_kiss_fft_cpx *out = new vamp_kiss_fft_cpx[n];
     for (int i = 0; i < n; ++i) {
@@ -105,7 +114,7 @@ FFT::inverse(unsigned int un,
         ro[i] = out[i].r * scale;
         io[i] = out[i].i * scale;
     }
-    vamp_kiss_fft_free(c);
+    vamp_kiss_fft_release(c);
     delete[] in;
     delete[] out;
 }
@@ -115,14 +124,14 @@ class FFTComplex::D
 public:
     D(int n) :
         m_n(n),
-        m_fconf(vamp_kiss_fft_alloc(n, false, 0, 0)),
-        m_iconf(vamp_kiss_fft_alloc(n, true, 0, 0)),
+        m_fconf(vamp_kiss_fft_acquire(n, false)),
+        m_iconf(vamp_kiss_fft_acquire(n, true)),
         m_ci(new vamp_kiss_fft_cpx[m_n]),
         m_co(new vamp_kiss_fft_cpx[m_n]) { }
 
     ~D() {
-        vamp_kiss_fftr_free(m_fconf);
-        vamp_kiss_fftr_free(m_iconf);
+        vamp_kiss_fft_release(m_fconf);
+        vamp_kiss_fft_release(m_iconf);
         delete[] m_ci;
         delete[] m_co;
     }
@@ -187,15 +196,15 @@ class FFTReal::D
 public:
     D(int n) :
         m_n(n),
-        m_fconf(vamp_kiss_fftr_alloc(n, false, 0, 0)),
-        m_iconf(vamp_kiss_fftr_alloc(n, true, 0, 0)),
+        m_fconf(vamp_kiss_fftr_acquire(n, false)),
+        m_iconf(vamp_kiss_fftr_acquire(n, true)),
         m_ri(new vamp_kiss_fft_scalar[m_n]),
         m_ro(new vamp_kiss_fft_scalar[m_n]),
         m_freq(new vamp_kiss_fft_cpx[n/2+1]) { }
 
     ~D() {
-        vamp_kiss_fftr_free(m_fconf);
-        vamp_kiss_fftr_free(m_iconf);
+        vamp_kiss_fftr_release(m_fconf);
+        vamp_kiss_fftr_release(m_iconf);
         delete[] m_ri;
         delete[] m_ro;
         delete[] m_freq;
@@ -20,6 +20,163 @@ typedef double vamp_kiss_fft_scalar;
 
 #undef vamp_kiss_fft_scalar // leaving only the namespaced typedef
 
+// A process-wide cache of KissFFT configurations. Building a
+// configuration means computing its twiddle factors, which is
+// measurable when many short-lived objects use FFTs of the same
+// size. But a configuration also contains scratch space, so it can't
+// be shared between concurrent callers: instead each acquire() hands
+// out a configuration for exclusive use, taking an idle one from the
+// cache if there is one, and release() returns it to the cache.
+//
+// Configurations are reference-counted by size and direction. While
+// any configuration of a given size and direction is in use, all
+// released ones are kept; once the last one is released, only a few
+// are retained.
+//
+// Any file including this one must already have included <map>,
+// <vector>, and <windows.h> or <pthread.h> as appropriate.
+
+#ifdef _WIN32
+static SRWLOCK vamp_kiss_plan_mutex = SRWLOCK_INIT;
+#else
+static pthread_mutex_t vamp_kiss_plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+class vamp_kiss_plan_lock
+{
+public:
+#ifdef _WIN32
+    vamp_kiss_plan_lock() { AcquireSRWLockExclusive(&vamp_kiss_plan_mutex); }
+    ~vamp_kiss_plan_lock() { ReleaseSRWLockExclusive(&vamp_kiss_plan_mutex); }
+#else
+    vamp_kiss_plan_lock() { pthread_mutex_lock(&vamp_kiss_plan_mutex); }
+    ~vamp_kiss_plan_lock() { pthread_mutex_unlock(&vamp_kiss_plan_mutex); }
+#endif
+};
+
+template <typename Cfg>
+class vamp_kiss_plan_cache
+{
+public:
+    typedef Cfg (*Allocator)(int nfft, int inverse, void *mem, size_t *lenmem);
+
+    vamp_kiss_plan_cache(Allocator allocator) : m_allocator(allocator) { }
+
+    // Must be called with vamp_kiss_plan_mutex held
+    Cfg take(int nfft, bool inverse) {
+        Key key(nfft, inverse);
+        Entry &e = m_entries[key];
+        ++e.users;
+        if (e.idle.empty()) return 0;
+        Cfg cfg = e.idle.back();
+        e.idle.pop_back();
+        m_keys[cfg] = key;
+        return cfg;
+    }
+
+    // Must be called with vamp_kiss_plan_mutex held
+    void add(Cfg cfg, int nfft, bool inverse) {
+        m_keys[cfg] = Key(nfft, inverse);
+    }
+
+    // Must be called with vamp_kiss_plan_mutex held. Returns false
+    // if the caller should free the configuration itself
+    bool give(Cfg cfg) {
+        typename KeyMap::iterator i = m_keys.find(cfg);
+        if (i == m_keys.end()) return false;
+        Entry &e = m_entries[i->second];
+        m_keys.erase(i);
+        if (--e.users == 0 && e.idle.size() >= m_retain) return false;
+        e.idle.push_back(cfg);
+        return true;
+    }
+
+    Cfg allocate(int nfft, bool inverse) {
+        return m_allocator(nfft, inverse, 0, 0);
+    }
+
+private:
+    typedef std::pair<int, bool> Key;
+    struct Entry {
+        Entry() : users(0) { }
+        int users;
+        std::vector<Cfg> idle;
+    };
+    typedef std::map<Key, Entry> EntryMap;
+    typedef std::map<Cfg, Key> KeyMap;
+
+    Allocator m_allocator;
+    EntryMap m_entries;
+    KeyMap m_keys;
+
+    static const size_t m_retain = 4;
+};
+
+// The caches are allocated on first use and never deleted, so that
+// static objects using FFTs may safely be destroyed at any point
+
+static vamp_kiss_plan_cache<vamp_kiss_fft_cfg> *vamp_kiss_fft_plans = 0;
+static vamp_kiss_plan_cache<vamp_kiss_fftr_cfg> *vamp_kiss_fftr_plans = 0;
+
+template <typename Cfg>
+static Cfg
+vamp_kiss_plan_acquire(vamp_kiss_plan_cache<Cfg> *&cache,
+                       typename vamp_kiss_plan_cache<Cfg>::Allocator allocator,
+                       int nfft, bool inverse)
+{
+    vamp_kiss_plan_cache<Cfg> *c = 0;
+    {
+        vamp_kiss_plan_lock lock;
+        if (!cache) cache = new vamp_kiss_plan_cache<Cfg>(allocator);
+        c = cache;
+        Cfg cfg = c->take(nfft, inverse);
+        if (cfg) return cfg;
+    }
+    // Build the new configuration without holding the lock
+    Cfg cfg = c->allocate(nfft, inverse);
+    vamp_kiss_plan_lock lock;
+    c->add(cfg, nfft, inverse);
+    return cfg;
+}
+
+template <typename Cfg>
+static void
+vamp_kiss_plan_release(vamp_kiss_plan_cache<Cfg> *cache, Cfg cfg)
+{
+    if (!cfg) return;
+    {
+        vamp_kiss_plan_lock lock;
+        if (cache && cache->give(cfg)) return;
+    }
+    VAMP_KISS_FFT_FREE(cfg);
+}
+
+vamp_kiss_fft_cfg
+vamp_kiss_fft_acquire(int nfft, bool inverse)
+{
+    return vamp_kiss_plan_acquire(vamp_kiss_fft_plans, vamp_kiss_fft_alloc,
+                                  nfft, inverse);
+}
+
+void
+vamp_kiss_fft_release(vamp_kiss_fft_cfg cfg)
+{
+    vamp_kiss_plan_release(vamp_kiss_fft_plans, cfg);
+}
+
+vamp_kiss_fftr_cfg
+vamp_kiss_fftr_acquire(int nfft, bool inverse)
+{
+    return vamp_kiss_plan_acquire(vamp_kiss_fftr_plans, vamp_kiss_fftr_alloc,
+                                  nfft, inverse);
+}
+
+void
+vamp_kiss_fftr_release(vamp_kiss_fftr_cfg cfg)
+{
+    vamp_kiss_plan_release(vamp_kiss_fftr_plans, cfg);
+}
+
 }
 
 // Check that this worked, i.e. that we have our own suitably
@@ -39,7 +39,7 @@
 #include <cstring>
 #include <cstdlib>
 
-#if ( VAMP_SDK_MAJOR_VERSION != 2 || VAMP_SDK_MINOR_VERSION != 8 )
+#if ( VAMP_SDK_MAJOR_VERSION != 2 || VAMP_SDK_MINOR_VERSION != 9 )
 #error Unexpected version of Vamp SDK header included
 #endif
 
@@ -58,6 +58,12 @@ public:
 
     const VampPluginDescriptor *getDescriptor();
 
+    static const VampPluginBatchExtension *getBatchExtension
+    (const VampPluginDescriptor *desc);
+
+    static const VampPluginWarmUpExtension *getWarmUpExtension
+    (const VampPluginDescriptor *desc);
+
 protected:
     PluginAdapterBase *m_base;
 
@@ -98,39 +104,85 @@ protected:
 
     static void vampReleaseFeatureSet(VampFeatureList *fs);
 
-    void checkOutputMap(Plugin *plugin);
-    void markOutputsChanged(Plugin *plugin);
-
-    void cleanup(Plugin *plugin);
-    unsigned int getOutputCount(Plugin *plugin);
-    VampOutputDescriptor *getOutputDescriptor(Plugin *plugin,
+    static VampFeatureList *vampProcessBatch(VampPluginHandle handle,
+                                             const float *const *inputBuffers,
+                                             unsigned int frameCount,
+                                             int sec,
+                                             int nsec);
+
+    static int vampGetWarmUpFrames(VampPluginHandle handle);
+
+    // values passed to initialise, needed to process a batch
+    struct ProcessSizes {
+        size_t channels;
+        size_t stepSize;
+        size_t blockSize;
+    };
+
+    // Storage belonging to one feature in the feature lists returned
+    // to the host: the allocated sizes of its value array and label
+    // buffer (the label buffer is kept even while the feature itself
+    // has no label)
+    struct FeatureSlot {
+        size_t valueCapacity;
+        char *label;
+        size_t labelCapacity;
+    };
+
+    // Everything we keep for a single plugin instance. The handle
+    // given to the host is a pointer to one of these. The feature
+    // lists are reused from one process call to the next and only
+    // grow when the plugin returns more features, values or label
+    // text than it has done before
+    struct Instance {
+        Impl *adapter;
+        Plugin *plugin;
+        Plugin::OutputList *outputs;
+        bool initialised;
+        ProcessSizes sizes;
+        VampFeatureList *fs;
+        std::vector<std::vector<FeatureSlot> > slots; // per output, per feature
+    };
+
+    void checkOutputMap(Instance *instance);
+    void markOutputsChanged(Instance *instance);
+
+    void cleanup(Instance *instance);
+    unsigned int getOutputCount(Instance *instance);
+    VampOutputDescriptor *getOutputDescriptor(Instance *instance,
                                              unsigned int i);
-    VampFeatureList *process(Plugin *plugin,
+    VampFeatureList *process(Instance *instance,
                              const float *const *inputBuffers,
                              int sec, int nsec);
-    VampFeatureList *getRemainingFeatures(Plugin *plugin);
-    VampFeatureList *convertFeatures(Plugin *plugin,
+    VampFeatureList *getRemainingFeatures(Instance *instance);
+    VampFeatureList *processBatch(Instance *instance,
+                                  const float *const *inputBuffers,
+                                  unsigned int frameCount,
+                                  int sec, int nsec);
+    VampFeatureList *convertFeatures(Instance *instance,
                                      const Plugin::FeatureSet &features);
     
-    // maps both plugins and descriptors to adapters
-    typedef std::map<const void *, Impl *> AdapterMap;
-    static AdapterMap *m_adapterMap;
+    // The descriptor we give out, with a way back to its adapter
+    struct Descriptor : public VampPluginDescriptor {
+        Impl *adapter;
+    };
+
+    static Impl *lookupAdapter(const VampPluginDescriptor *);
     static Impl *lookupAdapter(VampPluginHandle);
 
+    static VampPluginBatchExtension m_batchExtension;
+    static VampPluginWarmUpExtension m_warmUpExtension;
+
     bool m_populated;
-    VampPluginDescriptor m_descriptor;
+    Descriptor m_descriptor;
     Plugin::ParameterList m_parameters;
     Plugin::ProgramList m_programs;
     
-    typedef std::map<Plugin *, Plugin::OutputList *> OutputMap;
-    OutputMap m_pluginOutputs;
-
-    std::map<Plugin *, VampFeatureList *> m_fs;
-    std::map<Plugin *, std::vector<size_t> > m_fsizes;
-    std::map<Plugin *, std::vector<std::vector<size_t> > > m_fvsizes;
-    void resizeFS(Plugin *plugin, int n);
-    void resizeFL(Plugin *plugin, int n, size_t sz);
-    void resizeFV(Plugin *plugin, int n, int j, size_t sz);
+    static void resizeFS(Instance *instance, int n);
+    static void resizeFL(Instance *instance, int n, size_t sz);
+    static void resizeFV(Instance *instance, int n, int j, size_t sz);
+    static void setLabel(Instance *instance, int n, int j,
+                         const std::string &label);
 };
 
 PluginAdapterBase::PluginAdapterBase()
@@ -149,6 +201,18 @@ PluginAdapterBase::getDescriptor()
     return m_impl->getDescriptor();
 }
 
+const VampPluginBatchExtension *
+PluginAdapterBase::getBatchExtension(const VampPluginDescriptor *desc)
+{
+    return Impl::getBatchExtension(desc);
+}
+
+const VampPluginWarmUpExtension *
+PluginAdapterBase::getWarmUpExtension(const VampPluginDescriptor *desc)
+{
+    return Impl::getWarmUpExtension(desc);
+}
+
 PluginAdapterBase::Impl::Impl(PluginAdapterBase *base) :
     m_base(base),
     m_populated(false)
@@ -260,11 +324,7 @@ PluginAdapterBase::Impl::getDescriptor()
     m_descriptor.process = vampProcess;
     m_descriptor.getRemainingFeatures = vampGetRemainingFeatures;
     m_descriptor.releaseFeatureSet = vampReleaseFeatureSet;
-    
-    if (!m_adapterMap) {
-        m_adapterMap = new AdapterMap;
-    }
-    (*m_adapterMap)[&m_descriptor] = this;
+    m_descriptor.adapter = this;
 
     delete plugin;
 
@@ -306,16 +366,39 @@ PluginAdapterBase::Impl::~Impl()
         free((void *)m_descriptor.programs[i]);
     }
     free((void *)m_descriptor.programs);
+}
 
-    if (m_adapterMap) {
-        
-        m_adapterMap->erase(&m_descriptor);
+const VampPluginBatchExtension *
+PluginAdapterBase::Impl::getBatchExtension(const VampPluginDescriptor *desc)
+{
+    Impl *adapter = lookupAdapter(desc);
+    if (!adapter) return 0;
 
-        if (m_adapterMap->empty()) {
-            delete m_adapterMap;
-            m_adapterMap = 0;
-        }
-    }
+    // Batches are defined in terms of time-domain input only
+    if (adapter->m_descriptor.inputDomain != vampTimeDomain) return 0;
+
+    return &m_batchExtension;
+}
+
+const VampPluginWarmUpExtension *
+PluginAdapterBase::Impl::getWarmUpExtension(const VampPluginDescriptor *desc)
+{
+    if (!lookupAdapter(desc)) return 0;
+    return &m_warmUpExtension;
+}
+
+PluginAdapterBase::Impl *
+PluginAdapterBase::Impl::lookupAdapter(const VampPluginDescriptor *desc)
+{
+#ifdef DEBUG_PLUGIN_ADAPTER
+    std::cerr << "PluginAdapterBase::Impl::lookupAdapter(" << desc << ")" << std::endl;
+#endif
+
+    // A descriptor is one of ours if it has our functions in it, in
+    // which case it is the base of a Descriptor object. (The library
+    // could contain other descriptors not made by a PluginAdapter.)
+    if (!desc || desc->instantiate != vampInstantiate) return 0;
+    return static_cast<const Descriptor *>(desc)->adapter;
 }
 
 PluginAdapterBase::Impl *
@@ -325,10 +408,8 @@ PluginAdapterBase::Impl::lookupAdapter(VampPluginHandle handle)
     std::cerr << "PluginAdapterBase::Impl::lookupAdapter(" << handle << ")" << std::endl;
 #endif
 
-    if (!m_adapterMap) return 0;
-    AdapterMap::const_iterator i = m_adapterMap->find(handle);
-    if (i == m_adapterMap->end()) return 0;
-    return i->second;
+    if (!handle) return 0;
+    return ((Instance *)handle)->adapter;
 }
 
 VampPluginHandle
@@ -339,28 +420,27 @@ PluginAdapterBase::Impl::vampInstantiate(const VampPluginDescriptor *desc,
     std::cerr << "PluginAdapterBase::Impl::vampInstantiate(" << desc << ")" << std::endl;
 #endif
 
-    if (!m_adapterMap) {
-        m_adapterMap = new AdapterMap();
-    }
-
-    if (m_adapterMap->find(desc) == m_adapterMap->end()) {
-        std::cerr << "WARNING: PluginAdapterBase::Impl::vampInstantiate: Descriptor " << desc << " not in adapter map" << std::endl;
+    Impl *adapter = lookupAdapter(desc);
+    if (!adapter) {
+        std::cerr << "WARNING: PluginAdapterBase::Impl::vampInstantiate: Descriptor " << desc << " not recognised" << std::endl;
         return 0;
     }
 
-    Impl *adapter = (*m_adapterMap)[desc];
-    if (desc != &adapter->m_descriptor) return 0;
-
     Plugin *plugin = adapter->m_base->createPlugin(inputSampleRate);
-    if (plugin) {
-        (*m_adapterMap)[plugin] = adapter;
-    }
+    if (!plugin) return 0;
+
+    Instance *instance = new Instance;
+    instance->adapter = adapter;
+    instance->plugin = plugin;
+    instance->outputs = 0;
+    instance->initialised = false;
+    instance->fs = 0;
 
 #ifdef DEBUG_PLUGIN_ADAPTER
-    std::cerr << "PluginAdapterBase::Impl::vampInstantiate(" << desc << "): returning handle " << plugin << std::endl;
+    std::cerr << "PluginAdapterBase::Impl::vampInstantiate(" << desc << "): returning handle " << instance << std::endl;
 #endif
 
-    return plugin;
+    return instance;
 }
 
 void
@@ -372,10 +452,9 @@ PluginAdapterBase::Impl::vampCleanup(VampPluginHandle handle)
 
     Impl *adapter = lookupAdapter(handle);
     if (!adapter) {
-        delete ((Plugin *)handle);
         return;
     }
-    adapter->cleanup(((Plugin *)handle));
+    adapter->cleanup((Instance *)handle);
 }
 
 int
@@ -390,8 +469,15 @@ PluginAdapterBase::Impl::vampInitialise(VampPluginHandle handle,
 
     Impl *adapter = lookupAdapter(handle);
     if (!adapter) return 0;
-    bool result = ((Plugin *)handle)->initialise(channels, stepSize, blockSize);
-    adapter->markOutputsChanged((Plugin *)handle);
+    Instance *instance = (Instance *)handle;
+    bool result = instance->plugin->initialise(channels, stepSize, blockSize);
+    adapter->markOutputsChanged(instance);
+    if (result) {
+        instance->sizes.channels = channels;
+        instance->sizes.stepSize = stepSize;
+        instance->sizes.blockSize = blockSize;
+        instance->initialised = true;
+    }
     return result ? 1 : 0;
 }
 
@@ -402,7 +488,7 @@ PluginAdapterBase::Impl::vampReset(VampPluginHandle handle)
     std::cerr << "PluginAdapterBase::Impl::vampReset(" << handle << ")" << std::endl;
 #endif
 
-    ((Plugin *)handle)->reset();
+    ((Instance *)handle)->plugin->reset();
 }
 
 float
@@ -416,7 +502,7 @@ PluginAdapterBase::Impl::vampGetParameter(VampPluginHandle handle,
     Impl *adapter = lookupAdapter(handle);
     if (!adapter) return 0.0;
     Plugin::ParameterList &list = adapter->m_parameters;
-    return ((Plugin *)handle)->getParameter(list[param].identifier);
+    return ((Instance *)handle)->plugin->getParameter(list[param].identifier);
 }
 
 void
@@ -430,8 +516,8 @@ PluginAdapterBase::Impl::vampSetParameter(VampPluginHandle handle,
     Impl *adapter = lookupAdapter(handle);
     if (!adapter) return;
     Plugin::ParameterList &list = adapter->m_parameters;
-    ((Plugin *)handle)->setParameter(list[param].identifier, value);
-    adapter->markOutputsChanged((Plugin *)handle);
+    ((Instance *)handle)->plugin->setParameter(list[param].identifier, value);
+    adapter->markOutputsChanged((Instance *)handle);
 }
 
 unsigned int
@@ -444,7 +530,7 @@ PluginAdapterBase::Impl::vampGetCurrentProgram(VampPluginHandle handle)
     Impl *adapter = lookupAdapter(handle);
     if (!adapter) return 0;
     Plugin::ProgramList &list = adapter->m_programs;
-    std::string program = ((Plugin *)handle)->getCurrentProgram();
+    std::string program = ((Instance *)handle)->plugin->getCurrentProgram();
     for (unsigned int i = 0; i < list.size(); ++i) {
         if (list[i] == program) return i;
     }
@@ -463,9 +549,9 @@ PluginAdapterBase::Impl::vampSelectProgram(VampPluginHandle handle,
     if (!adapter) return;
 
     Plugin::ProgramList &list = adapter->m_programs;
-    ((Plugin *)handle)->selectProgram(list[program]);
+    ((Instance *)handle)->plugin->selectProgram(list[program]);
 
-    adapter->markOutputsChanged((Plugin *)handle);
+    adapter->markOutputsChanged((Instance *)handle);
 }
 
 unsigned int
@@ -475,7 +561,7 @@ PluginAdapterBase::Impl::vampGetPreferredStepSize(VampPluginHandle handle)
     std::cerr << "PluginAdapterBase::Impl::vampGetPreferredStepSize(" << handle << ")" << std::endl;
 #endif
 
-    return ((Plugin *)handle)->getPreferredStepSize();
+    return ((Instance *)handle)->plugin->getPreferredStepSize();
 }
 
 unsigned int
@@ -485,7 +571,7 @@ PluginAdapterBase::Impl::vampGetPreferredBlockSize(VampPluginHandle handle)
     std::cerr << "PluginAdapterBase::Impl::vampGetPreferredBlockSize(" << handle << ")" << std::endl;
 #endif
 
-    return ((Plugin *)handle)->getPreferredBlockSize();
+    return ((Instance *)handle)->plugin->getPreferredBlockSize();
 }
 
 unsigned int
@@ -495,7 +581,7 @@ PluginAdapterBase::Impl::vampGetMinChannelCount(VampPluginHandle handle)
     std::cerr << "PluginAdapterBase::Impl::vampGetMinChannelCount(" << handle << ")" << std::endl;
 #endif
 
-    return ((Plugin *)handle)->getMinChannelCount();
+    return ((Instance *)handle)->plugin->getMinChannelCount();
 }
 
 unsigned int
@@ -505,7 +591,7 @@ PluginAdapterBase::Impl::vampGetMaxChannelCount(VampPluginHandle handle)
     std::cerr << "PluginAdapterBase::Impl::vampGetMaxChannelCount(" << handle << ")" << std::endl;
 #endif
 
-    return ((Plugin *)handle)->getMaxChannelCount();
+    return ((Instance *)handle)->plugin->getMaxChannelCount();
 }
 
 unsigned int
@@ -520,7 +606,7 @@ PluginAdapterBase::Impl::vampGetOutputCount(VampPluginHandle handle)
 //    std::cerr << "vampGetOutputCount: handle " << handle << " -> adapter "<< adapter << std::endl;
 
     if (!adapter) return 0;
-    return adapter->getOutputCount((Plugin *)handle);
+    return adapter->getOutputCount((Instance *)handle);
 }
 
 VampOutputDescriptor *
@@ -536,7 +622,7 @@ PluginAdapterBase::Impl::vampGetOutputDescriptor(VampPluginHandle handle,
 //    std::cerr << "vampGetOutputDescriptor: handle " << handle << " -> adapter "<< adapter << std::endl;
 
     if (!adapter) return 0;
-    return adapter->getOutputDescriptor((Plugin *)handle, i);
+    return adapter->getOutputDescriptor((Instance *)handle, i);
 }
 
 void
@@ -573,7 +659,7 @@ PluginAdapterBase::Impl::vampProcess(VampPluginHandle handle,
 
     Impl *adapter = lookupAdapter(handle);
     if (!adapter) return 0;
-    return adapter->process((Plugin *)handle, inputBuffers, sec, nsec);
+    return adapter->process((Instance *)handle, inputBuffers, sec, nsec);
 }
 
 VampFeatureList *
@@ -585,7 +671,7 @@ PluginAdapterBase::Impl::vampGetRemainingFeatures(VampPluginHandle handle)
 
     Impl *adapter = lookupAdapter(handle);
     if (!adapter) return 0;
-    return adapter->getRemainingFeatures((Plugin *)handle);
+    return adapter->getRemainingFeatures((Instance *)handle);
 }
 
 void
@@ -596,97 +682,92 @@ PluginAdapterBase::Impl::vampReleaseFeatureSet(VampFeatureList *)
 #endif
 }
 
-void 
-PluginAdapterBase::Impl::cleanup(Plugin *plugin)
+VampFeatureList *
+PluginAdapterBase::Impl::vampProcessBatch(VampPluginHandle handle,
+                                          const float *const *inputBuffers,
+                                          unsigned int frameCount,
+                                          int sec,
+                                          int nsec)
 {
-    if (m_fs.find(plugin) != m_fs.end()) {
-        size_t outputCount = 0;
-        if (m_pluginOutputs[plugin]) {
-            outputCount = m_pluginOutputs[plugin]->size();
-        }
 #ifdef DEBUG_PLUGIN_ADAPTER
-        std::cerr << "PluginAdapterBase::Impl::cleanup: " << outputCount << " output(s)" << std::endl;
-#endif
-        VampFeatureList *list = m_fs[plugin];
-        for (unsigned int i = 0; i < outputCount; ++i) {
-            for (unsigned int j = 0; j < m_fsizes[plugin][i]; ++j) {
-                if (list[i].features[j].v1.label) {
-                    free(list[i].features[j].v1.label);
-                }
-                if (list[i].features[j].v1.values) {
-                    free(list[i].features[j].v1.values);
-                }
-            }
-            if (list[i].features) free(list[i].features);
-        }
-        if (list) free((void *)list);
-        m_fs.erase(plugin);
-        m_fsizes.erase(plugin);
-        m_fvsizes.erase(plugin);
-    }
-
-    if (m_pluginOutputs.find(plugin) != m_pluginOutputs.end()) {
-        delete m_pluginOutputs[plugin];
-        m_pluginOutputs.erase(plugin);
-    }
+    std::cerr << "PluginAdapterBase::Impl::vampProcessBatch(" << handle << ", " << frameCount << ", " << sec << ", " << nsec << ")" << std::endl;
+#endif
 
-    if (m_adapterMap) {
-        m_adapterMap->erase(plugin);
+    Impl *adapter = lookupAdapter(handle);
+    if (!adapter) return 0;
+    return adapter->processBatch((Instance *)handle, inputBuffers,
+                                 frameCount, sec, nsec);
+}
 
-        if (m_adapterMap->empty()) {
-            delete m_adapterMap;
-            m_adapterMap = 0;
-        }
-    }
+int
+PluginAdapterBase::Impl::vampGetWarmUpFrames(VampPluginHandle handle)
+{
+#ifdef DEBUG_PLUGIN_ADAPTER
+    std::cerr << "PluginAdapterBase::Impl::vampGetWarmUpFrames(" << handle << ")" << std::endl;
+#endif
 
-    delete ((Plugin *)plugin);
+    Impl *adapter = lookupAdapter(handle);
+    if (!adapter) return -1;
+    return ((Instance *)handle)->plugin->getWarmUpFrames();
 }
 
 void 
-PluginAdapterBase::Impl::checkOutputMap(Plugin *plugin)
+PluginAdapterBase::Impl::cleanup(Instance *instance)
 {
-    OutputMap::iterator i = m_pluginOutputs.find(plugin);
+#ifdef DEBUG_PLUGIN_ADAPTER
+    std::cerr << "PluginAdapterBase::Impl::cleanup: " << instance->slots.size() << " output(s)" << std::endl;
+#endif
 
-    if (i == m_pluginOutputs.end() || !i->second) {
+    VampFeatureList *list = instance->fs;
+    for (size_t i = 0; i < instance->slots.size(); ++i) {
+        for (size_t j = 0; j < instance->slots[i].size(); ++j) {
+            if (list[i].features[j].v1.values) {
+                free(list[i].features[j].v1.values);
+            }
+            if (instance->slots[i][j].label) {
+                free(instance->slots[i][j].label);
+            }
+        }
+        if (list[i].features) free(list[i].features);
+    }
+    if (list) free((void *)list);
 
-        m_pluginOutputs[plugin] = new Plugin::OutputList
-            (plugin->getOutputDescriptors());
+    delete instance->outputs;
+    delete instance->plugin;
+    delete instance;
+}
 
-//        std::cerr << "PluginAdapterBase::Impl::checkOutputMap: Have " << m_pluginOutputs[plugin]->size() << " outputs for plugin " << plugin->getIdentifier() << std::endl;
+void 
+PluginAdapterBase::Impl::checkOutputMap(Instance *instance)
+{
+    if (!instance->outputs) {
+        instance->outputs = new Plugin::OutputList
+            (instance->plugin->getOutputDescriptors());
     }
 }
 
 void
-PluginAdapterBase::Impl::markOutputsChanged(Plugin *plugin)
+PluginAdapterBase::Impl::markOutputsChanged(Instance *instance)
 {
-    OutputMap::iterator i = m_pluginOutputs.find(plugin);
-
-//    std::cerr << "PluginAdapterBase::Impl::markOutputsChanged" << std::endl;
-
-    if (i != m_pluginOutputs.end()) {
-
-        Plugin::OutputList *list = i->second;
-        m_pluginOutputs.erase(i);
-        delete list;
-    }
+    delete instance->outputs;
+    instance->outputs = 0;
 }
 
 unsigned int 
-PluginAdapterBase::Impl::getOutputCount(Plugin *plugin)
+PluginAdapterBase::Impl::getOutputCount(Instance *instance)
 {
-    checkOutputMap(plugin);
+    checkOutputMap(instance);
 
-    return m_pluginOutputs[plugin]->size();
+    return instance->outputs->size();
 }
 
 VampOutputDescriptor *
-PluginAdapterBase::Impl::getOutputDescriptor(Plugin *plugin,
+PluginAdapterBase::Impl::getOutputDescriptor(Instance *instance,
                                              unsigned int i)
 {
-    checkOutputMap(plugin);
+    checkOutputMap(instance);
 
-    Plugin::OutputDescriptor &od =
-        (*m_pluginOutputs[plugin])[i];
+    Plugin::OutputDescriptor &od = (*instance->outputs)[i];
 
     VampOutputDescriptor *desc = (VampOutputDescriptor *)
         malloc(sizeof(VampOutputDescriptor));
@@ -740,35 +821,55 @@ PluginAdapterBase::Impl::getOutputDescriptor(Plugin *plugin,
 }
     
 VampFeatureList *
-PluginAdapterBase::Impl::process(Plugin *plugin,
+PluginAdapterBase::Impl::process(Instance *instance,
                                  const float *const *inputBuffers,
                                  int sec, int nsec)
 {
 //    std::cerr << "PluginAdapterBase::Impl::process" << std::endl;
     RealTime rt(sec, nsec);
-    checkOutputMap(plugin);
-    return convertFeatures(plugin, plugin->process(inputBuffers, rt));
+    checkOutputMap(instance);
+    return convertFeatures(instance,
+                           instance->plugin->process(inputBuffers, rt));
 }
     
 VampFeatureList *
-PluginAdapterBase::Impl::getRemainingFeatures(Plugin *plugin)
+PluginAdapterBase::Impl::getRemainingFeatures(Instance *instance)
 {
 //    std::cerr << "PluginAdapterBase::Impl::getRemainingFeatures" << std::endl;
-    checkOutputMap(plugin);
-    return convertFeatures(plugin, plugin->getRemainingFeatures());
+    checkOutputMap(instance);
+    return convertFeatures(instance,
+                           instance->plugin->getRemainingFeatures());
 }
 
 VampFeatureList *
-PluginAdapterBase::Impl::convertFeatures(Plugin *plugin,
+PluginAdapterBase::Impl::processBatch(Instance *instance,
+                                      const float *const *inputBuffers,
+                                      unsigned int frameCount,
+                                      int sec, int nsec)
+{
+    if (!instance->initialised) {
+        std::cerr << "WARNING: PluginAdapterBase::Impl::processBatch: Plugin has not been initialised" << std::endl;
+        return 0;
+    }
+    const ProcessSizes &sizes = instance->sizes;
+    RealTime rt(sec, nsec);
+    checkOutputMap(instance);
+    return convertFeatures(instance, instance->plugin->processBatch
+                           (inputBuffers, frameCount, rt,
+                            sizes.channels, sizes.stepSize, sizes.blockSize));
+}
+
+VampFeatureList *
+PluginAdapterBase::Impl::convertFeatures(Instance *instance,
                                          const Plugin::FeatureSet &features)
 {
     int lastN = -1;
 
     int outputCount = 0;
-    if (m_pluginOutputs[plugin]) outputCount = m_pluginOutputs[plugin]->size();
+    if (instance->outputs) outputCount = instance->outputs->size();
     
-    resizeFS(plugin, outputCount);
-    VampFeatureList *fs = m_fs[plugin];
+    resizeFS(instance, outputCount);
+    VampFeatureList *fs = instance->fs;
 
 //    std::cerr << "PluginAdapter(v2)::convertFeatures: NOTE: sizeof(Feature) == " << sizeof(Plugin::Feature) << ", sizeof(VampFeature) == " << sizeof(VampFeature) << ", sizeof(VampFeatureList) == " << sizeof(VampFeatureList) << std::endl;
 
@@ -793,8 +894,10 @@ PluginAdapterBase::Impl::convertFeatures(Plugin *plugin,
         const Plugin::FeatureList &fl = fi->second;
 
         size_t sz = fl.size();
-        if (sz > m_fsizes[plugin][n]) resizeFL(plugin, n, sz);
+        if (sz > instance->slots[n].size()) resizeFL(instance, n, sz);
         fs[n].featureCount = sz;
+
+        std::vector<FeatureSlot> &slots = instance->slots[n];
         
         for (size_t j = 0; j < sz; ++j) {
 
@@ -813,16 +916,15 @@ PluginAdapterBase::Impl::convertFeatures(Plugin *plugin,
             v2->durationSec = fl[j].duration.sec;
             v2->durationNsec = fl[j].duration.nsec;
 
-            if (feature->label) free(feature->label);
-
             if (fl[j].label.empty()) {
                 feature->label = 0;
             } else {
-                feature->label = strdup(fl[j].label.c_str());
+                setLabel(instance, n, int(j), fl[j].label);
+                feature->label = slots[j].label;
             }
 
-            if (feature->valueCount > m_fvsizes[plugin][n][j]) {
-                resizeFV(plugin, n, j, feature->valueCount);
+            if (feature->valueCount > slots[j].valueCapacity) {
+                resizeFV(instance, n, int(j), feature->valueCount);
             }
 
             for (unsigned int k = 0; k < feature->valueCount; ++k) {
@@ -852,85 +954,128 @@ PluginAdapterBase::Impl::convertFeatures(Plugin *plugin,
 }
 
 void
-PluginAdapterBase::Impl::resizeFS(Plugin *plugin, int n)
+PluginAdapterBase::Impl::resizeFS(Instance *instance, int n)
 {
 #ifdef DEBUG_PLUGIN_ADAPTER
-    std::cerr << "PluginAdapterBase::Impl::resizeFS(" << plugin << ", " << n << ")" << std::endl;
+    std::cerr << "PluginAdapterBase::Impl::resizeFS(" << instance << ", " << n << ")" << std::endl;
 #endif
 
-    int i = m_fsizes[plugin].size();
+    int i = int(instance->slots.size());
     if (i >= n) return;
 
 #ifdef DEBUG_PLUGIN_ADAPTER
     std::cerr << "resizing from " << i << std::endl;
 #endif
 
-    m_fs[plugin] = (VampFeatureList *)realloc
-        (m_fs[plugin], n * sizeof(VampFeatureList));
+    instance->fs = (VampFeatureList *)realloc
+        (instance->fs, n * sizeof(VampFeatureList));
 
     while (i < n) {
-        m_fs[plugin][i].featureCount = 0;
-        m_fs[plugin][i].features = 0;
-        m_fsizes[plugin].push_back(0);
-        m_fvsizes[plugin].push_back(std::vector<size_t>());
+        instance->fs[i].featureCount = 0;
+        instance->fs[i].features = 0;
+        instance->slots.push_back(std::vector<FeatureSlot>());
         i++;
     }
 }
 
 void
-PluginAdapterBase::Impl::resizeFL(Plugin *plugin, int n, size_t sz)
+PluginAdapterBase::Impl::resizeFL(Instance *instance, int n, size_t sz)
 {
 #ifdef DEBUG_PLUGIN_ADAPTER
-    std::cerr << "PluginAdapterBase::Impl::resizeFL(" << plugin << ", " << n << ", "
+    std::cerr << "PluginAdapterBase::Impl::resizeFL(" << instance << ", " << n << ", "
               << sz << ")" << std::endl;
 #endif
+
+    std::vector<FeatureSlot> &slots = instance->slots[n];
     
-    size_t i = m_fsizes[plugin][n];
+    size_t i = slots.size();
     if (i >= sz) return;
 
 #ifdef DEBUG_PLUGIN_ADAPTER
     std::cerr << "resizing from " << i << std::endl;
 #endif
 
-    m_fs[plugin][n].features = (VampFeatureUnion *)realloc
-        (m_fs[plugin][n].features, 2 * sz * sizeof(VampFeatureUnion));
-
-    while (m_fsizes[plugin][n] < sz) {
-        m_fs[plugin][n].features[m_fsizes[plugin][n]].v1.hasTimestamp = 0;
-        m_fs[plugin][n].features[m_fsizes[plugin][n]].v1.valueCount = 0;
-        m_fs[plugin][n].features[m_fsizes[plugin][n]].v1.values = 0;
-        m_fs[plugin][n].features[m_fsizes[plugin][n]].v1.label = 0;
-        m_fs[plugin][n].features[m_fsizes[plugin][n] + sz].v2.hasDuration = 0;
-        m_fvsizes[plugin][n].push_back(0);
-        m_fsizes[plugin][n]++;
+    VampFeatureList &list = instance->fs[n];
+    
+    list.features = (VampFeatureUnion *)realloc
+        (list.features, 2 * sz * sizeof(VampFeatureUnion));
+
+    while (slots.size() < sz) {
+        size_t j = slots.size();
+        list.features[j].v1.hasTimestamp = 0;
+        list.features[j].v1.valueCount = 0;
+        list.features[j].v1.values = 0;
+        list.features[j].v1.label = 0;
+        list.features[j + sz].v2.hasDuration = 0;
+        FeatureSlot slot;
+        slot.valueCapacity = 0;
+        slot.label = 0;
+        slot.labelCapacity = 0;
+        slots.push_back(slot);
     }
 }
 
 void
-PluginAdapterBase::Impl::resizeFV(Plugin *plugin, int n, int j, size_t sz)
+PluginAdapterBase::Impl::resizeFV(Instance *instance, int n, int j, size_t sz)
 {
 #ifdef DEBUG_PLUGIN_ADAPTER
-    std::cerr << "PluginAdapterBase::Impl::resizeFV(" << plugin << ", " << n << ", "
+    std::cerr << "PluginAdapterBase::Impl::resizeFV(" << instance << ", " << n << ", "
               << j << ", " << sz << ")" << std::endl;
 #endif
+
+    FeatureSlot &slot = instance->slots[n][j];
     
-    size_t i = m_fvsizes[plugin][n][j];
+    size_t i = slot.valueCapacity;
     if (i >= sz) return;
 
 #ifdef DEBUG_PLUGIN_ADAPTER
     std::cerr << "resizing from " << i << std::endl;
 #endif
     
-    m_fs[plugin][n].features[j].v1.values = (float *)realloc
-        (m_fs[plugin][n].features[j].v1.values, sz * sizeof(float));
+    instance->fs[n].features[j].v1.values = (float *)realloc
+        (instance->fs[n].features[j].v1.values, sz * sizeof(float));
+
+    slot.valueCapacity = sz;
+}
+
+void
+PluginAdapterBase::Impl::setLabel(Instance *instance, int n, int j,
+                                  const std::string &label)
+{
+    FeatureSlot &slot = instance->slots[n][j];
+
+    size_t sz = label.length() + 1;
+    if (sz > slot.labelCapacity) {
+        slot.label = (char *)realloc(slot.label, sz);
+        slot.labelCapacity = sz;
+    }
 
-    m_fvsizes[plugin][n][j] = sz;
+    memcpy(slot.label, label.c_str(), sz);
 }
   
-PluginAdapterBase::Impl::AdapterMap *
-PluginAdapterBase::Impl::m_adapterMap = 0;
+VampPluginBatchExtension
+PluginAdapterBase::Impl::m_batchExtension = {
+    PluginAdapterBase::Impl::vampProcessBatch
+};
+
+VampPluginWarmUpExtension
+PluginAdapterBase::Impl::m_warmUpExtension = {
+    PluginAdapterBase::Impl::vampGetWarmUpFrames
+};
 
 }
 
 _VAMP_SDK_PLUGSPACE_END(PluginAdapter.cpp)
 
+extern "C" const VampPluginBatchExtension *
+vampGetPluginBatchExtension(const VampPluginDescriptor *descriptor)
+{
+    return Vamp::PluginAdapterBase::getBatchExtension(descriptor);
+}
+
+extern "C" const VampPluginWarmUpExtension *
+vampGetPluginWarmUpExtension(const VampPluginDescriptor *descriptor)
+{
+    return Vamp::PluginAdapterBase::getWarmUpExtension(descriptor);
+}
+
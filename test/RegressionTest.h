@@ -0,0 +1,124 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _REGRESSION_TEST_H_
+#define _REGRESSION_TEST_H_
+
+#include <vamp-hostsdk/PluginLoader.h>
+
+#include <string>
+#include <vector>
+
+/*
+ * Declarations shared between the parts of the vamp-regression
+ * program.  Each test function lives in its own file, checks one
+ * part of the host SDK against a plain reference implementation,
+ * and reports each comparison through check().
+ */
+
+typedef std::vector<Vamp::HostExt::PluginLoader::PluginKey> PluginKeys;
+typedef std::vector<std::vector<float> > Signal; // channel -> samples
+
+// The generated test signal
+static const int sampleRate = 44100;
+static const int channelCount = 2;
+static const size_t frameCount = 44100 * 6 + 123; // ends part-way into a block
+
+// Count a check, and report it if it failed
+void check(std::string test, std::string key, bool ok,
+           const std::string &message);
+
+// Append the features in one set to those in another
+void append(Vamp::Plugin::FeatureSet &to,
+            const Vamp::Plugin::FeatureSet &from);
+
+// Give the features that have no timestamp the given time
+void stamp(Vamp::Plugin::FeatureSet &features, Vamp::RealTime time);
+
+// Compare two feature sets exactly, ignoring outputs with no
+// features, and describe the first difference in message
+bool compare(const Vamp::Plugin::FeatureSet &obtained,
+             const Vamp::Plugin::FeatureSet &expected,
+             std::string &message);
+
+// As compare(), but allowing values to differ by a small relative
+// amount, for summaries accumulated in a different order, and
+// ignoring labels
+bool compareSummaries(const Vamp::Plugin::FeatureSet &obtained,
+                      const Vamp::Plugin::FeatureSet &expected,
+                      std::string &message);
+
+// Copy the block of the signal starting at the given frame into
+// buffers (one per channel, already of the block size), padding with
+// zeros beyond the end of the signal
+void getBlock(const Signal &signal, size_t start,
+              std::vector<std::vector<float> > &buffers);
+
+// Load a plugin and initialise it with the given step and block
+// size, or its preferred ones (as vamp-simple-host would choose) if
+// zero.  Return 0 on failure
+Vamp::Plugin *loadInitialised(Vamp::HostExt::PluginLoader::PluginKey key,
+                              int adapterFlags,
+                              size_t &stepSize, size_t &blockSize);
+
+// The number of blocks that vamp-simple-host processes: every
+// complete block and then blockSize / stepSize - 1 (at least one)
+// that are partly or wholly padding
+size_t getHostBlocks(size_t stepSize, size_t blockSize);
+
+// Run the plugin over the given number of blocks of the signal,
+// followed by getRemainingFeatures.  If stamped, give every feature
+// that lacks a timestamp the time of its block, or for the remaining
+// features the time following the last block
+Vamp::Plugin::FeatureSet runSequential(Vamp::Plugin *plugin,
+                                       const Signal &signal,
+                                       size_t stepSize, size_t blockSize,
+                                       size_t blocks, bool stamped);
+
+// The tests
+void testChunkedPluginRunner(const PluginKeys &keys, const Signal &signal);
+void testMultiPluginRunner(const PluginKeys &keys, const Signal &signal);
+void testFeatureColumns(const PluginKeys &keys, const Signal &signal);
+void testFeatureFile(const PluginKeys &keys, const Signal &signal);
+void testSummaryStreaming(const PluginKeys &keys, const Signal &signal);
+void testCompletedSummaries(const PluginKeys &keys, const Signal &signal);
+void testSlidingWindow(const PluginKeys &keys, const Signal &signal);
+void testInputDomainThreads(const PluginKeys &keys, const Signal &signal);
+void testVectorOps(const PluginKeys &keys, const Signal &signal);
+void testChannelAdapter(const PluginKeys &keys, const Signal &signal);
+void testPluginIndex(const PluginKeys &keys, const Signal &signal);
+
+#endif
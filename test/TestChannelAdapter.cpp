@@ -0,0 +1,326 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/PluginChannelAdapter.h>
+
+#include <sstream>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginChannelAdapter;
+
+// A time-domain plugin returning, for every block, one feature
+// holding the input it was given on all of its channels
+
+class EchoPlugin : public Plugin
+{
+public:
+    EchoPlugin(size_t minChannels, size_t maxChannels) :
+        Plugin(float(sampleRate)),
+        m_minChannels(minChannels), m_maxChannels(maxChannels),
+        m_channels(0), m_blockSize(0) { }
+
+    string getIdentifier() const { return "echo"; }
+    string getName() const { return "Echo"; }
+    string getDescription() const { return ""; }
+    string getMaker() const { return ""; }
+    string getCopyright() const { return ""; }
+    int getPluginVersion() const { return 1; }
+
+    InputDomain getInputDomain() const { return TimeDomain; }
+    size_t getMinChannelCount() const { return m_minChannels; }
+    size_t getMaxChannelCount() const { return m_maxChannels; }
+
+    bool initialise(size_t channels, size_t, size_t blockSize) {
+        if (channels < m_minChannels || channels > m_maxChannels) {
+            return false;
+        }
+        m_channels = channels;
+        m_blockSize = blockSize;
+        return true;
+    }
+    void reset() { }
+
+    OutputList getOutputDescriptors() const {
+        OutputDescriptor d;
+        d.identifier = "input";
+        d.hasFixedBinCount = true;
+        d.binCount = m_channels * m_blockSize;
+        d.sampleType = OutputDescriptor::OneSamplePerStep;
+        return OutputList(1, d);
+    }
+
+    FeatureSet process(const float *const *inputBuffers, RealTime) {
+        FeatureSet fs;
+        Feature f;
+        for (size_t c = 0; c < m_channels; ++c) {
+            f.values.insert(f.values.end(), inputBuffers[c],
+                            inputBuffers[c] + m_blockSize);
+        }
+        fs[0].push_back(f);
+        return fs;
+    }
+
+    FeatureSet getRemainingFeatures() { return FeatureSet(); }
+
+private:
+    size_t m_minChannels;
+    size_t m_maxChannels;
+    size_t m_channels;
+    size_t m_blockSize;
+};
+
+static const size_t echoBlockSize = 250; // not a multiple of any vector
+static const size_t echoBlocks = 8;
+
+// Make a signal of the given number of channels from the test signal
+
+static Signal
+makeChannels(const Signal &signal, size_t channels)
+{
+    Signal result(channels, vector<float>(echoBlockSize * echoBlocks));
+    for (size_t c = 0; c < channels; ++c) {
+        for (size_t i = 0; i < result[c].size(); ++i) {
+            result[c][i] = signal[c % channelCount][i * 3 + c * 101]
+                * float(c + 1);
+        }
+    }
+    return result;
+}
+
+// Run the signal through the adapter, separately and (with a second
+// adapter from make) interleaved, checking both against the features
+// expected for each block: the plugin channels as calculated by the
+// given function from the input
+
+typedef void (*ChannelFunction)(const vector<const float *> &in, size_t n,
+                                vector<vector<float> > &out);
+
+static void
+checkAdapter(string test, string key, PluginChannelAdapter *separate,
+             PluginChannelAdapter *interleaved, const Signal &input,
+             size_t pluginChannels, ChannelFunction calculate)
+{
+    size_t channels = input.size(), n = echoBlockSize;
+
+    bool ok = separate->initialise(channels, n, n) &&
+        interleaved->initialise(channels, n, n);
+    check(test, key, ok, "initialise failed");
+    if (!ok) return;
+
+    Plugin::FeatureSet expected, obtained, obtainedInterleaved;
+
+    vector<float> frames(channels * n);
+
+    for (size_t b = 0; b < echoBlocks; ++b) {
+
+        vector<const float *> in(channels);
+        for (size_t c = 0; c < channels; ++c) in[c] = &input[c][b * n];
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t c = 0; c < channels; ++c) {
+                frames[i * channels + c] = in[c][i];
+            }
+        }
+
+        vector<vector<float> > out(pluginChannels, vector<float>(n));
+        calculate(in, n, out);
+        Plugin::Feature f;
+        for (size_t c = 0; c < pluginChannels; ++c) {
+            f.values.insert(f.values.end(), out[c].begin(), out[c].end());
+        }
+        expected[0].push_back(f);
+
+        RealTime time = RealTime::frame2RealTime(long(b * n), sampleRate);
+        append(obtained, separate->process(&in[0], time));
+        append(obtainedInterleaved,
+               interleaved->processInterleaved(&frames[0], time));
+    }
+
+    string message;
+    check(test, key, compare(obtained, expected, message), message);
+    check(test, key + " interleaved",
+          compare(obtainedInterleaved, expected, message), message);
+}
+
+static void
+meanOfChannels(const vector<const float *> &in, size_t n,
+               vector<vector<float> > &out)
+{
+    for (size_t i = 0; i < n; ++i) {
+        float acc = in[0][i];
+        for (size_t c = 1; c < in.size(); ++c) acc += in[c][i];
+        out[0][i] = acc / float(in.size());
+    }
+}
+
+static void
+firstChannels(const vector<const float *> &in, size_t n,
+              vector<vector<float> > &out)
+{
+    for (size_t c = 0; c < out.size(); ++c) {
+        out[c].assign(in[c], in[c] + n);
+    }
+}
+
+static void
+duplicateChannel(const vector<const float *> &in, size_t n,
+                 vector<vector<float> > &out)
+{
+    for (size_t c = 0; c < out.size(); ++c) {
+        out[c].assign(in[0], in[0] + n);
+    }
+}
+
+static void
+testDefaultPolicy(const Signal &signal)
+{
+    // The default policy: mono plugins get the mean of the input
+    // channels, others the first channels of several or copies of
+    // one
+
+    const char *test = "PluginChannelAdapter";
+
+    for (size_t channels = 2; channels <= 6; ++channels) {
+        Signal input = makeChannels(signal, channels);
+        ostringstream key;
+        key << "mix " << channels << " channels to mono";
+        PluginChannelAdapter a(new EchoPlugin(1, 1)), b(new EchoPlugin(1, 1));
+        checkAdapter(test, key.str(), &a, &b, input, 1, meanOfChannels);
+    }
+
+    {
+        Signal input = makeChannels(signal, 5);
+        PluginChannelAdapter a(new EchoPlugin(2, 3)), b(new EchoPlugin(2, 3));
+        checkAdapter(test, "first 3 of 5 channels", &a, &b, input, 3,
+                     firstChannels);
+    }
+
+    {
+        Signal input = makeChannels(signal, 1);
+        PluginChannelAdapter a(new EchoPlugin(3, 4)), b(new EchoPlugin(3, 4));
+        checkAdapter(test, "mono to 3 channels", &a, &b, input, 3,
+                     duplicateChannel);
+    }
+}
+
+// A sparse mixing matrix of four plugin channels from five inputs:
+// one input forwarded at unity gain, a mid mix, a channel with no
+// inputs, and one mixing three inputs with a zero gain among them
+
+static const size_t matrixInputs = 5, matrixOutputs = 4;
+static const float matrixGains[matrixOutputs * matrixInputs] = {
+     0.f,   0.f,  1.f, 0.f, 0.f,
+     0.5f,  0.5f, 0.f, 0.f, 0.f,
+     0.f,   0.f,  0.f, 0.f, 0.f,
+    -0.25f, 2.f,  0.f, 0.f, 0.75f
+};
+
+static void
+applyMatrix(const vector<const float *> &in, size_t n,
+            vector<vector<float> > &out)
+{
+    for (size_t p = 0; p < matrixOutputs; ++p) {
+        const float *gains = matrixGains + p * matrixInputs;
+        for (size_t i = 0; i < n; ++i) {
+            float acc = 0.f;
+            bool first = true;
+            for (size_t c = 0; c < matrixInputs; ++c) {
+                if (gains[c] == 0.f) continue;
+                float v = in[c][i] * gains[c];
+                if (first) acc = v;
+                else acc += v;
+                first = false;
+            }
+            out[p][i] = acc;
+        }
+    }
+}
+
+static void
+testMixingMatrix(const Signal &signal)
+{
+    // A sparse matrix, against the same mix calculated directly, and
+    // the conditions under which a matrix is refused
+
+    const char *test = "PluginChannelAdapter matrix";
+
+    vector<float> gains(matrixGains, matrixGains + matrixOutputs * matrixInputs);
+    Signal input = makeChannels(signal, matrixInputs);
+
+    {
+        PluginChannelAdapter a(new EchoPlugin(1, 4)), b(new EchoPlugin(1, 4));
+        bool ok = a.setMixingMatrix(matrixOutputs, matrixInputs, gains) &&
+            b.setMixingMatrix(matrixOutputs, matrixInputs, gains);
+        check(test, "sparse matrix", ok, "matrix refused");
+        if (ok) {
+            checkAdapter(test, "sparse matrix", &a, &b, input, matrixOutputs,
+                         applyMatrix);
+        }
+    }
+
+    {
+        PluginChannelAdapter a(new EchoPlugin(1, 4));
+        check(test, "wrong size", !a.setMixingMatrix(3, 5, gains),
+              "matrix accepted");
+    }
+
+    {
+        PluginChannelAdapter a(new EchoPlugin(1, 2));
+        a.setMixingMatrix(matrixOutputs, matrixInputs, gains);
+        check(test, "too many plugin channels",
+              !a.initialise(matrixInputs, echoBlockSize, echoBlockSize),
+              "initialise succeeded");
+    }
+
+    {
+        PluginChannelAdapter a(new EchoPlugin(1, 4));
+        a.setMixingMatrix(matrixOutputs, matrixInputs, gains);
+        check(test, "wrong input channels",
+              !a.initialise(matrixInputs - 1, echoBlockSize, echoBlockSize),
+              "initialise succeeded");
+    }
+}
+
+void
+testChannelAdapter(const PluginKeys &, const Signal &signal)
+{
+    testDefaultPolicy(signal);
+    testMixingMatrix(signal);
+}
@@ -0,0 +1,111 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/ChunkedPluginRunner.h>
+
+#include <algorithm>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::HostExt::PluginLoader;
+using Vamp::HostExt::ChunkedPluginRunner;
+
+class SignalSource : public ChunkedPluginRunner::Source
+{
+public:
+    SignalSource(const Signal &signal) : m_signal(signal) { }
+
+    size_t getChannelCount() const { return m_signal.size(); }
+    size_t getFrameCount() const { return frameCount; }
+
+    size_t read(size_t start, size_t count, float *const *buffers) {
+        if (start >= frameCount) return 0;
+        if (count > frameCount - start) count = frameCount - start;
+        for (size_t c = 0; c < m_signal.size(); ++c) {
+            copy(m_signal[c].begin() + start,
+                 m_signal[c].begin() + start + count, buffers[c]);
+        }
+        return count;
+    }
+
+private:
+    const Signal &m_signal;
+};
+
+void
+testChunkedPluginRunner(const PluginKeys &keys, const Signal &signal)
+{
+    // Chunks of one second on four threads, for plugins that declare
+    // a warm-up (the others are run as a single chunk), against a
+    // single instance processing the same blocks as vamp-simple-host
+
+    const char *test = "ChunkedPluginRunner";
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+
+        ChunkedPluginRunner runner(keys[i], sampleRate);
+        runner.setThreadCount(4);
+        runner.setChunkSize(sampleRate);
+
+        SignalSource source(signal);
+        bool ok = runner.run(source);
+        check(test, keys[i], ok, "run failed");
+        if (!ok) continue;
+
+        size_t step = runner.getStepSize();
+        size_t block = runner.getBlockSize();
+        Plugin *plugin = loadInitialised
+            (keys[i], PluginLoader::ADAPT_ALL_SAFE, step, block);
+        check(test, keys[i], plugin != 0, "failed to load reference plugin");
+        if (!plugin) continue;
+
+        if (plugin->getWarmUpFrames() >= 0) {
+            check(test, keys[i], runner.getChunkCount() > 1,
+                  "input was not split into chunks");
+        }
+
+        string message;
+        ok = compare(runner.takeFeatures(),
+                     runSequential(plugin, signal, step, block,
+                                   getHostBlocks(step, block), false),
+                     message);
+        check(test, keys[i], ok, message);
+        delete plugin;
+    }
+}
@@ -0,0 +1,183 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/PluginSummarisingAdapter.h>
+
+#include <algorithm>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginLoader;
+using Vamp::HostExt::PluginSummarisingAdapter;
+
+static Plugin::FeatureSet
+leading(const Plugin::FeatureSet &features, const Plugin::FeatureSet &like)
+{
+    // The first features of each output in features, as many as there
+    // are on that output in like
+
+    Plugin::FeatureSet result;
+    for (Plugin::FeatureSet::const_iterator i = like.begin();
+         i != like.end(); ++i) {
+        Plugin::FeatureSet::const_iterator j = features.find(i->first);
+        if (j == features.end()) continue;
+        size_t n = min(i->second.size(), j->second.size());
+        result[i->first] = Plugin::FeatureList(j->second.begin(),
+                                               j->second.begin() + n);
+    }
+    return result;
+}
+
+static size_t
+count(const Plugin::FeatureSet &features)
+{
+    size_t n = 0;
+    for (Plugin::FeatureSet::const_iterator i = features.begin();
+         i != features.end(); ++i) {
+        n += i->second.size();
+    }
+    return n;
+}
+
+void
+testCompletedSummaries(const PluginKeys &keys, const Signal &signal)
+{
+    // Summaries of the completed segments, queried every so often
+    // while processing, against those queried at the following
+    // point and against the final summaries once processing is done
+
+    const char *test = "PluginSummarisingAdapter completed segments";
+
+    PluginSummarisingAdapter::SegmentBoundaries boundaries;
+    for (int s = 1; s < 12; ++s) {
+        boundaries.insert(RealTime::fromSeconds(s * 0.5));
+    }
+
+    PluginSummarisingAdapter::SummaryType types[] = {
+        PluginSummarisingAdapter::Maximum,
+        PluginSummarisingAdapter::Mean,
+        PluginSummarisingAdapter::Variance
+    };
+    const int typeCount = int(sizeof(types)/sizeof(types[0]));
+
+    const size_t size = 1024, interval = 20;
+    size_t midStream = 0;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+
+        PluginSummarisingAdapter *adapters[2];
+        for (int s = 0; s < 2; ++s) {
+            adapters[s] = new PluginSummarisingAdapter
+                (PluginLoader::getInstance()->loadPlugin
+                 (keys[i], sampleRate, PluginLoader::ADAPT_ALL));
+            adapters[s]->setStreamingMode(s == 1);
+            adapters[s]->setSummarySegmentBoundaries(boundaries);
+            adapters[s]->initialise(channelCount, size, size);
+        }
+        PluginSummarisingAdapter *stored = adapters[0];
+        PluginSummarisingAdapter *streaming = adapters[1];
+
+        vector<vector<float> > buffers(channelCount, vector<float>(size));
+        vector<const float *> ptrs(channelCount);
+        for (int c = 0; c < channelCount; ++c) ptrs[c] = &buffers[c][0];
+
+        vector<Plugin::FeatureSet> previous(typeCount);
+        bool ok = true, none = true;
+        string message;
+
+        size_t blocks = getHostBlocks(size, size);
+
+        for (size_t b = 0; b < blocks; ++b) {
+
+            getBlock(signal, b * size, buffers);
+            RealTime time = RealTime::frame2RealTime(long(b * size),
+                                                     sampleRate);
+            stored->process(&ptrs[0], time);
+            streaming->process(&ptrs[0], time);
+
+            if (b % interval != interval - 1) continue;
+
+            if (b == interval - 1) {
+                // (this prints a warning)
+                none = stored->getCompletedSummaryForAllOutputs
+                    (types[0], PluginSummarisingAdapter::SampleAverage).empty();
+            }
+
+            for (int t = 0; t < typeCount && ok; ++t) {
+                Plugin::FeatureSet current =
+                    streaming->getCompletedSummaryForAllOutputs
+                    (types[t], PluginSummarisingAdapter::SampleAverage);
+                ok = compare(leading(current, previous[t]), previous[t],
+                             message);
+                if (!ok) message = "earlier summaries changed: " + message;
+                midStream += count(current);
+                previous[t] = current;
+            }
+        }
+
+        stored->getRemainingFeatures();
+        streaming->getRemainingFeatures();
+
+        check(test, keys[i], none, "returned summaries in non-streaming mode");
+
+        for (int t = 0; t < typeCount && ok; ++t) {
+            Plugin::FeatureSet all = streaming->getSummaryForAllOutputs
+                (types[t], PluginSummarisingAdapter::SampleAverage);
+            ok = compare(leading(all, previous[t]), previous[t], message);
+            if (!ok) {
+                message = "differ from final summaries: " + message;
+                break;
+            }
+            ok = compareSummaries
+                (all, stored->getSummaryForAllOutputs
+                 (types[t], PluginSummarisingAdapter::SampleAverage),
+                 message);
+            if (!ok) message = "differ from stored summaries: " + message;
+        }
+
+        check(test, keys[i], ok, message);
+
+        delete stored;
+        delete streaming;
+    }
+
+    check(test, "all plugins", midStream > 0,
+          "no segments completed during processing");
+}
@@ -0,0 +1,147 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/FeatureColumns.h>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginLoader;
+using Vamp::HostExt::FeatureColumns;
+using Vamp::HostExt::FeatureColumnSet;
+
+static void
+testProcessColumns(const PluginKeys &keys, const Signal &signal)
+{
+    // Two instances fed the same blocks, one through process() and
+    // one through processColumns(), compared block by block
+
+    const char *test = "processColumns";
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+
+        size_t step = 0, block = 0;
+        Plugin *a = loadInitialised
+            (keys[i], PluginLoader::ADAPT_ALL_SAFE, step, block);
+        Plugin *b = loadInitialised
+            (keys[i], PluginLoader::ADAPT_ALL_SAFE, step, block);
+        check(test, keys[i], a && b, "failed to load plugins");
+        if (!a || !b) {
+            delete a;
+            delete b;
+            continue;
+        }
+
+        vector<vector<float> > buffers(channelCount, vector<float>(block));
+        vector<const float *> ptrs(channelCount);
+        for (int c = 0; c < channelCount; ++c) ptrs[c] = &buffers[c][0];
+
+        FeatureColumnSet columns;
+        size_t blocks = getHostBlocks(step, block);
+        bool ok = true;
+        string message;
+
+        for (size_t n = 0; n < blocks && ok; ++n) {
+            size_t start = n * step;
+            getBlock(signal, start, buffers);
+            RealTime time = RealTime::frame2RealTime(long(start), sampleRate);
+            Plugin::FeatureSet expected = a->process(&ptrs[0], time);
+            Vamp::HostExt::processColumns(b, &ptrs[0], time, columns);
+            Plugin::FeatureSet obtained;
+            Vamp::HostExt::convertFeatures(columns, obtained);
+            ok = compare(obtained, expected, message);
+        }
+
+        if (ok) {
+            ok = compare(b->getRemainingFeatures(), a->getRemainingFeatures(),
+                         message);
+        }
+
+        check(test, keys[i], ok, message);
+        delete a;
+        delete b;
+    }
+}
+
+static void
+testSelfAppend()
+{
+    // Appending features from the same object, enough times for its
+    // value storage to be reallocated along the way, against the same
+    // features appended to a FeatureList
+
+    const char *test = "FeatureColumns";
+
+    FeatureColumns columns;
+    Plugin::FeatureList expected;
+
+    for (size_t i = 0; i < 5; ++i) {
+        Plugin::Feature f;
+        f.hasTimestamp = (i % 2 == 0);
+        f.timestamp = RealTime::frame2RealTime(long(i * 512), sampleRate);
+        for (size_t j = 0; j < i * 7 + 1; ++j) {
+            f.values.push_back(float(i) + float(j) / 8.f);
+        }
+        if (i % 3 == 0) f.label = "label";
+        columns.append(f);
+        expected.push_back(f);
+    }
+
+    for (size_t n = 0; n < 200; ++n) {
+        size_t i = (n * 7) % columns.size();
+        columns.append(columns, i);
+        expected.push_back(expected[i]);
+    }
+
+    Plugin::FeatureList obtained;
+    columns.toFeatureList(obtained);
+
+    Plugin::FeatureSet a, b;
+    a[0] = obtained;
+    b[0] = expected;
+    string message;
+    check(test, "append from itself", compare(a, b, message), message);
+}
+
+void
+testFeatureColumns(const PluginKeys &keys, const Signal &signal)
+{
+    testProcessColumns(keys, signal);
+    testSelfAppend();
+}
@@ -0,0 +1,277 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include "../host/FeatureFile.h"
+
+#include <fstream>
+#include <sstream>
+
+#include <cstdio>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginLoader;
+
+static const char *const filename = "vamp-regression.tmp";
+
+static void
+testRoundTrip(const PluginKeys &keys, const Signal &signal)
+{
+    // Write each output's features to a binary feature file and read
+    // them back, in whichever layout the writer chooses
+
+    const char *test = "FeatureFile";
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+
+        size_t step = 0, block = 0;
+        Plugin *plugin = loadInitialised
+            (keys[i], PluginLoader::ADAPT_ALL_SAFE, step, block);
+        check(test, keys[i], plugin != 0, "failed to load plugin");
+        if (!plugin) continue;
+
+        Plugin::OutputList outputs = plugin->getOutputDescriptors();
+        Plugin::FeatureSet features = runSequential
+            (plugin, signal, step, block, getHostBlocks(step, block), true);
+        delete plugin;
+
+        for (int o = 0; o < int(outputs.size()); ++o) {
+
+            const Plugin::FeatureList &written = features[o];
+            ostringstream key;
+            key << keys[i] << ":" << outputs[o].identifier;
+
+            FeatureFileWriter writer;
+            bool ok = writer.open(filename, sampleRate, int(step), outputs[o]);
+            check(test, key.str(), ok, "failed to open file for writing");
+            if (!ok) continue;
+
+            bool columnar = writer.isColumnar();
+            for (size_t j = 0; j < written.size(); ++j) {
+                if (columnar) {
+                    writer.writeColumn(RealTime::realTime2Frame
+                                       (written[j].timestamp, sampleRate),
+                                       written[j].values);
+                } else {
+                    writer.writeFeature(written[j].timestamp, written[j]);
+                }
+            }
+            check(test, key.str(), writer.close(), "failed to write file");
+
+            FeatureFileReader reader;
+            ok = reader.open(filename);
+            check(test, key.str(), ok, "failed to open file for reading");
+            if (!ok) continue;
+
+            const Plugin::OutputDescriptor &od = reader.getOutputDescriptor();
+            check(test, key.str(),
+                  reader.getSampleRate() == sampleRate &&
+                  reader.getStepSize() == int(step) &&
+                  od.identifier == outputs[o].identifier &&
+                  od.binCount == outputs[o].binCount &&
+                  od.binNames == outputs[o].binNames &&
+                  od.sampleType == outputs[o].sampleType,
+                  "header differs from output descriptor");
+
+            Plugin::FeatureSet expected, obtained;
+            for (size_t j = 0; j < written.size(); ++j) {
+                Plugin::Feature f = written[j];
+                if (columnar) {
+                    // only values and a frame-rounded time are stored
+                    f.timestamp = RealTime::frame2RealTime
+                        (RealTime::realTime2Frame(f.timestamp, sampleRate),
+                         sampleRate);
+                    f.hasDuration = false;
+                    f.label = "";
+                }
+                expected[o].push_back(f);
+            }
+            Plugin::Feature f;
+            while (reader.readFeature(f)) {
+                if (!f.hasDuration) f.duration = RealTime::zeroTime;
+                obtained[o].push_back(f);
+            }
+
+            string message;
+            check(test, key.str(), !reader.hasError(), "file is truncated");
+            check(test, key.str(), compare(obtained, expected, message),
+                  message);
+        }
+    }
+}
+
+static string
+writeRecordFile(size_t &headerSize)
+{
+    // A small file in the record layout, returned as its bytes
+
+    Plugin::OutputDescriptor od;
+    od.identifier = "onsets";
+    od.name = "Onsets";
+    od.hasFixedBinCount = true;
+    od.binCount = 2;
+    od.binNames.push_back("a");
+    od.binNames.push_back("b");
+    od.sampleType = Plugin::OutputDescriptor::VariableSampleRate;
+
+    FeatureFileWriter writer;
+    writer.open(filename, sampleRate, 512, od);
+    writer.close();
+
+    ifstream in(filename, ios::in | ios::binary);
+    ostringstream header;
+    header << in.rdbuf();
+    headerSize = header.str().size();
+    in.close();
+
+    writer.open(filename, sampleRate, 512, od);
+    for (int i = 0; i < 3; ++i) {
+        Plugin::Feature f;
+        f.hasTimestamp = true;
+        f.timestamp = RealTime(i, 0);
+        f.values.push_back(float(i));
+        f.values.push_back(float(i) / 2.f);
+        f.label = "onset";
+        writer.writeFeature(f.timestamp, f);
+    }
+    writer.close();
+
+    in.open(filename, ios::in | ios::binary);
+    ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+static void
+putInt(string &bytes, size_t offset, unsigned int value)
+{
+    for (int i = 0; i < 4; ++i) {
+        bytes[offset + i] = char((value >> (8 * i)) & 0xff);
+    }
+}
+
+static bool
+readsWithError(const string &bytes)
+{
+    // Write the given bytes to the file and read it through, returning
+    // true if the reader reported an error rather than a clean end
+
+    ofstream out(filename, ios::out | ios::binary);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+
+    FeatureFileReader reader;
+    if (!reader.open(filename)) return true;
+
+    Plugin::Feature f;
+    while (reader.readFeature(f)) ;
+    return reader.hasError();
+}
+
+static void
+testCorruptFiles()
+{
+    // Truncated files, and lengths that run far past the end of the
+    // file, must be reported as errors without reading or allocating
+    // past the end
+
+    const char *test = "FeatureFile";
+
+    size_t headerSize = 0;
+    string bytes = writeRecordFile(headerSize);
+    size_t recordSize = (bytes.size() - headerSize) / 3;
+
+    check(test, "intact file", !readsWithError(bytes), "reported an error");
+
+    bool ok = true;
+    for (size_t n = 0; n < bytes.size() && ok; ++n) {
+        if (n == headerSize || n == headerSize + recordSize ||
+            n == headerSize + 2 * recordSize) {
+            continue; // these end cleanly between records
+        }
+        ok = readsWithError(bytes.substr(0, n));
+    }
+    check(test, "truncated file", ok, "truncation not reported");
+
+    // Offsets of the length fields: the identifier is the first
+    // string after the 24 bytes of magic, version, layout, sample
+    // rate and step size; the value count and label length are the
+    // last two integers before the values of the first record
+    size_t identifierLength = 24;
+    size_t valueCount = headerSize + 20;
+    size_t labelLength = headerSize + 24;
+
+    unsigned int huge[] = { 0x7fffffff, 0xfffffff0, 0xffffffff };
+
+    for (size_t i = 0; i < sizeof(huge) / sizeof(huge[0]); ++i) {
+
+        string corrupt = bytes;
+        putInt(corrupt, identifierLength, huge[i]);
+        check(test, "huge string length", readsWithError(corrupt),
+              "not reported");
+
+        corrupt = bytes;
+        putInt(corrupt, valueCount, huge[i]);
+        check(test, "huge value count", readsWithError(corrupt),
+              "not reported");
+
+        corrupt = bytes;
+        putInt(corrupt, labelLength, huge[i]);
+        check(test, "huge label length", readsWithError(corrupt),
+              "not reported");
+    }
+
+    // The bin name count comes just after the identifier and name
+    // strings, the empty description and unit, and the two bin count
+    // integers
+    size_t binNameCount = 24 + (4 + 6) + (4 + 6) + 4 + 4 + 4 + 4;
+    string corrupt = bytes;
+    putInt(corrupt, binNameCount, 0xfffffff0);
+    check(test, "huge bin name count", readsWithError(corrupt),
+          "not reported");
+}
+
+void
+testFeatureFile(const PluginKeys &keys, const Signal &signal)
+{
+    testRoundTrip(keys, signal);
+    testCorruptFiles();
+    remove(filename);
+}
@@ -0,0 +1,177 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/PluginInputDomainAdapter.h>
+
+#include <sstream>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginInputDomainAdapter;
+
+// A frequency-domain plugin returning, for every block, one feature
+// holding the spectra it was given for all of its channels
+
+class SpectrumEchoPlugin : public Plugin
+{
+public:
+    SpectrumEchoPlugin() :
+        Plugin(float(sampleRate)), m_channels(0), m_blockSize(0) { }
+
+    string getIdentifier() const { return "spectrumecho"; }
+    string getName() const { return "Spectrum Echo"; }
+    string getDescription() const { return ""; }
+    string getMaker() const { return ""; }
+    string getCopyright() const { return ""; }
+    int getPluginVersion() const { return 1; }
+
+    InputDomain getInputDomain() const { return FrequencyDomain; }
+    size_t getMaxChannelCount() const { return 16; }
+
+    bool initialise(size_t channels, size_t, size_t blockSize) {
+        m_channels = channels;
+        m_blockSize = blockSize;
+        return true;
+    }
+    void reset() { }
+
+    OutputList getOutputDescriptors() const {
+        OutputDescriptor d;
+        d.identifier = "spectra";
+        d.hasFixedBinCount = true;
+        d.binCount = m_channels * (m_blockSize + 2);
+        d.sampleType = OutputDescriptor::OneSamplePerStep;
+        return OutputList(1, d);
+    }
+
+    FeatureSet process(const float *const *inputBuffers, RealTime) {
+        FeatureSet fs;
+        Feature f;
+        for (size_t c = 0; c < m_channels; ++c) {
+            f.values.insert(f.values.end(), inputBuffers[c],
+                            inputBuffers[c] + m_blockSize + 2);
+        }
+        fs[0].push_back(f);
+        return fs;
+    }
+
+    FeatureSet getRemainingFeatures() { return FeatureSet(); }
+
+private:
+    size_t m_channels;
+    size_t m_blockSize;
+};
+
+static Plugin::FeatureSet
+runEcho(const Signal &signal, int threads,
+        PluginInputDomainAdapter::WindowType window)
+{
+    const size_t channels = signal.size(), size = 1024, step = 512;
+    const size_t blocks = 100;
+
+    PluginInputDomainAdapter adapter(new SpectrumEchoPlugin);
+    adapter.setThreadCount(threads);
+    adapter.setWindowType(window);
+    if (!adapter.initialise(channels, step, size)) {
+        return Plugin::FeatureSet();
+    }
+
+    vector<vector<float> > buffers(channels, vector<float>(size));
+    vector<const float *> ptrs(channels);
+    for (size_t c = 0; c < channels; ++c) ptrs[c] = &buffers[c][0];
+
+    Plugin::FeatureSet all;
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t c = 0; c < channels; ++c) {
+            for (size_t i = 0; i < size; ++i) {
+                buffers[c][i] = signal[c][b * step + i];
+            }
+        }
+        append(all, adapter.process
+               (&ptrs[0], RealTime::frame2RealTime(long(b * step),
+                                                   sampleRate)));
+    }
+    return all;
+}
+
+void
+testInputDomainThreads(const PluginKeys &, const Signal &signal)
+{
+    // The spectra of six channels, transformed on several threads,
+    // against the same transformed on one thread, for each window
+
+    const char *test = "PluginInputDomainAdapter threads";
+
+    const int channels = 6;
+    Signal many(channels, vector<float>(frameCount));
+    for (int c = 0; c < channels; ++c) {
+        for (size_t i = 0; i < frameCount; ++i) {
+            many[c][i] = signal[c % channelCount][(i + c * 37) % frameCount]
+                * float(c + 1) / float(channels);
+        }
+    }
+
+    PluginInputDomainAdapter::WindowType windows[] = {
+        PluginInputDomainAdapter::RectangularWindow,
+        PluginInputDomainAdapter::HammingWindow,
+        PluginInputDomainAdapter::HannWindow,
+        PluginInputDomainAdapter::BlackmanWindow,
+        PluginInputDomainAdapter::NuttallWindow,
+        PluginInputDomainAdapter::BlackmanHarrisWindow
+    };
+    int threads[] = { 2, 4, 6, 9 };
+
+    for (size_t w = 0; w < sizeof(windows)/sizeof(windows[0]); ++w) {
+
+        Plugin::FeatureSet expected = runEcho(many, 1, windows[w]);
+        check(test, "1 thread", expected[0].size() == 100,
+              "wrong number of spectra");
+
+        for (size_t t = 0; t < sizeof(threads)/sizeof(threads[0]); ++t) {
+            ostringstream key;
+            key << threads[t] << " threads, window " << int(windows[w]);
+            string message;
+            check(test, key.str(),
+                  compare(runEcho(many, threads[t], windows[w]), expected,
+                          message),
+                  message);
+        }
+    }
+}
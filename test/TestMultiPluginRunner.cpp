@@ -0,0 +1,201 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/MultiPluginRunner.h>
+
+#include <algorithm>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginLoader;
+using Vamp::HostExt::MultiPluginRunner;
+
+// A plugin returning no feature for some blocks and several for
+// others, none of them timestamped, so that their blocks can only be
+// found by counting blocks rather than features
+
+class UnevenPlugin : public Plugin
+{
+public:
+    UnevenPlugin() : Plugin(float(sampleRate)), m_block(0) { }
+
+    string getIdentifier() const { return "uneven"; }
+    string getName() const { return "Uneven"; }
+    string getDescription() const { return ""; }
+    string getMaker() const { return ""; }
+    string getCopyright() const { return ""; }
+    int getPluginVersion() const { return 1; }
+
+    InputDomain getInputDomain() const { return TimeDomain; }
+    size_t getPreferredBlockSize() const { return 1024; }
+    size_t getPreferredStepSize() const { return 256; }
+    size_t getMaxChannelCount() const { return channelCount; }
+
+    bool initialise(size_t, size_t, size_t) { return true; }
+    void reset() { m_block = 0; }
+
+    OutputList getOutputDescriptors() const {
+        OutputDescriptor d;
+        d.identifier = "uneven";
+        d.hasFixedBinCount = true;
+        d.binCount = 1;
+        d.sampleType = OutputDescriptor::OneSamplePerStep;
+        return OutputList(1, d);
+    }
+
+    FeatureSet process(const float *const *inputBuffers, RealTime) {
+        FeatureSet fs;
+        Feature f;
+        f.values.push_back(inputBuffers[0][0]);
+        for (int i = 0; i < m_block % 3; ++i) fs[0].push_back(f);
+        ++m_block;
+        return fs;
+    }
+
+    FeatureSet getRemainingFeatures() {
+        FeatureSet fs;
+        Feature f;
+        f.values.push_back(float(m_block));
+        fs[0].push_back(f);
+        return fs;
+    }
+
+private:
+    int m_block;
+};
+
+// Give each feature without a timestamp the time of its block
+
+static void
+stampBlocks(Plugin::FeatureSet &features,
+            MultiPluginRunner::BlockFrameSet &blockFrames)
+{
+    for (Plugin::FeatureSet::iterator i = features.begin();
+         i != features.end(); ++i) {
+        const vector<size_t> &frames = blockFrames[i->first];
+        for (size_t j = 0; j < i->second.size() && j < frames.size(); ++j) {
+            if (!i->second[j].hasTimestamp) {
+                i->second[j].hasTimestamp = true;
+                i->second[j].timestamp = RealTime::frame2RealTime
+                    (long(frames[j]), sampleRate);
+            }
+        }
+    }
+}
+
+void
+testMultiPluginRunner(const PluginKeys &keys, const Signal &signal)
+{
+    // All of the plugins together, fed in awkwardly sized pieces and
+    // run on two threads, sharing their spectra, against each run on
+    // its own over the same blocks as vamp-simple-host.  The features
+    // are compared as returned, and again with the untimestamped ones
+    // given the times of the blocks the runner reports for them
+
+    const char *test = "MultiPluginRunner";
+
+    MultiPluginRunner runner(channelCount, 2);
+    vector<Plugin *> plugins;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Plugin *plugin = PluginLoader::getInstance()->loadPlugin
+            (keys[i], sampleRate, PluginLoader::ADAPT_ALL_SAFE);
+        bool ok = (plugin && runner.addPlugin(plugin) == int(i));
+        check(test, keys[i], ok, "failed to load or add plugin");
+        if (!ok) {
+            delete plugin;
+            for (size_t j = 0; j < plugins.size(); ++j) delete plugins[j];
+            return;
+        }
+        plugins.push_back(plugin);
+    }
+
+    plugins.push_back(new UnevenPlugin);
+    check(test, "uneven", runner.addPlugin(plugins.back()) == int(keys.size()),
+          "failed to add plugin");
+
+    const size_t piece = 3001;
+    vector<const float *> ptrs(channelCount);
+    for (size_t f = 0; f < frameCount; f += piece) {
+        for (int c = 0; c < channelCount; ++c) ptrs[c] = &signal[c][f];
+        runner.process(&ptrs[0], min(piece, frameCount - f));
+    }
+    runner.finish();
+
+    for (size_t i = 0; i < plugins.size(); ++i) {
+
+        size_t step = runner.getStepSize(int(i));
+        size_t block = runner.getBlockSize(int(i));
+        string key = "uneven";
+        Plugin *plugin = 0;
+
+        if (i < keys.size()) {
+            key = keys[i];
+            plugin = loadInitialised
+                (key, PluginLoader::ADAPT_ALL_SAFE, step, block);
+        } else {
+            plugin = new UnevenPlugin;
+        }
+        check(test, key, plugin != 0, "failed to load reference plugin");
+        if (!plugin) continue;
+
+        MultiPluginRunner::BlockFrameSet blockFrames;
+        Plugin::FeatureSet obtained = runner.takeFeatures(int(i), blockFrames);
+        size_t blocks = getHostBlocks(step, block);
+
+        string message;
+        bool ok = compare(obtained,
+                          runSequential(plugin, signal, step, block,
+                                        blocks, false),
+                          message);
+        check(test, key, ok, message);
+
+        plugin->reset();
+        stampBlocks(obtained, blockFrames);
+        ok = compare(obtained,
+                     runSequential(plugin, signal, step, block, blocks, true),
+                     message);
+        check(test, key, ok, "with block times: " + message);
+
+        delete plugin;
+    }
+
+    for (size_t i = 0; i < plugins.size(); ++i) delete plugins[i];
+}
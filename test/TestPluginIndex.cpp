@@ -0,0 +1,171 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <cstdio>
+
+using namespace std;
+
+using Vamp::HostExt::PluginLoader;
+
+static const char *const indexFile = "vamp-regression-index.tmp";
+
+static string
+readFile(string path)
+{
+    ifstream in(path.c_str(), ios::in | ios::binary);
+    ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+static void
+writeFile(string path, string contents)
+{
+    ofstream out(path.c_str(), ios::out | ios::binary);
+    out << contents;
+}
+
+static PluginKeys
+listWithIndex()
+{
+    // Search the example library using the index, reloading the
+    // index file first in case the test has changed it
+
+    PluginLoader *loader = PluginLoader::getInstance();
+    loader->setIndexFile("");
+    loader->setIndexFile(indexFile);
+    return loader->listPluginsIn
+        (vector<string>(1, "vamp-example-plugins"));
+}
+
+static bool
+sameKeys(PluginKeys a, PluginKeys b)
+{
+    // listPlugins() sorts its keys, while the index and listPluginsIn
+    // keep them in the order the library returns them
+    sort(a.begin(), a.end());
+    sort(b.begin(), b.end());
+    return a == b;
+}
+
+static bool
+contains(const PluginKeys &keys, string key)
+{
+    return find(keys.begin(), keys.end(), key) != keys.end();
+}
+
+void
+testPluginIndex(const PluginKeys &keys, const Signal &)
+{
+    // The index written for the example library, and the use made of
+    // it when read back: a plugin added to it under the library's
+    // current stamp is listed without the library being searched,
+    // while under a different stamp, or in an incomplete file, it is
+    // ignored and the index rewritten from the library
+
+    const char *test = "PluginLoader index";
+
+    PluginLoader *loader = PluginLoader::getInstance();
+    remove(indexFile);
+
+    PluginKeys searched = listWithIndex();
+    check(test, "first search", sameKeys(searched, keys),
+          "plugins differ from those listed without an index");
+
+    string library = loader->getLibraryPathForPlugin(keys[0]);
+    string original = readFile(indexFile);
+
+    istringstream lines(original);
+    string line, stamp;
+    bool ok = getline(lines, line) && line == "Vamp plugin index 1";
+    if (ok) {
+        ok = getline(lines, line) && line.substr(0, 8) == "library ";
+        string::size_type si = line.find(' ', 8);
+        ok = ok && si != string::npos && si > 8 &&
+            line.substr(si + 1) == library;
+        if (ok) stamp = line.substr(8, si - 8);
+    }
+    for (size_t i = 0; ok && i < searched.size(); ++i) {
+        string id = searched[i].substr(searched[i].find(':') + 1);
+        ok = getline(lines, line) && line == "plugin " + id;
+    }
+    ok = ok && getline(lines, line) && line == "end" && !getline(lines, line);
+    check(test, "file format", ok, "unexpected contents:\n" + original);
+    if (!ok) {
+        loader->setIndexFile("");
+        remove(indexFile);
+        return;
+    }
+
+    string fakeKey = "vamp-example-plugins:regressionfake";
+    string fakeLine = "plugin regressionfake\n";
+    string::size_type end = original.rfind("end\n");
+
+    string faked = original.substr(0, end) + fakeLine + "end\n";
+    writeFile(indexFile, faked);
+    PluginKeys listed = listWithIndex();
+    check(test, "current stamp", contains(listed, fakeKey),
+          "index was not used");
+    check(test, "current stamp", readFile(indexFile) == faked,
+          "unchanged index was rewritten");
+
+    string stale = faked;
+    stale.replace(stale.find(stamp), stamp.size(), "x" + stamp);
+    writeFile(indexFile, stale);
+    listed = listWithIndex();
+    check(test, "stale stamp",
+          !contains(listed, fakeKey) && listed == searched,
+          "stale index entry was used");
+    check(test, "stale stamp", readFile(indexFile) == original,
+          "index was not rewritten from the library");
+
+    writeFile(indexFile, original.substr(0, end) + fakeLine);
+    listed = listWithIndex();
+    check(test, "incomplete file",
+          !contains(listed, fakeKey) && listed == searched,
+          "incomplete index was used");
+    check(test, "incomplete file", readFile(indexFile) == original,
+          "index was not rewritten from the library");
+
+    loader->setIndexFile("");
+    remove(indexFile);
+}
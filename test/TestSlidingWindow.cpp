@@ -0,0 +1,165 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/PluginSummarisingAdapter.h>
+
+#include <algorithm>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginLoader;
+using Vamp::HostExt::PluginSummarisingAdapter;
+
+void
+testSlidingWindow(const PluginKeys &keys, const Signal &signal)
+{
+    // Windows of one second every quarter second, against the same
+    // summaries calculated directly from the features in each window
+
+    const char *test = "PluginSummarisingAdapter sliding window";
+
+    const double length = 1.0, hop = 0.25;
+    const size_t size = 1024;
+
+    PluginSummarisingAdapter::SummaryType types[] = {
+        PluginSummarisingAdapter::Minimum,
+        PluginSummarisingAdapter::Maximum,
+        PluginSummarisingAdapter::Mean,
+        PluginSummarisingAdapter::Median,
+        PluginSummarisingAdapter::Sum,
+        PluginSummarisingAdapter::Variance,
+        PluginSummarisingAdapter::Count
+    };
+    const int typeCount = int(sizeof(types)/sizeof(types[0]));
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+
+        PluginSummarisingAdapter *adapter = new PluginSummarisingAdapter
+            (PluginLoader::getInstance()->loadPlugin
+             (keys[i], sampleRate, PluginLoader::ADAPT_ALL));
+        adapter->setSlidingWindow(RealTime::fromSeconds(length),
+                                  RealTime::fromSeconds(hop));
+        adapter->initialise(channelCount, size, size);
+
+        Plugin::FeatureSet raw = runSequential
+            (adapter, signal, size, size, getHostBlocks(size, size), true);
+
+        vector<Plugin::FeatureSet> expected(typeCount);
+
+        for (Plugin::FeatureSet::const_iterator oi = raw.begin();
+             oi != raw.end(); ++oi) {
+
+            const Plugin::FeatureList &features = oi->second;
+            size_t bins = 0;
+            for (size_t j = 0; j < features.size(); ++j) {
+                bins = max(bins, features[j].values.size());
+            }
+
+            for (int w = 0; ; ++w) {
+
+                RealTime start = RealTime::fromSeconds(w * hop);
+                RealTime end = RealTime::fromSeconds(w * hop + length);
+
+                vector<size_t> within;
+                bool later = false;
+                for (size_t j = 0; j < features.size(); ++j) {
+                    const RealTime &t = features[j].timestamp;
+                    if (t >= start) later = true;
+                    if (t >= start && t < end) within.push_back(j);
+                }
+                if (!later) break;
+                if (within.empty()) continue;
+
+                vector<Plugin::Feature> summaries(typeCount);
+
+                for (size_t bin = 0; bin < bins; ++bin) {
+
+                    vector<double> v;
+                    for (size_t j = 0; j < within.size(); ++j) {
+                        const vector<float> &values =
+                            features[within[j]].values;
+                        v.push_back(bin < values.size() ? values[bin] : 0.0);
+                    }
+
+                    size_t n = v.size();
+                    double sum = 0.0, variance = 0.0;
+                    for (size_t j = 0; j < n; ++j) sum += v[j];
+                    double mean = sum / double(n);
+                    for (size_t j = 0; j < n; ++j) {
+                        variance += (v[j] - mean) * (v[j] - mean);
+                    }
+                    variance /= double(n);
+                    sort(v.begin(), v.end());
+                    double median = (n % 2 ? v[n/2] : (v[n/2-1] + v[n/2]) / 2);
+
+                    double values[] = {
+                        v[0], v[n-1], mean, median, sum, variance, double(n)
+                    };
+                    for (int t = 0; t < typeCount; ++t) {
+                        summaries[t].values.push_back(float(values[t]));
+                    }
+                }
+
+                for (int t = 0; t < typeCount; ++t) {
+                    summaries[t].hasTimestamp = true;
+                    summaries[t].timestamp = start;
+                    expected[t][oi->first].push_back(summaries[t]);
+                }
+            }
+        }
+
+        for (int t = 0; t < typeCount; ++t) {
+            Plugin::FeatureSet obtained =
+                adapter->getSlidingWindowSummaryForAllOutputs(types[t]);
+            // compare values and window times only
+            for (Plugin::FeatureSet::iterator oi = obtained.begin();
+                 oi != obtained.end(); ++oi) {
+                for (size_t j = 0; j < oi->second.size(); ++j) {
+                    oi->second[j].hasDuration = false;
+                }
+            }
+            string message;
+            check(test, keys[i],
+                  compareSummaries(obtained, expected[t], message), message);
+        }
+
+        delete adapter;
+    }
+}
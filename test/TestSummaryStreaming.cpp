@@ -0,0 +1,103 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include <vamp-hostsdk/PluginSummarisingAdapter.h>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginLoader;
+using Vamp::HostExt::PluginSummarisingAdapter;
+
+void
+testSummaryStreaming(const PluginKeys &keys, const Signal &signal)
+{
+    // Streaming against stored results, for the summary types that
+    // streaming calculates exactly, over uneven segments
+
+    const char *test = "PluginSummarisingAdapter streaming";
+
+    PluginSummarisingAdapter::SegmentBoundaries boundaries;
+    boundaries.insert(RealTime::fromSeconds(1.3));
+    boundaries.insert(RealTime::fromSeconds(2.9));
+    boundaries.insert(RealTime::fromSeconds(4.0));
+
+    PluginSummarisingAdapter::SummaryType types[] = {
+        PluginSummarisingAdapter::Minimum,
+        PluginSummarisingAdapter::Maximum,
+        PluginSummarisingAdapter::Mean,
+        PluginSummarisingAdapter::Sum,
+        PluginSummarisingAdapter::Variance,
+        PluginSummarisingAdapter::Count
+    };
+
+    const size_t size = 1024;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+
+        PluginSummarisingAdapter *adapters[2];
+        for (int s = 0; s < 2; ++s) {
+            adapters[s] = new PluginSummarisingAdapter
+                (PluginLoader::getInstance()->loadPlugin
+                 (keys[i], sampleRate, PluginLoader::ADAPT_ALL));
+            adapters[s]->setStreamingMode(s == 1);
+            adapters[s]->setSummarySegmentBoundaries(boundaries);
+            adapters[s]->initialise(channelCount, size, size);
+            runSequential(adapters[s], signal, size, size,
+                          getHostBlocks(size, size), false);
+        }
+
+        for (int avg = 0; avg < 2; ++avg) {
+            for (size_t t = 0; t < sizeof(types)/sizeof(types[0]); ++t) {
+                PluginSummarisingAdapter::AveragingMethod method =
+                    PluginSummarisingAdapter::AveragingMethod(avg);
+                string message;
+                check(test, keys[i],
+                      compareSummaries
+                      (adapters[1]->getSummaryForAllOutputs(types[t], method),
+                       adapters[0]->getSummaryForAllOutputs(types[t], method),
+                       message),
+                      message);
+            }
+        }
+
+        delete adapters[0];
+        delete adapters[1];
+    }
+}
@@ -0,0 +1,278 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#include "RegressionTest.h"
+
+#include "../src/vamp-hostsdk/VectorOps.h"
+
+#include <sstream>
+
+using namespace std;
+
+// Lengths and buffer offsets to try: every length up to well past
+// the widest vector, so as to cover each vector loop with every
+// remainder, and each offset within a vector, so that the loads and
+// stores are misaligned in every way
+
+static const size_t maxLength = 70;
+static const size_t maxOffset = 4;
+
+static vector<float>
+makeValues(size_t n, unsigned int seed)
+{
+    vector<float> v(n);
+    for (size_t i = 0; i < n; ++i) {
+        seed = seed * 1103515245 + 12345;
+        v[i] = float(int((seed >> 8) % 20001) - 10000) / 1234.5f;
+    }
+    return v;
+}
+
+static string
+describe(const char *op, size_t n, size_t offset)
+{
+    ostringstream key;
+    key << op << ", " << n << " values at offset " << offset;
+    return key.str();
+}
+
+static void
+testMultiply()
+{
+    const char *test = "VectorOps";
+
+    vector<float> src = makeValues(maxLength + maxOffset, 1);
+    vector<float> mulf = makeValues(maxLength + maxOffset, 2);
+    vector<double> muld(mulf.begin(), mulf.end());
+    for (size_t i = 0; i < muld.size(); ++i) muld[i] /= 3.0;
+
+    bool ok = true;
+    string key;
+
+    for (size_t n = 0; n <= maxLength && ok; ++n) {
+        for (size_t off = 0; off < maxOffset && ok; ++off) {
+
+            const float *s = &src[off];
+            const float *mf = &mulf[maxOffset - 1 - off];
+            const double *md = &muld[(off + 1) % maxOffset];
+
+            vector<float> df(n + maxOffset, 0.f), ef(n);
+            vector<double> dd(n + maxOffset, 0.0), ed(n);
+            for (size_t i = 0; i < n; ++i) {
+                ef[i] = s[i] * mf[i];
+                ed[i] = s[i] * md[i];
+            }
+
+            VectorOps::multiply(s, mf, &df[off], n);
+            for (size_t i = 0; i < n && ok; ++i) ok = (df[off + i] == ef[i]);
+            if (!ok) { key = describe("multiply float", n, off); break; }
+
+            VectorOps::multiply(s, md, &dd[off], n);
+            for (size_t i = 0; i < n && ok; ++i) ok = (dd[off + i] == ed[i]);
+            if (!ok) { key = describe("multiply double", n, off); break; }
+
+            vector<float> in(src.begin(), src.end());
+            VectorOps::multiply(&in[off], mf, &in[off], n);
+            for (size_t i = 0; i < n && ok; ++i) ok = (in[off + i] == ef[i]);
+            if (!ok) { key = describe("multiply in place", n, off); break; }
+        }
+    }
+
+    check(test, ok ? "multiply" : key, ok, "differs from scalar loop");
+}
+
+static void
+testDeinterleave()
+{
+    const char *test = "VectorOps";
+
+    const size_t maxChannels = 8;
+    vector<float> src = makeValues((maxLength + maxOffset) * maxChannels, 3);
+
+    bool ok = true;
+    string key;
+
+    for (size_t sc = 1; sc <= maxChannels && ok; ++sc) {
+        for (size_t dc = 1; dc <= sc && ok; ++dc) {
+            for (size_t n = 0; n <= maxLength && ok; ++n) {
+                for (size_t off = 0; off < maxOffset && ok; ++off) {
+
+                    const float *s = &src[off];
+                    vector<vector<float> > out
+                        (dc, vector<float>(n + maxOffset, 0.f));
+                    vector<float *> dst(dc);
+                    for (size_t c = 0; c < dc; ++c) {
+                        dst[c] = &out[c][(off + c) % maxOffset];
+                    }
+
+                    VectorOps::deinterleave(s, sc, &dst[0], dc, n);
+
+                    for (size_t c = 0; c < dc && ok; ++c) {
+                        for (size_t i = 0; i < n && ok; ++i) {
+                            ok = (dst[c][i] == s[i * sc + c]);
+                        }
+                    }
+                    if (!ok) {
+                        ostringstream op;
+                        op << "deinterleave " << dc << " of " << sc
+                           << " channels";
+                        key = describe(op.str().c_str(), n, off);
+                    }
+                }
+            }
+        }
+    }
+
+    check(test, ok ? "deinterleave" : key, ok, "differs from scalar loop");
+}
+
+static void
+testMixDown()
+{
+    const char *test = "VectorOps";
+
+    const size_t maxChannels = 8;
+    vector<vector<float> > channels(maxChannels);
+    for (size_t c = 0; c < maxChannels; ++c) {
+        channels[c] = makeValues(maxLength + maxOffset, 4 + c);
+    }
+    vector<float> interleaved = makeValues
+        ((maxLength + maxOffset) * maxChannels, 12);
+
+    bool ok = true;
+    string key;
+
+    for (size_t cc = 1; cc <= maxChannels && ok; ++cc) {
+        for (size_t n = 0; n <= maxLength && ok; ++n) {
+            for (size_t off = 0; off < maxOffset && ok; ++off) {
+
+                vector<const float *> src(cc);
+                for (size_t c = 0; c < cc; ++c) {
+                    src[c] = &channels[c][(off + c) % maxOffset];
+                }
+                vector<float> dst(n + maxOffset, 0.f);
+
+                VectorOps::mixDown(&src[0], cc, &dst[off], n);
+
+                for (size_t i = 0; i < n && ok; ++i) {
+                    float acc = src[0][i];
+                    for (size_t c = 1; c < cc; ++c) acc += src[c][i];
+                    ok = (dst[off + i] == acc / float(cc));
+                }
+                if (!ok) {
+                    ostringstream op;
+                    op << "mixDown " << cc << " channels";
+                    key = describe(op.str().c_str(), n, off);
+                    break;
+                }
+
+                const float *s = &interleaved[off];
+                VectorOps::mixDownInterleaved(s, cc, &dst[off], n);
+
+                for (size_t i = 0; i < n && ok; ++i) {
+                    float acc = s[i * cc];
+                    for (size_t c = 1; c < cc; ++c) acc += s[i * cc + c];
+                    ok = (dst[off + i] == acc / float(cc));
+                }
+                if (!ok) {
+                    ostringstream op;
+                    op << "mixDownInterleaved " << cc << " channels";
+                    key = describe(op.str().c_str(), n, off);
+                }
+            }
+        }
+    }
+
+    check(test, ok ? "mixDown" : key, ok, "differs from scalar loop");
+}
+
+static void
+testMix()
+{
+    const char *test = "VectorOps";
+
+    const size_t maxChannels = 8;
+    vector<vector<float> > channels(maxChannels);
+    for (size_t c = 0; c < maxChannels; ++c) {
+        channels[c] = makeValues(maxLength + maxOffset, 20 + c);
+    }
+    vector<float> gains = makeValues(maxChannels, 30);
+
+    bool ok = true;
+    string key;
+
+    for (size_t cc = 1; cc <= maxChannels && ok; ++cc) {
+        for (size_t n = 0; n <= maxLength && ok; ++n) {
+            for (size_t off = 0; off < maxOffset && ok; ++off) {
+
+                vector<const float *> src(cc);
+                for (size_t c = 0; c < cc; ++c) {
+                    src[c] = &channels[c][(off + c) % maxOffset];
+                }
+                vector<float> dst(n + maxOffset, 0.f);
+
+                VectorOps::mix(&src[0], &gains[0], cc, &dst[off], n);
+
+                for (size_t i = 0; i < n && ok; ++i) {
+                    float acc = src[0][i] * gains[0];
+                    for (size_t c = 1; c < cc; ++c) acc += src[c][i] * gains[c];
+                    ok = (dst[off + i] == acc);
+                }
+                if (!ok) {
+                    ostringstream op;
+                    op << "mix " << cc << " channels";
+                    key = describe(op.str().c_str(), n, off);
+                }
+            }
+        }
+    }
+
+    check(test, ok ? "mix" : key, ok, "differs from scalar loop");
+}
+
+void
+testVectorOps(const PluginKeys &, const Signal &)
+{
+    // Each vectorised operation against the plain loop it replaces,
+    // which it must match exactly.  This covers whichever of the
+    // SSE2, NEON and AVX paths the build and CPU select: with AVX,
+    // the SSE2 path handles the part of each buffer left over from
+    // the AVX loop
+    testMultiply();
+    testDeinterleave();
+    testMixDown();
+    testMix();
+}
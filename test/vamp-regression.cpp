@@ -0,0 +1,321 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+/*
+ * vamp-regression runs the example plugins, and some simple test
+ * plugins of its own, over a generated signal through the various
+ * processing paths of the host SDK, and checks that each returns the
+ * same results as a plain reference: a sequential run of process(),
+ * a direct calculation, or a scalar loop.  It is run by "make test"
+ * and "make check", with VAMP_PATH set to find the example plugins,
+ * and exits with a non-zero status if any check fails.
+ *
+ * The tests themselves are in the other files in this directory.
+ */
+
+#include "RegressionTest.h"
+
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <algorithm>
+
+#include <cmath>
+
+using namespace std;
+
+using Vamp::Plugin;
+using Vamp::RealTime;
+using Vamp::HostExt::PluginLoader;
+
+static int checks = 0;
+static int failures = 0;
+
+void
+check(string test, string key, bool ok, const string &message)
+{
+    ++checks;
+    if (ok) return;
+    cerr << "FAIL: " << test << ": " << key << ": " << message << endl;
+    ++failures;
+}
+
+void
+append(Plugin::FeatureSet &to, const Plugin::FeatureSet &from)
+{
+    for (Plugin::FeatureSet::const_iterator i = from.begin();
+         i != from.end(); ++i) {
+        Plugin::FeatureList &list = to[i->first];
+        list.insert(list.end(), i->second.begin(), i->second.end());
+    }
+}
+
+void
+stamp(Plugin::FeatureSet &features, RealTime time)
+{
+    for (Plugin::FeatureSet::iterator i = features.begin();
+         i != features.end(); ++i) {
+        for (size_t j = 0; j < i->second.size(); ++j) {
+            if (!i->second[j].hasTimestamp) {
+                i->second[j].hasTimestamp = true;
+                i->second[j].timestamp = time;
+            }
+        }
+    }
+}
+
+bool
+compare(const Plugin::FeatureSet &obtained, const Plugin::FeatureSet &expected,
+        string &message)
+{
+    static const Plugin::FeatureList none;
+
+    set<int> outputs;
+    Plugin::FeatureSet::const_iterator i;
+    for (i = obtained.begin(); i != obtained.end(); ++i) outputs.insert(i->first);
+    for (i = expected.begin(); i != expected.end(); ++i) outputs.insert(i->first);
+
+    for (set<int>::const_iterator oi = outputs.begin(); oi != outputs.end(); ++oi) {
+
+        i = obtained.find(*oi);
+        const Plugin::FeatureList &a = (i == obtained.end() ? none : i->second);
+        i = expected.find(*oi);
+        const Plugin::FeatureList &b = (i == expected.end() ? none : i->second);
+
+        ostringstream where;
+        where << "output " << *oi << ": ";
+
+        if (a.size() != b.size()) {
+            where << a.size() << " features, expected " << b.size();
+            message = where.str();
+            return false;
+        }
+
+        for (size_t j = 0; j < a.size(); ++j) {
+
+            const Plugin::Feature &fa = a[j], &fb = b[j];
+            string difference;
+
+            if (fa.hasTimestamp != fb.hasTimestamp ||
+                (fa.hasTimestamp && fa.timestamp != fb.timestamp)) {
+                difference = "timestamp";
+            } else if (fa.hasDuration != fb.hasDuration ||
+                       (fa.hasDuration && fa.duration != fb.duration)) {
+                difference = "duration";
+            } else if (fa.label != fb.label) {
+                difference = "label";
+            } else if (fa.values != fb.values) {
+                difference = "values";
+            } else {
+                continue;
+            }
+
+            where << "feature " << j << " (at" << fb.timestamp
+                  << ") differs in " << difference;
+            message = where.str();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+compareSummaries(const Plugin::FeatureSet &obtained,
+                 const Plugin::FeatureSet &expected, string &message)
+{
+    Plugin::FeatureSet a(obtained), b(expected);
+
+    for (Plugin::FeatureSet::iterator i = a.begin(); i != a.end(); ++i) {
+        Plugin::FeatureList &la = i->second;
+        Plugin::FeatureList &lb = b[i->first];
+        for (size_t j = 0; j < la.size() && j < lb.size(); ++j) {
+            vector<float> &va = la[j].values, &vb = lb[j].values;
+            for (size_t k = 0; k < va.size() && k < vb.size(); ++k) {
+                double scale = max(1.0, fabs(double(vb[k])));
+                if (fabs(double(va[k]) - double(vb[k])) <= 1e-4 * scale) {
+                    va[k] = vb[k];
+                }
+            }
+            la[j].label = lb[j].label;
+        }
+    }
+
+    return compare(a, b, message);
+}
+
+void
+getBlock(const Signal &signal, size_t start, vector<vector<float> > &buffers)
+{
+    for (size_t c = 0; c < buffers.size(); ++c) {
+        for (size_t i = 0; i < buffers[c].size(); ++i) {
+            buffers[c][i] = (start + i < frameCount ?
+                             signal[c][start + i] : 0.f);
+        }
+    }
+}
+
+Plugin *
+loadInitialised(PluginLoader::PluginKey key, int adapterFlags,
+                size_t &stepSize, size_t &blockSize)
+{
+    Plugin *plugin = PluginLoader::getInstance()->loadPlugin
+        (key, sampleRate, adapterFlags);
+    if (!plugin) return 0;
+
+    if (blockSize == 0) {
+        blockSize = plugin->getPreferredBlockSize();
+        if (blockSize == 0) blockSize = 1024;
+    }
+    if (stepSize == 0) {
+        stepSize = plugin->getPreferredStepSize();
+        if (stepSize == 0) {
+            stepSize = (plugin->getInputDomain() == Plugin::FrequencyDomain ?
+                        blockSize / 2 : blockSize);
+        }
+        if (stepSize > blockSize) blockSize = stepSize;
+    }
+
+    if (!plugin->initialise(channelCount, stepSize, blockSize)) {
+        delete plugin;
+        return 0;
+    }
+    return plugin;
+}
+
+size_t
+getHostBlocks(size_t stepSize, size_t blockSize)
+{
+    size_t complete = 0;
+    if (frameCount >= blockSize) {
+        complete = (frameCount - blockSize) / stepSize + 1;
+    }
+    size_t padded = blockSize / stepSize;
+    return complete + (padded > 2 ? padded - 1 : 1);
+}
+
+Plugin::FeatureSet
+runSequential(Plugin *plugin, const Signal &signal, size_t stepSize,
+              size_t blockSize, size_t blocks, bool stamped)
+{
+    Plugin::FeatureSet all;
+
+    vector<vector<float> > buffers(channelCount, vector<float>(blockSize));
+    vector<const float *> ptrs(channelCount);
+    for (int c = 0; c < channelCount; ++c) ptrs[c] = &buffers[c][0];
+
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t start = b * stepSize;
+        getBlock(signal, start, buffers);
+        RealTime time = RealTime::frame2RealTime(long(start), sampleRate);
+        Plugin::FeatureSet features = plugin->process(&ptrs[0], time);
+        if (stamped) stamp(features, time);
+        append(all, features);
+    }
+
+    Plugin::FeatureSet features = plugin->getRemainingFeatures();
+    if (stamped) {
+        stamp(features, RealTime::frame2RealTime(long(blocks * stepSize),
+                                                 sampleRate));
+    }
+    append(all, features);
+
+    return all;
+}
+
+static Signal
+makeSignal()
+{
+    // A tone whose level steps every tenth of a second, with a little
+    // noise, and with a coarsely quantised stretch every so often so
+    // that some outputs have repeated values
+
+    Signal signal(channelCount, vector<float>(frameCount));
+    unsigned int seed = 1;
+
+    for (size_t i = 0; i < frameCount; ++i) {
+        seed = seed * 1103515245 + 12345;
+        float noise = float((seed >> 16) % 1000) / 5000.f;
+        float v = float(sin(double(i) * 0.05) * double((i / 4410) % 3)) + noise;
+        if ((i / 1024) % 7 == 3) v = floorf(v * 4.f) / 4.f;
+        signal[0][i] = v;
+        signal[1][i] = v * 0.5f - noise;
+    }
+
+    return signal;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        cerr << "Usage: " << argv[0] << endl
+             << "Checks the host SDK against the Vamp example plugins, which must be" << endl
+             << "found in the Vamp plugin path (set VAMP_PATH to the examples directory)." << endl;
+        return 2;
+    }
+
+    PluginKeys keys;
+    PluginKeys all = PluginLoader::getInstance()->listPlugins();
+    for (size_t i = 0; i < all.size(); ++i) {
+        if (all[i].find("vamp-example-plugins:") == 0) {
+            keys.push_back(all[i]);
+        }
+    }
+
+    if (keys.empty()) {
+        cerr << "ERROR: No example plugins found; set VAMP_PATH to the examples directory" << endl;
+        return 1;
+    }
+
+    Signal signal = makeSignal();
+
+    testChunkedPluginRunner(keys, signal);
+    testMultiPluginRunner(keys, signal);
+    testFeatureColumns(keys, signal);
+    testFeatureFile(keys, signal);
+    testSummaryStreaming(keys, signal);
+    testCompletedSummaries(keys, signal);
+    testSlidingWindow(keys, signal);
+    testInputDomainThreads(keys, signal);
+    testVectorOps(keys, signal);
+    testChannelAdapter(keys, signal);
+    testPluginIndex(keys, signal);
+
+    cerr << "vamp-regression: " << checks << " check(s), "
+         << failures << " failure(s)" << endl;
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,219 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _VAMP_CHUNKED_PLUGIN_RUNNER_H_
+#define _VAMP_CHUNKED_PLUGIN_RUNNER_H_
+
+#include "hostguard.h"
+#include "Plugin.h"
+#include "PluginLoader.h"
+
+#include <string>
+
+_VAMP_SDK_HOSTSPACE_BEGIN(ChunkedPluginRunner.h)
+
+namespace Vamp {
+
+namespace HostExt {
+
+/**
+ * \class ChunkedPluginRunner ChunkedPluginRunner.h <vamp-hostsdk/ChunkedPluginRunner.h>
+ *
+ * ChunkedPluginRunner runs a single plugin over a long, seekable
+ * audio input by splitting the input into chunks and processing
+ * several chunks at once, each with its own instance of the plugin,
+ * on separate threads.
+ *
+ * This is only possible for plugins that declare, through
+ * Plugin::getWarmUpFrames, how much preceding input they need to
+ * have seen in order to produce the same features for a block as
+ * they would have done had they processed everything before it.
+ * Each chunk is started early by that many frames (rounded up to a
+ * whole number of steps) and the features returned for the blocks
+ * of this warm-up period are discarded.  The features from the
+ * chunks are then joined, in order, so that the result is exactly
+ * that of processing the whole input with a single instance: every
+ * block is passed to process() with its timestamp relative to the
+ * start of the input, and the features from getRemainingFeatures()
+ * are those returned by the instance that processed the final chunk.
+ * At the end of the input the runner follows the same convention as
+ * vamp-simple-host and MultiPluginRunner: after the last complete
+ * block, it processes blockSize / stepSize - 1 further blocks (but
+ * at least one), padded with zeros.
+ *
+ * For a plugin that does not declare a warm-up (whose
+ * getWarmUpFrames returns -1, as it does by default) the input is
+ * processed as a single chunk.
+ *
+ * The runner loads its plugin instances itself, using the
+ * PluginLoader, with the given adapter flags.  It serialises its own
+ * calls to the loader, but the host must not use the loader from
+ * another thread while run() is in progress.
+ *
+ * \note This class was introduced in version 2.9 of the Vamp plugin SDK.
+ */
+
+class ChunkedPluginRunner
+{
+public:
+    /**
+     * Source is the interface through which the runner reads its
+     * input.  read() is only ever called from one thread at a time,
+     * but not always from the same thread, and not always in order
+     * of position.
+     */
+    class Source
+    {
+    public:
+        virtual ~Source() { }
+
+        /**
+         * Return the number of channels in the input.
+         */
+        virtual size_t getChannelCount() const = 0;
+
+        /**
+         * Return the total length of the input in sample frames.
+         */
+        virtual size_t getFrameCount() const = 0;
+
+        /**
+         * Read count frames of input starting at frame start into
+         * the given buffers, one per channel, and return the number
+         * of frames actually read.  Any frames not read will be
+         * treated as silence.
+         */
+        virtual size_t read(size_t start, size_t count,
+                            float *const *buffers) = 0;
+    };
+
+    /**
+     * Construct a runner for the plugin with the given key, which
+     * will be loaded using PluginLoader::loadPlugin with the given
+     * input sample rate and adapter flags.
+     */
+    ChunkedPluginRunner(PluginLoader::PluginKey key,
+                        float inputSampleRate,
+                        int adapterFlags = PluginLoader::ADAPT_ALL_SAFE);
+    ~ChunkedPluginRunner();
+
+    /**
+     * Set a parameter to be applied to every instance of the plugin
+     * before it is initialised.
+     */
+    void setParameter(std::string name, float value);
+
+    /**
+     * Set a program to be selected in every instance of the plugin
+     * before any parameters are set.
+     */
+    void selectProgram(std::string program);
+
+    /**
+     * Set the number of threads to process chunks on, including the
+     * thread that calls run().  The default is 1.
+     */
+    void setThreadCount(int threads);
+
+    /**
+     * Set the approximate length of each chunk in sample frames.
+     * This is rounded up to a whole number of steps.  The default is
+     * 1048576 frames.
+     */
+    void setChunkSize(size_t frames);
+
+    /**
+     * Set a minimum warm-up period in sample frames for each chunk.
+     * The warm-up used is the greater of this and the plugin's own
+     * value; it has no effect for plugins whose input cannot be
+     * split.  The default is 0.
+     */
+    void setWarmUpFrames(size_t frames);
+
+    /**
+     * Process the whole of the given source with the given step and
+     * block size.  A zero step or block size means to use the
+     * plugin's preferred value, or a suitable default if it has none.
+     * Any features from a previous run are discarded.
+     *
+     * Return false if the plugin could not be loaded or initialised.
+     */
+    bool run(Source &source, size_t stepSize = 0, size_t blockSize = 0);
+
+    /**
+     * Return the output descriptors of the plugin, as initialised
+     * for the last run.
+     */
+    Plugin::OutputList getOutputDescriptors() const;
+
+    /**
+     * Return the step size used for the last run.
+     */
+    size_t getStepSize() const;
+
+    /**
+     * Return the block size used for the last run.
+     */
+    size_t getBlockSize() const;
+
+    /**
+     * Return the number of chunks the input was divided into for
+     * the last run.
+     */
+    int getChunkCount() const;
+
+    /**
+     * Return the features produced by the last run, and clear them
+     * from the runner.
+     */
+    Plugin::FeatureSet takeFeatures();
+
+protected:
+    class Impl;
+    Impl *m_impl;
+
+private:
+    ChunkedPluginRunner(const ChunkedPluginRunner &); // not provided
+    ChunkedPluginRunner &operator=(const ChunkedPluginRunner &); // not provided
+};
+
+}
+
+}
+
+_VAMP_SDK_HOSTSPACE_END(ChunkedPluginRunner.h)
+
+#endif
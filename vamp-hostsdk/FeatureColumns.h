@@ -0,0 +1,227 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _VAMP_FEATURE_COLUMNS_H_
+#define _VAMP_FEATURE_COLUMNS_H_
+
+#include "hostguard.h"
+#include <vamp-hostsdk/Plugin.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+_VAMP_SDK_HOSTSPACE_BEGIN(FeatureColumns.h)
+
+namespace Vamp {
+
+namespace HostExt {
+
+/**
+ * \class FeatureColumns FeatureColumns.h <vamp-hostsdk/FeatureColumns.h>
+ *
+ * FeatureColumns is an alternative to Plugin::FeatureList for holding
+ * the features returned on a single output of a plugin.  Instead of
+ * one Feature object per feature, each with its own value vector and
+ * label string, it stores the values of all features end to end in a
+ * single buffer, alongside arrays of timestamps, durations and value
+ * offsets, and it keeps only one copy of each distinct label.
+ *
+ * Clearing a FeatureColumns object retains its storage, so a host
+ * that reuses the same object for every processing block need not
+ * allocate any memory per feature once the numbers of features and
+ * values have settled down.  This is particularly useful for outputs
+ * that return a feature with many values (such as a spectrum) at
+ * every processing step.
+ *
+ * See PluginWrapper::processColumns() and
+ * PluginHostAdapter::processColumns() for the means to obtain
+ * features from a plugin in this form.
+ *
+ * \note This class was introduced in version 2.9 of the Vamp plugin SDK.
+ */
+
+class FeatureColumns
+{
+public:
+    FeatureColumns();
+
+    /**
+     * Return the number of features held.
+     */
+    size_t size() const { return m_timestamps.size(); }
+
+    /**
+     * Return true if no features are held.
+     */
+    bool empty() const { return m_timestamps.empty(); }
+
+    /**
+     * Remove all features, retaining the allocated storage for reuse.
+     */
+    void clear();
+
+    /**
+     * Append a feature.
+     */
+    void append(const Plugin::Feature &feature);
+
+    /**
+     * Append a feature given its individual properties.  The label
+     * may be NULL or empty if the feature has no label.
+     */
+    void append(bool hasTimestamp, RealTime timestamp,
+                bool hasDuration, RealTime duration,
+                const float *values, size_t valueCount,
+                const char *label);
+
+    /**
+     * Append a copy of feature number i from another FeatureColumns
+     * object, or from this one.
+     */
+    void append(const FeatureColumns &other, size_t i);
+
+    bool hasTimestamp(size_t i) const { return m_flags[i] & TimestampFlag; }
+    RealTime getTimestamp(size_t i) const { return m_timestamps[i]; }
+
+    /**
+     * Set the timestamp of feature number i, and mark it as having a
+     * timestamp.
+     */
+    void setTimestamp(size_t i, RealTime timestamp);
+
+    bool hasDuration(size_t i) const { return m_flags[i] & DurationFlag; }
+    RealTime getDuration(size_t i) const { return m_durations[i]; }
+
+    /**
+     * Return the number of values in feature number i.
+     */
+    size_t getValueCount(size_t i) const {
+        return m_offsets[i+1] - m_offsets[i];
+    }
+
+    /**
+     * Return a pointer to the values of feature number i, which are
+     * stored contiguously.  The pointer is invalidated when any
+     * further feature is appended.  Returns NULL if the feature has
+     * no values.
+     */
+    const float *getValues(size_t i) const {
+        return getValueCount(i) > 0 ? &m_values[m_offsets[i]] : 0;
+    }
+
+    /**
+     * Return the label of feature number i, or an empty string if it
+     * has none.
+     */
+    const std::string &getLabel(size_t i) const;
+
+    /**
+     * Return a copy of feature number i as a Plugin::Feature.
+     */
+    Plugin::Feature getFeature(size_t i) const;
+
+    /**
+     * Overwrite the given Plugin::Feature with a copy of feature
+     * number i, reusing the storage of its value vector and label.
+     */
+    void getFeature(size_t i, Plugin::Feature &feature) const;
+
+    /**
+     * Replace the contents of this object with the given features.
+     */
+    void assign(const Plugin::FeatureList &list);
+
+    /**
+     * Replace the contents of the given FeatureList with the features
+     * held in this object.
+     */
+    void toFeatureList(Plugin::FeatureList &list) const;
+
+private:
+    enum { TimestampFlag = 1, DurationFlag = 2 };
+
+    std::vector<float> m_values;
+    std::vector<size_t> m_offsets; // feature i has values m_offsets[i]..[i+1]
+    std::vector<RealTime> m_timestamps;
+    std::vector<RealTime> m_durations;
+    std::vector<unsigned char> m_flags;
+    std::vector<int> m_labels;     // index into m_labelTable, or -1
+    std::vector<std::string> m_labelTable;
+    std::map<std::string, int> m_labelIndex;
+
+    int internLabel(const char *label);
+};
+
+/**
+ * FeatureColumnSet is the columnar counterpart of Plugin::FeatureSet,
+ * mapping from output index to the features returned on that output.
+ */
+typedef std::map<int, FeatureColumns> FeatureColumnSet;
+
+/**
+ * Replace the contents of the FeatureColumnSet with the features in
+ * the FeatureSet.  Outputs present in the FeatureColumnSet but not in
+ * the FeatureSet are left present and empty.
+ */
+void convertFeatures(const Plugin::FeatureSet &from, FeatureColumnSet &to);
+
+/**
+ * Replace the contents of the FeatureSet with the features in the
+ * FeatureColumnSet.  Outputs with no features are omitted.
+ */
+void convertFeatures(const FeatureColumnSet &from, Plugin::FeatureSet &to);
+
+/**
+ * Run a single processing block through the given plugin, returning
+ * its features in the given FeatureColumnSet, replacing its previous
+ * contents as convertFeatures does.  If the plugin is a
+ * PluginWrapper or PluginHostAdapter, its processColumns() method is
+ * used; otherwise the plugin's features are obtained using its
+ * process() method and converted.
+ */
+void processColumns(Plugin *plugin,
+                    const float *const *inputBuffers,
+                    RealTime timestamp,
+                    FeatureColumnSet &features);
+
+}
+
+}
+
+_VAMP_SDK_HOSTSPACE_END(FeatureColumns.h)
+
+#endif
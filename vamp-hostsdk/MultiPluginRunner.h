@@ -0,0 +1,202 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp
+
+    An API for audio analysis and feature extraction plugins.
+
+    Centre for Digital Music, Queen Mary, University of London.
+    Copyright 2006-2019 Chris Cannam and QMUL.
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use, copy,
+    modify, merge, publish, distribute, sublicense, and/or sell copies
+    of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+    Except as contained in this notice, the names of the Centre for
+    Digital Music; Queen Mary, University of London; and Chris Cannam
+    shall not be used in advertising or otherwise to promote the sale,
+    use or other dealings in this Software without prior written
+    authorization.
+*/
+
+#ifndef _VAMP_MULTI_PLUGIN_RUNNER_H_
+#define _VAMP_MULTI_PLUGIN_RUNNER_H_
+
+#include "hostguard.h"
+#include "Plugin.h"
+
+_VAMP_SDK_HOSTSPACE_BEGIN(MultiPluginRunner.h)
+
+namespace Vamp {
+
+namespace HostExt {
+
+/**
+ * \class MultiPluginRunner MultiPluginRunner.h <vamp-hostsdk/MultiPluginRunner.h>
+ *
+ * MultiPluginRunner drives a set of plugins over the same audio
+ * input, so that a host running many plugins on one file needs to
+ * read and buffer the audio only once.
+ *
+ * The host adds each plugin (typically as returned from
+ * PluginLoader::loadPlugin with ADAPT_ALL or ADAPT_ALL_SAFE) using
+ * addPlugin, which initialises it.  It then passes the audio to
+ * process in chunks of any convenient length, and calls finish once
+ * the input is exhausted.  The features returned by each plugin may
+ * be retrieved with takeFeatures at any point.
+ *
+ * The runner cuts the input into blocks for each plugin according to
+ * the plugin's step and block size, and calls the plugin's process
+ * function for every block in order, exactly as a host reading the
+ * input separately for each plugin would.  At the end of the input
+ * it follows the vamp-simple-host convention: after the last
+ * complete block, it processes blockSize / stepSize - 1 further
+ * blocks (but at least one), padded with zeros.  The features
+ * returned are the plugin's own, gathered in order for each output;
+ * no timestamps are added to features that lack them, but the host
+ * can find out which block each feature was returned for (see
+ * takeFeatures).
+ *
+ * Plugins sharing the same step and block size form a group.  Where
+ * the plugins in a group take frequency-domain input through a
+ * PluginInputDomainAdapter, the group shares a single
+ * PluginInputDomainAdapter::SharedSpectrum so that each block is
+ * transformed only once.
+ *
+ * With more than one thread, different plugins are run concurrently,
+ * each thread taking the next plugin with work outstanding as soon as
+ * it is free.  Each individual plugin is only ever called from one
+ * thread at a time, and sees its blocks in order.
+ *
+ * The runner does not take ownership of the plugins.  Until finish
+ * has been called, they must not be deleted before the runner is.
+ *
+ * \note This class was introduced in version 2.9 of the Vamp plugin SDK.
+ */
+
+class MultiPluginRunner
+{
+public:
+    /**
+     * Construct a runner for audio with the given number of channels,
+     * processing using the given number of threads (including the
+     * thread that calls process).  The audio is expected to have the
+     * input sample rate that the plugins were constructed with.
+     */
+    MultiPluginRunner(size_t channels, int threads = 1);
+    ~MultiPluginRunner();
+
+    /**
+     * Initialise the given plugin with the runner's channel count and
+     * the given step and block size, and add it to the set of
+     * plugins to be run.  A zero step or block size means to use the
+     * plugin's preferred value, or a suitable default if it has none.
+     *
+     * Return the index of the plugin, used to retrieve its features,
+     * or -1 if it could not be initialised or if process has already
+     * been called.
+     */
+    int addPlugin(Plugin *plugin, size_t stepSize = 0, size_t blockSize = 0);
+
+    /**
+     * Add a plugin that the host has already initialised with the
+     * runner's channel count and the given (non-zero) step and block
+     * size, without initialising it again.  This is intended for
+     * hosts that reuse a plugin from an earlier run after calling
+     * reset() on it.  Return values are as for addPlugin.
+     */
+    int addInitialisedPlugin(Plugin *plugin, size_t stepSize, size_t blockSize);
+
+    /**
+     * Return the number of plugins added.
+     */
+    int getPluginCount() const;
+
+    /**
+     * Return the plugin with the given index.
+     */
+    Plugin *getPlugin(int index) const;
+
+    /**
+     * Return the step size the plugin with the given index was
+     * initialised with.
+     */
+    size_t getStepSize(int index) const;
+
+    /**
+     * Return the block size the plugin with the given index was
+     * initialised with.
+     */
+    size_t getBlockSize(int index) const;
+
+    /**
+     * Pass the next frameCount frames of input, one array of floats
+     * per channel, to all of the plugins.  Every block that can be
+     * completed from the input received so far is processed before
+     * this function returns.
+     */
+    void process(const float *const *inputBuffers, size_t frameCount);
+
+    /**
+     * Process the remaining, partial blocks of input and call
+     * getRemainingFeatures on all of the plugins.  No further input
+     * may be supplied afterwards.
+     */
+    void finish();
+
+    /**
+     * Return the features produced by the plugin with the given
+     * index since the last call to takeFeatures for that plugin, and
+     * clear them from the runner.
+     */
+    Plugin::FeatureSet takeFeatures(int index);
+
+    /**
+     * For each output number, the frame at which the processing
+     * block began for each of the output's features, in the same
+     * order as the features.
+     */
+    typedef std::map<int, std::vector<size_t> > BlockFrameSet;
+
+    /**
+     * As takeFeatures(index), but also return in blockFrames the
+     * frame at which the block began for which each feature was
+     * returned.  This is what a host needs in order to place
+     * features that have no timestamp of their own, as it would if
+     * it had called process() itself.  Features returned by
+     * getRemainingFeatures are given the frame following the last
+     * block, i.e. the start of the last block plus the step size.
+     */
+    Plugin::FeatureSet takeFeatures(int index, BlockFrameSet &blockFrames);
+
+protected:
+    class Impl;
+    Impl *m_impl;
+
+private:
+    MultiPluginRunner(const MultiPluginRunner &); // not provided
+    MultiPluginRunner &operator=(const MultiPluginRunner &); // not provided
+};
+
+}
+
+}
+
+_VAMP_SDK_HOSTSPACE_END(MultiPluginRunner.h)
+
+#endif
@@ -177,8 +177,31 @@ public:
     void reset();
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
+
+    void processColumns(const float *const *inputBuffers,
+                        RealTime timestamp,
+                        FeatureColumnSet &features);
+
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp,
+                            size_t channels,
+                            size_t stepSize,
+                            size_t blockSize);
     
     FeatureSet getRemainingFeatures();
+
+    /**
+     * Return the plugin's warm-up frame count (see
+     * Plugin::getWarmUpFrames) expressed in terms of the input to
+     * this adapter, or -1 if the input cannot be split.  The input
+     * can only be split at multiples of the step size passed to
+     * initialise(), and that must be a multiple of the plugin's own
+     * step size for the plugin's blocks to fall in the same place,
+     * and the plugin must have no fixed-rate outputs (whose
+     * features may be numbered by this adapter).
+     */
+    int getWarmUpFrames() const;
     
 protected:
     class Impl;
@@ -82,8 +82,12 @@ namespace HostExt {
  *  maximum acceptable number of channels will be produced by
  *  discarding the excess channels.
  *
- * Hosts requiring a different channel policy from the above will need
- * to implement it themselves, instead of using PluginChannelAdapter.
+ * Hosts requiring a different channel policy from the above may
+ * supply an explicit mixing matrix using setMixingMatrix(), giving
+ * the gain with which each input channel contributes to each of the
+ * plugin's channels.  This can express, for example, a mid-only or
+ * mid/side mix, or the selection of particular channels from a
+ * multichannel source.
  *
  * Note that PluginChannelAdapter does not override the minimum and
  * maximum channel counts returned by the wrapped plugin.  The host
@@ -120,10 +124,49 @@ public:
     PluginChannelAdapter(Plugin *plugin);
     virtual ~PluginChannelAdapter();
 
+    /**
+     * Set a matrix of gains with which to mix the input channels
+     * into the plugin's channels, in place of the default policy
+     * described above.  This must be called before initialise().
+     *
+     * gains contains pluginChannels rows of inputChannels values
+     * each, so that plugin channel p receives the sum over all input
+     * channels i of the input multiplied by gains[p * inputChannels
+     * + i].  Zero gains cost nothing, and a plugin channel fed from a
+     * single input at unity gain receives that input unmodified, so
+     * sparse matrices (such as those that pick out channels) are
+     * cheap.
+     *
+     * initialise() will then fail unless it is called with
+     * inputChannels channels and pluginChannels lies within the
+     * plugin's minimum and maximum channel counts.
+     *
+     * Return false if the size of gains does not match the channel
+     * counts, or if the adapter has already been initialised.  Pass
+     * an empty gains vector to revert to the default policy.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    bool setMixingMatrix(size_t pluginChannels,
+                         size_t inputChannels,
+                         const std::vector<float> &gains);
+    
     bool initialise(size_t channels, size_t stepSize, size_t blockSize);
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
 
+    void processColumns(const float *const *inputBuffers,
+                        RealTime timestamp,
+                        FeatureColumnSet &features);
+
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp,
+                            size_t channels,
+                            size_t stepSize,
+                            size_t blockSize);
+
     /**
      * Call process(), providing interleaved audio data with the
      * number of channels passed to initialise().  The adapter will
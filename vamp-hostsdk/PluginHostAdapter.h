@@ -39,6 +39,7 @@
 
 #include "hostguard.h"
 #include "Plugin.h"
+#include "FeatureColumns.h"
 
 #include <vamp/vamp.h>
 
@@ -68,8 +69,22 @@ namespace Vamp {
 class PluginHostAdapter : public Plugin
 {
 public:
+    /**
+     * Construct an adapter for the plugin with the given descriptor.
+     *
+     * If the plugin's library provides the optional batch processing
+     * extension, as returned from its vampGetPluginBatchExtension
+     * function, pass it as \arg batchExtension and it will be used to
+     * implement processBatch().  Likewise the optional warm-up
+     * extension, as returned from vampGetPluginWarmUpExtension, will
+     * be used to implement getWarmUpFrames().  Either may be NULL.
+     * PluginLoader does this automatically when they are available.
+     */
     PluginHostAdapter(const VampPluginDescriptor *descriptor,
-                      float inputSampleRate);
+                      float inputSampleRate,
+                      const VampPluginBatchExtension *batchExtension = 0,
+                      const VampPluginWarmUpExtension *warmUpExtension = 0);
+
     virtual ~PluginHostAdapter();
     
     static std::vector<std::string> getPluginPath();
@@ -105,13 +120,70 @@ public:
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
 
+    /**
+     * Process a single block of input, as process() above, but
+     * return the features in the caller-owned FeatureSet \arg
+     * features, reusing its storage where possible instead of
+     * returning a new FeatureSet.  A host that calls this repeatedly
+     * with the same FeatureSet object will, once the plugin has
+     * returned similar numbers of features for a few blocks, not need
+     * to allocate any memory for the results of each block.
+     *
+     * On return, \arg features contains exactly the features returned
+     * for this block, except that an output that had features in an
+     * earlier call but has none in this one will be present with an
+     * empty FeatureList rather than absent.
+     *
+     * A host that loads a plugin using PluginLoader with no adapter
+     * flags can reach this through
+     * PluginWrapper::getWrapper<PluginHostAdapter>().  (With adapter
+     * flags, the adapters' own processing would be bypassed.)
+     */
+    void process(const float *const *inputBuffers, RealTime timestamp,
+                 FeatureSet &features);
+
+    /**
+     * Process a single block of input, as process() above, but
+     * return the features in columnar form in the caller-owned
+     * FeatureColumnSet, replacing its previous contents.  The
+     * features are copied directly from the plugin's returned C
+     * structures, without constructing any Feature objects.
+     */
+    void processColumns(const float *const *inputBuffers,
+                        RealTime timestamp,
+                        HostExt::FeatureColumnSet &features);
+
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp,
+                            size_t channels,
+                            size_t stepSize,
+                            size_t blockSize);
+
     FeatureSet getRemainingFeatures();
 
+    int getWarmUpFrames() const;
+
 protected:
     void convertFeatures(VampFeatureList *, FeatureSet &);
+    void convertFeaturesInPlace(VampFeatureList *, FeatureSet &);
+    void convertFeature(const VampFeatureList &, unsigned int, Feature &);
+    void convertFeatureColumns(VampFeatureList *, HostExt::FeatureColumnSet &);
+
+    unsigned int getOutputCount() const;
+    void invalidateOutputs();
 
     const VampPluginDescriptor *m_descriptor;
+    const VampPluginBatchExtension *m_batchExtension;
+    const VampPluginWarmUpExtension *m_warmUpExtension;
     VampPluginHandle m_handle;
+
+    // The output descriptors can only change on initialise, or on a
+    // change of parameter or program, so we cache them in between
+    mutable OutputList m_outputs;
+    mutable bool m_outputsValid;
+    mutable unsigned int m_outputCount;
+    mutable bool m_outputCountValid;
 };
 
 }
@@ -76,6 +76,11 @@ namespace HostExt {
  * and the current shape retrieved using getWindowType.  (This was
  * added in v2.3 of the SDK.)
  *
+ * Several adapters analysing the same audio may share their
+ * transforms through a SharedSpectrum object, so that each block is
+ * windowed and transformed only once.  (This was added in v2.9 of the
+ * SDK.)
+ *
  * In every respect other than its input domain handling, the
  * PluginInputDomainAdapter behaves identically to the plugin that it
  * wraps.  The wrapped plugin will be deleted when the wrapper is
@@ -105,6 +110,25 @@ public:
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
 
+    void processColumns(const float *const *inputBuffers,
+                        RealTime timestamp,
+                        FeatureColumnSet &features);
+
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp,
+                            size_t channels,
+                            size_t stepSize,
+                            size_t blockSize);
+
+    /**
+     * Return the plugin's warm-up frame count (see
+     * Plugin::getWarmUpFrames), plus half a block when the
+     * ShiftData timestamp method is in use, as the data for each
+     * block then includes input from the preceding half block.
+     */
+    int getWarmUpFrames() const;
+
     /**
      * ProcessTimestampMethod determines how the
      * PluginInputDomainAdapter handles timestamps for the data passed
@@ -221,6 +245,88 @@ public:
      */
     void setWindowType(WindowType type);
 
+    /**
+     * Return the number of threads used to transform the input
+     * channels of a frequency-domain plugin.  The default is 1.
+     */
+    int getThreadCount() const;
+
+    /**
+     * Set the number of threads used to transform the input channels
+     * of a frequency-domain plugin.  With more than one thread, the
+     * windowing and FFT of each channel in a processing block are
+     * shared out between the threads (including the thread that calls
+     * process()), at the cost of separate FFT scratch space for every
+     * channel.  This is worthwhile only for plugins with many input
+     * channels.  There is no effect for time-domain plugins, or when
+     * there is only one channel.
+     *
+     * This function must be called before initialise() for the
+     * setting to take effect.
+     */
+    void setThreadCount(int threads);
+
+    /**
+     * \class SharedSpectrum PluginInputDomainAdapter.h <vamp-hostsdk/PluginInputDomainAdapter.h>
+     *
+     * SharedSpectrum holds the most recently calculated spectra of a
+     * set of PluginInputDomainAdapters, so that when several
+     * frequency-domain plugins are run over the same audio, each
+     * block of input is windowed and transformed only once and the
+     * result handed to all of them.
+     *
+     * A spectrum is reused only for an adapter whose block size and
+     * window shape match the ones it was calculated with, and whose
+     * (possibly shifted) input block is identical to the one it was
+     * calculated from.  Adapters with differing settings may still
+     * share a SharedSpectrum object, they just won't benefit from it.
+     * Because reuse depends only on the input data, the features
+     * returned are exactly the same as they would be without sharing.
+     *
+     * The capacity is the number of channel spectra retained.  When
+     * the adapters are driven in lockstep, block by block, this needs
+     * to be no more than the number of input channels; when they are
+     * driven from separate threads and may drift apart, a larger
+     * capacity allows them to share anyway.
+     *
+     * A SharedSpectrum may be used from several threads at once.  It
+     * must outlive all of the adapters using it.
+     *
+     * \note This class was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    class SharedSpectrum
+    {
+    public:
+        SharedSpectrum(int capacity = 16);
+        ~SharedSpectrum();
+
+    protected:
+        class Impl;
+        Impl *m_impl;
+        friend class PluginInputDomainAdapter;
+
+    private:
+        SharedSpectrum(const SharedSpectrum &); // not provided
+        SharedSpectrum &operator=(const SharedSpectrum &); // not provided
+    };
+
+    /**
+     * Share transforms with other adapters through the given
+     * SharedSpectrum object, or stop sharing if it is null.  See the
+     * SharedSpectrum documentation for details.  There is no effect
+     * for time-domain plugins.
+     *
+     * This function must be called before the first call to
+     * process().
+     */
+    void setSharedSpectrum(SharedSpectrum *spectrum);
+
+    /**
+     * Return the SharedSpectrum object in use, if any.
+     */
+    SharedSpectrum *getSharedSpectrum() const;
+
 
 protected:
     class Impl;
@@ -260,6 +260,42 @@ public:
      */
     std::string getLibraryPathForPlugin(PluginKey plugin);
 
+    /**
+     * Keep a persistent index of plugin libraries in the given file,
+     * so that plugins can be listed and found without loading every
+     * library on the plugin path again in each new process.
+     *
+     * The index records the plugins found in each library, along
+     * with the library's size and modification time.  A library is
+     * loaded to be searched again only if it is new or has changed
+     * since it was last indexed; the file is rewritten whenever the
+     * index changes.  Pass an empty path to stop using an index.
+     *
+     * By default no index is used, unless the environment variable
+     * VAMP_PLUGIN_INDEX is set, in which case it gives the path of
+     * the index file.  This should be called before any of the
+     * functions that list plugins or find their libraries.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    void setIndexFile(std::string path);
+
+    /**
+     * Set the number of threads to use when loading plugin libraries
+     * to find out which plugins they contain.  The default is 1, i.e.
+     * libraries are loaded one at a time by the calling thread.  With
+     * more threads, libraries are loaded and searched concurrently;
+     * the results are the same, and in the same order, either way.
+     * This may help when there are many libraries to search (for
+     * example because no index is in use, see setIndexFile()) and
+     * they are slow to load.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    void setScanThreadCount(int threads);
+
 protected:
     PluginLoader();
     virtual ~PluginLoader();
@@ -72,13 +72,27 @@ namespace HostExt {
  * providing a list of times such that one summary will be provided
  * for each segment between two consecutive times.
  *
- * PluginSummarisingAdapter is straightforward rather than fast.  It
- * calculates all of the summary types for all outputs always, and
- * then returns only the ones that are requested.  It is designed on
- * the basis that, for most features, summarising and storing
- * summarised results is far cheaper than calculating the results in
- * the first place.  If this is not true for your particular feature,
- * PluginSummarisingAdapter may not be the best approach for you.
+ * PluginSummarisingAdapter calculates each summary type for an output
+ * when it is first requested, and keeps it for later requests.  It is
+ * designed on the basis that, for most features, summarising and
+ * storing summarised results is far cheaper than calculating the
+ * results in the first place.  If this is not true for your particular
+ * feature, PluginSummarisingAdapter may not be the best approach for
+ * you.
+ *
+ * By default the adapter stores every result returned by the plugin,
+ * so that any summary type can be calculated on request.  An output's
+ * results are released once every summary type has been calculated
+ * for it, or on reset().  For long inputs this can take a lot of
+ * memory; see setStreamingMode for an alternative that
+ * summarises as it goes, in memory that does not depend on the length
+ * of the input, and which can also provide summaries of the segments
+ * completed so far while processing continues (see
+ * getCompletedSummaryForOutput).
+ *
+ * The adapter can also summarise each output over a sliding window of
+ * fixed length as the results arrive, giving moving minima, maxima,
+ * means, medians and variances; see setSlidingWindow.
  *
  * \note This class was introduced in version 2.0 of the Vamp plugin SDK.
  */
@@ -99,8 +113,24 @@ public:
     void reset();
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
+
+    void processColumns(const float *const *inputBuffers,
+                        RealTime timestamp,
+                        FeatureColumnSet &features);
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp,
+                            size_t channels,
+                            size_t stepSize,
+                            size_t blockSize);
     FeatureSet getRemainingFeatures();
 
+    /**
+     * Return -1: the summaries are calculated across the whole of
+     * the input, so it cannot be split between instances.
+     */
+    int getWarmUpFrames() const;
+
     typedef std::set<RealTime> SegmentBoundaries;
 
     /**
@@ -111,13 +141,63 @@ public:
      * 
      * Note that you cannot retrieve results with multiple different
      * segmentations by repeatedly calling this function followed by
-     * one of the getSummary functions.  The summaries are all
-     * calculated at the first call to any getSummary function, and
-     * once the summaries have been calculated, they remain
-     * calculated.
+     * one of the getSummary functions.  The results are divided into
+     * segments at the first call to any getSummary function, and
+     * once they have been divided, they remain so.
      */
     void setSummarySegmentBoundaries(const SegmentBoundaries &);
 
+    /**
+     * Set whether to summarise results as they arrive, rather than
+     * storing them all until a summary is requested.  The default is
+     * false.
+     *
+     * In streaming mode the adapter keeps only running totals, plus a
+     * compact sketch of the distribution of values for the median and
+     * mode, for each bin of each output in each segment.  Its memory
+     * use is therefore independent of the length of the input.
+     *
+     * The minimum, maximum, sum, count, means and variances are the
+     * same as without streaming (to within rounding).  The median and
+     * modal values are exact as long as no bin takes more than a few
+     * hundred distinct values within a segment; beyond that they are
+     * approximated by merging the closest values together.
+     *
+     * This function, and setSummarySegmentBoundaries, must be called
+     * before the first call to process() if streaming is to be used.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    void setStreamingMode(bool streaming);
+
+    /**
+     * Return true if the adapter is in streaming mode.
+     * \see setStreamingMode
+     */
+    bool getStreamingMode() const;
+
+    /**
+     * Set the number of threads used to calculate the summaries when
+     * they are first requested.  The default is 1.  With more than
+     * one thread, the bins of each segment of each output are shared
+     * out between the threads (including the thread that calls the
+     * getSummary function).  This is worthwhile for outputs with many
+     * bins, such as spectra, or with many segments.  It has no effect
+     * in streaming mode, in which the summaries are calculated as the
+     * results arrive.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    void setThreadCount(int threads);
+
+    /**
+     * Return the number of threads used to calculate the summaries.
+     * \see setThreadCount
+     */
+    int getThreadCount() const;
+
     enum SummaryType {
         Minimum            = 0,
         Maximum            = 1,
@@ -183,6 +263,131 @@ public:
     FeatureSet getSummaryForAllOutputs(SummaryType type,
                                        AveragingMethod method = SampleAverage);
 
+    /**
+     * Return summaries of the features returned so far on the given
+     * output, for those segments that have been completed: that is,
+     * those whose end time has been passed by the results of the
+     * output.  The segment in progress is not included.  Unlike
+     * getSummaryForOutput, this may be called at any time during
+     * processing, which then continues as normal; and each call takes
+     * time only in proportion to the segments completed since the
+     * last.  Once all the features have been returned, the summaries
+     * of the completed segments are the same as those returned by
+     * getSummaryForOutput for them.
+     *
+     * This is available only in streaming mode (see
+     * setStreamingMode), and relies on the plugin returning the
+     * results of each output in time order.  In non-streaming mode it
+     * returns no features.  Once getSummaryForOutput or
+     * getSummaryForAllOutputs has been called, it returns the same as
+     * they do.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    FeatureList getCompletedSummaryForOutput(int output,
+                                             SummaryType type,
+                                             AveragingMethod method = SampleAverage);
+
+    /**
+     * Return summaries of the completed segments of the features
+     * returned so far on all of the plugin's outputs.
+     * \see getCompletedSummaryForOutput
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    FeatureSet getCompletedSummaryForAllOutputs(SummaryType type,
+                                                AveragingMethod method = SampleAverage);
+
+    /**
+     * Request summaries over a sliding window as well: one for each
+     * period of the given length, starting at zero and at every
+     * multiple of the given hop after it.  Windows are summarised as
+     * the results arrive, independently of the segment summaries.
+     * They may overlap (if the hop is shorter than the window) or
+     * leave gaps (if it is longer).  A length of zero, the default,
+     * turns sliding windows off.
+     *
+     * Only the summaries of the most recent history windows of each
+     * output are retained, older ones being dropped as new windows
+     * are completed, so that the memory used depends on the number of
+     * results within one window and on the history rather than on
+     * the length of the input.  A host wanting every window of a long
+     * input should retrieve the summaries during processing, at
+     * least once every history hops.
+     *
+     * Sliding window summaries use sample averaging, and do not
+     * include the modal value.  This function must be called before
+     * the first call to process().
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    void setSlidingWindow(RealTime length, RealTime hop, int history = 256);
+
+    /**
+     * Return the length of the sliding window, or zero if sliding
+     * windows are not in use.
+     * \see setSlidingWindow
+     */
+    RealTime getSlidingWindowLength() const;
+
+    /**
+     * Return the hop between the starts of successive sliding windows.
+     * \see setSlidingWindow
+     */
+    RealTime getSlidingWindowHop() const;
+
+    /**
+     * Return the number of completed sliding windows whose summaries
+     * are retained for each output.
+     * \see setSlidingWindow
+     */
+    int getSlidingWindowHistory() const;
+
+    /**
+     * Return one summary feature, using the given SummaryType, for
+     * each sliding window on the given output that has been completed
+     * and is still retained (see setSlidingWindow) and not discarded.
+     * Each feature's timestamp is the start of its window.  Windows
+     * without results are omitted.
+     *
+     * A window is complete once the output has returned a result at
+     * or after its end, so this may be called at any time during
+     * processing, which then continues as normal.  The remaining
+     * windows are completed by getRemainingFeatures().  The results
+     * of each output are expected in time order.
+     *
+     * The Mode summary type is not available for sliding windows.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    FeatureList getSlidingWindowSummaryForOutput(int output,
+                                                 SummaryType type);
+
+    /**
+     * Return sliding window summaries for all of the plugin's
+     * outputs, using the given SummaryType.
+     * \see getSlidingWindowSummaryForOutput
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    FeatureSet getSlidingWindowSummaryForAllOutputs(SummaryType type);
+
+    /**
+     * Discard the summaries of all sliding windows completed so far.
+     * A host that retrieves the window summaries it needs during
+     * processing can call this afterwards, so that each window is
+     * returned only once.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    void discardSlidingWindowSummaries();
+
 protected:
     class Impl;
     Impl *m_impl;
@@ -39,6 +39,7 @@
 
 #include "hostguard.h"
 #include <vamp-hostsdk/Plugin.h>
+#include <vamp-hostsdk/FeatureColumns.h>
 
 _VAMP_SDK_HOSTSPACE_BEGIN(PluginWrapper.h)
 
@@ -95,8 +96,36 @@ public:
 
     FeatureSet process(const float *const *inputBuffers, RealTime timestamp);
 
+    FeatureSet processBatch(const float *const *inputBuffers,
+                            size_t frameCount,
+                            RealTime startTimestamp,
+                            size_t channels,
+                            size_t stepSize,
+                            size_t blockSize);
+
     FeatureSet getRemainingFeatures();
 
+    int getWarmUpFrames() const;
+
+    /**
+     * Process a single block of input, as process(), but return the
+     * features in columnar form in the caller-owned FeatureColumnSet,
+     * replacing its previous contents (see FeatureColumns).
+     *
+     * The default implementation converts the result of process().
+     * Adapters that can pass features through without converting
+     * them to a FeatureSet and back override this, as does
+     * PluginHostAdapter, so that a host reusing the same
+     * FeatureColumnSet for each block need not allocate memory per
+     * feature.
+     *
+     * \note This function was introduced in version 2.9 of the Vamp
+     * plugin SDK.
+     */
+    virtual void processColumns(const float *const *inputBuffers,
+                                RealTime timestamp,
+                                FeatureColumnSet &features);
+
     /**
      * Return a pointer to the plugin wrapper of type WrapperType
      * surrounding this wrapper's plugin, if present.
@@ -111,6 +140,10 @@ public:
      * it would be hard to do so without knowing the order of the
      * wrappers.  This function therefore gives direct access to the
      * wrapper of a particular type.
+     *
+     * The innermost plugin is also considered, so that for example
+     * getWrapper<PluginHostAdapter>() returns the adapter for the
+     * plugin library's own C interface.
      */
     template <typename WrapperType>
     WrapperType *getWrapper() {
@@ -118,7 +151,7 @@ public:
         if (w) return w;
         PluginWrapper *pw = dynamic_cast<PluginWrapper *>(m_plugin);
         if (pw) return pw->getWrapper<WrapperType>();
-        return 0;
+        return dynamic_cast<WrapperType *>(m_plugin);
     }
 
 protected:
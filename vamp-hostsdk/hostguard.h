@@ -43,9 +43,9 @@
 
 #define _VAMP_IN_HOSTSDK 1
 
-#define VAMP_SDK_VERSION "2.8"
+#define VAMP_SDK_VERSION "2.9"
 #define VAMP_SDK_MAJOR_VERSION 2
-#define VAMP_SDK_MINOR_VERSION 8
+#define VAMP_SDK_MINOR_VERSION 9
 
 #ifdef _VAMP_NO_HOST_NAMESPACE
 #define _VAMP_SDK_HOSTSPACE_BEGIN(h)
@@ -37,6 +37,9 @@
 #ifndef _VAMP_HOSTSDK_SINGLE_INCLUDE_H_
 #define _VAMP_HOSTSDK_SINGLE_INCLUDE_H_
 
+#include "ChunkedPluginRunner.h"
+#include "FeatureColumns.h"
+#include "MultiPluginRunner.h"
 #include "PluginBase.h"
 #include "PluginBufferingAdapter.h"
 #include "PluginChannelAdapter.h"
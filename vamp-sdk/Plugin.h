@@ -424,12 +424,99 @@ public:
     virtual FeatureSet process(const float *const *inputBuffers,
 			       RealTime timestamp) = 0;
 
+    /**
+     * Process a batch of consecutive blocks of time-domain input in
+     * a single call.
+     *
+     * inputBuffers points to one array of floats per input channel,
+     * and each of these arrays contains frameCount consecutive audio
+     * samples, the first of which is at startTimestamp.  The batch
+     * is processed as if process() had been called for a block
+     * starting at every multiple of stepSize within the arrays, for
+     * as long as the whole block fits within frameCount samples.
+     * The caller should supply the samples from the first
+     * unprocessed block onward again at the start of the next batch.
+     * The channels, stepSize and blockSize arguments must be the
+     * values that were passed to initialise().
+     *
+     * Return the features from all of the blocks, in order.
+     *
+     * The default implementation simply calls process() once for
+     * each block.  Plugins and adapters that can amortise some of
+     * their per-block work across a batch may reimplement it.  This
+     * function is not applicable to plugins whose inputDomain is
+     * FrequencyDomain unless they are wrapped in an adapter that
+     * converts from the time domain.
+     */
+    virtual FeatureSet processBatch(const float *const *inputBuffers,
+                                    size_t frameCount,
+                                    RealTime startTimestamp,
+                                    size_t channels,
+                                    size_t stepSize,
+                                    size_t blockSize) {
+
+        FeatureSet features;
+        if (channels == 0 || stepSize == 0) return features;
+
+        std::vector<const float *> buffers(channels);
+        const unsigned int rate = (unsigned int)(m_inputSampleRate + 0.5);
+
+        // Count in frames where we can, so as to get the same timestamps
+        // as the host would have if it had called process itself
+        const long startFrame = RealTime::realTime2Frame(startTimestamp, rate);
+        const bool aligned =
+            (RealTime::frame2RealTime(startFrame, rate) == startTimestamp);
+
+        for (size_t offset = 0; offset + blockSize <= frameCount;
+             offset += stepSize) {
+
+            for (size_t c = 0; c < channels; ++c) {
+                buffers[c] = inputBuffers[c] + offset;
+            }
+
+            RealTime timestamp = aligned ?
+                RealTime::frame2RealTime(startFrame + long(offset), rate) :
+                startTimestamp + RealTime::frame2RealTime(long(offset), rate);
+
+            FeatureSet blockFeatures = process(&buffers[0], timestamp);
+
+            for (FeatureSet::iterator i = blockFeatures.begin();
+                 i != blockFeatures.end(); ++i) {
+                FeatureList &list = features[i->first];
+                list.insert(list.end(), i->second.begin(), i->second.end());
+            }
+        }
+
+        return features;
+    }
+
     /**
      * After all blocks have been processed, calculate and return any
      * remaining features derived from the complete input.
      */
     virtual FeatureSet getRemainingFeatures() = 0;
 
+    /**
+     * Return the number of sample frames of input immediately
+     * preceding a block that the plugin must have processed, after
+     * initialise or reset, in order to return exactly the same
+     * features from process() for that block as it would have done
+     * had it processed all of the input from the start.  A plugin
+     * that keeps no state between blocks can return 0.
+     *
+     * A host may use this to split long input into chunks and
+     * process each of them, starting that many frames early, with a
+     * separate plugin instance.  A plugin returning zero or more
+     * therefore must not depend on the timestamp of the first block
+     * it receives, and must return from getRemainingFeatures only
+     * features that relate to the end of the input.
+     *
+     * This will be called after initialise().  The default
+     * implementation returns -1, meaning that the input may not be
+     * split.
+     */
+    virtual int getWarmUpFrames() const { return -1; }
+
     /**
      * Used to distinguish between Vamp::Plugin and other potential
      * sibling subclasses of PluginBase.  Do not reimplement this
@@ -73,6 +73,26 @@ public:
      */
     const VampPluginDescriptor *getDescriptor();
 
+    /**
+     * Return the batch processing extension for the given plugin
+     * descriptor, which must have been obtained from a
+     * PluginAdapterBase, or NULL if the plugin cannot support it.
+     * This is used to implement the vampGetPluginBatchExtension
+     * entry point; plugin code does not normally need to call it.
+     */
+    static const VampPluginBatchExtension *getBatchExtension
+    (const VampPluginDescriptor *descriptor);
+
+    /**
+     * Return the warm-up extension for the given plugin descriptor,
+     * which must have been obtained from a PluginAdapterBase, or NULL
+     * if there is none.  This is used to implement the
+     * vampGetPluginWarmUpExtension entry point; plugin code does not
+     * normally need to call it.
+     */
+    static const VampPluginWarmUpExtension *getWarmUpExtension
+    (const VampPluginDescriptor *descriptor);
+
 protected:
     PluginAdapterBase();
 
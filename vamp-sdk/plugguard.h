@@ -71,9 +71,9 @@
 
 #define _VAMP_IN_PLUGINSDK 1
 
-#define VAMP_SDK_VERSION "2.8"
+#define VAMP_SDK_VERSION "2.9"
 #define VAMP_SDK_MAJOR_VERSION 2
-#define VAMP_SDK_MINOR_VERSION 8
+#define VAMP_SDK_MINOR_VERSION 9
 
 #ifdef _VAMP_NO_PLUGIN_NAMESPACE
 #define _VAMP_SDK_PLUGSPACE_BEGIN(h)
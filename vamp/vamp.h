@@ -381,6 +381,90 @@ const VampPluginDescriptor *vampGetPluginDescriptor
 typedef const VampPluginDescriptor *(*VampGetPluginDescriptorFunction)
     (unsigned int, unsigned int);
 
+
+/** Optional batch processing extension.  A plugin that supports this
+    can process many consecutive blocks of time-domain input in a
+    single call, saving the host a process call per block. */
+
+typedef struct _VampPluginBatchExtension
+{
+    /** Process a batch of consecutive input blocks and return the
+        features from all of them.  inputBuffers points to one array
+        of floats per input channel, each containing frameCount
+        consecutive time-domain samples, the first of which is at the
+        time given by sec and nsec.  The plugin processes a block at
+        every multiple of its step size within the arrays, for as long
+        as the whole block fits within frameCount samples; the host
+        should supply the samples from the first unprocessed block
+        onward again at the start of the next batch.  The channel
+        count, step size and block size are those passed to
+        initialise.  The returned pointer is subject to the same rules
+        as that returned from process, and the host must call
+        releaseFeatureSet after use. */
+    VampFeatureList *(*processBatch)(VampPluginHandle,
+                                     const float *const *inputBuffers,
+                                     unsigned int frameCount,
+                                     int sec,
+                                     int nsec);
+
+} VampPluginBatchExtension;
+
+
+/** Get the batch processing extension for a plugin descriptor
+    previously returned by vampGetPluginDescriptor in the same
+    library.  Return NULL if the plugin does not support batch
+    processing.
+
+    This symbol is optional.  A host should look it up in the plugin
+    library and, if it is not found or returns NULL, call process once
+    per block as usual. */
+const VampPluginBatchExtension *vampGetPluginBatchExtension
+    (const VampPluginDescriptor *descriptor);
+
+
+/** Function pointer type for vampGetPluginBatchExtension. */
+typedef const VampPluginBatchExtension *(*VampGetPluginBatchExtensionFunction)
+    (const VampPluginDescriptor *);
+
+
+/** Optional warm-up extension.  A plugin that supports this can tell
+    the host how much preceding input it needs to have seen in order
+    to produce correct features for a block, so that a host may split
+    long input into chunks and process them separately, for example in
+    parallel using several plugin instances. */
+
+typedef struct _VampPluginWarmUpExtension
+{
+    /** Return the number of sample frames of input immediately
+        preceding a block that the plugin must have processed (after
+        initialise or reset) in order to return exactly the same
+        features from process for that block as it would have done
+        had it processed all of the input from the start.  Return a
+        negative value if there is no such limit.  A plugin returning
+        zero or more must not depend on the time of the first block
+        it receives, and must return from getRemainingFeatures only
+        features relating to the end of the input.  Called after
+        initialise. */
+    int (*getWarmUpFrames)(VampPluginHandle);
+
+} VampPluginWarmUpExtension;
+
+
+/** Get the warm-up extension for a plugin descriptor previously
+    returned by vampGetPluginDescriptor in the same library.  Return
+    NULL if the plugin does not support it.
+
+    This symbol is optional.  A host should look it up in the plugin
+    library and, if it is not found or returns NULL, assume that the
+    plugin's input may not be split. */
+const VampPluginWarmUpExtension *vampGetPluginWarmUpExtension
+    (const VampPluginDescriptor *descriptor);
+
+
+/** Function pointer type for vampGetPluginWarmUpExtension. */
+typedef const VampPluginWarmUpExtension *(*VampGetPluginWarmUpExtensionFunction)
+    (const VampPluginDescriptor *);
+
 #ifdef __cplusplus
 }
 #endif